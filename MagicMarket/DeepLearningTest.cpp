@@ -73,7 +73,7 @@ namespace MM
 		const int startingHour = 8 + 2, endingHour = 16 + 2;
 		const int timeWindow = 1 * ONEMINUTE;
 		const int windowCount = ONEMINUTE * 30 / timeWindow;
-		Stock *stock = market.getStock("EURUSD");
+		Stock *stock = market().getStock("EURUSD");
 
 		std::fstream sampleOutput("saves/deeplearning/samples.tsv", std::ios_base::out);
 		int goodTrainingSamples(0), badTrainingSamples(0);
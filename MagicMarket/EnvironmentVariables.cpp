@@ -6,8 +6,6 @@
 
 #include <iostream>
 
-MM::EnvironmentVariables environmentVariables;
-
 namespace MM
 {
 
@@ -25,7 +23,7 @@ std::string EnvironmentVariables::Var::get()
 		return constValue;
 	case Condition::ExpertActive:
 	{
-		for (ExpertAdvisor *expert : market.getExperts())
+		for (ExpertAdvisor *expert : market().getExperts())
 		{
 			if (expert->getName() != constValue) continue;
 			delete condElse;
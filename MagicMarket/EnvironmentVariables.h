@@ -39,4 +39,5 @@ private:
 
 } // namespace MM
 
-extern MM::EnvironmentVariables environmentVariables;
\ No newline at end of file
+// Of the simulation bound to the calling thread, see SimulationContext.
+MM::EnvironmentVariables &environmentVariables();
\ No newline at end of file
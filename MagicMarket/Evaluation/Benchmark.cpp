@@ -0,0 +1,437 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <filesystem>
+namespace filesystem = std::tr2::sys;
+
+#include <SimpleIni.h>
+
+#include "EnvironmentVariables.h"
+#include "Event.h"
+#include "Market.h"
+#include "SimulationContext.h"
+#include "Statistics.h"
+#include "Stock.h"
+#include "SymbolTable.h"
+#include "TickReplay.h"
+#include "TimePeriod.h"
+#include "TradingDay.h"
+#include "VirtualMarket.h"
+
+#include "Indicators/ADX.h"
+#include "Indicators/ATR.h"
+#include "Indicators/CCI.h"
+#include "Indicators/KRI.h"
+#include "Indicators/LocalRelativeChange.h"
+#include "Indicators/Moves.h"
+#include "Indicators/RSI.h"
+#include "Indicators/Renko.h"
+#include "Indicators/SMA.h"
+#include "Indicators/StochasticOscillator.h"
+#include "Indicators/TSI.h"
+#include "Indicators/TargetLookbackMean.h"
+
+namespace MM
+{
+	namespace
+	{
+		std::string dateToString(const QuantLib::Date &date)
+		{
+			char text[16];
+			std::snprintf(text, sizeof(text), "%04d-%02d-%02d", date.year(), static_cast<int>(date.month()), date.dayOfMonth());
+			return text;
+		}
+	};
+
+	bool Benchmark::isEnabled(void *_ini)
+	{
+		const CSimpleIniA &ini = *(CSimpleIniA*)_ini;
+		return ini.GetBoolValue("Benchmark", "Enabled", false);
+	}
+
+	void Benchmark::init(void *_ini)
+	{
+		const CSimpleIniA &ini = *(CSimpleIniA*)_ini;
+		generator.init(_ini);
+
+		const size_t pairs = static_cast<size_t>(std::max(1L, ini.GetLongValue("Benchmark", "Pairs", 6)));
+		for (size_t i = 0; i < pairs; ++i)
+			symbols.push_back(SyntheticTickGenerator::getSymbolName(i));
+
+		int day, month, year;
+		sscanf_s(ini.GetValue("Benchmark", "Begin", "2000-01-03"), "%d-%d-%d", &year, &month, &day);
+		const QuantLib::Date begin(day, (QuantLib::Month)(month), year);
+		const long days = std::max(1L, ini.GetLongValue("Benchmark", "Days", 2));
+		for (long i = 0; i < days; ++i)
+			dates.push_back(begin + i);
+
+		config.label = environmentVariables().replace(ini.GetValue("Benchmark", "Label", ""));
+		config.outputFilename = environmentVariables().replace(ini.GetValue("Benchmark", "OutputFilename", "saves/benchmark/results.tsv"));
+		config.samples = static_cast<size_t>(std::max(1L, ini.GetLongValue("Benchmark", "Samples", static_cast<long>(config.samples))));
+		config.logStatistics = ini.GetBoolValue("Benchmark", "LogStatistics", config.logStatistics);
+		config.keepData = ini.GetBoolValue("Benchmark", "KeepData", config.keepData);
+
+		writeConfiguration(_ini);
+	}
+
+	void Benchmark::writeConfiguration(void *_ini)
+	{
+		const CSimpleIniA &ini = *(CSimpleIniA*)_ini;
+		config.configurationFilename = "saves/benchmark/market.ini";
+		filesystem::create_directories(filesystem::path(config.configurationFilename).parent_path());
+
+		// The regular configuration, but replaying the generated days.
+		std::string data;
+		ini.Save(data);
+		CSimpleIniA benchmarkIni;
+		benchmarkIni.LoadData(data);
+
+		std::string symbolList;
+		for (const std::string &symbol : symbols)
+			symbolList += (symbolList.empty() ? "" : ",") + symbol;
+
+		benchmarkIni.SetValue("Benchmark", "Enabled", "0");
+		benchmarkIni.SetValue("Parameter Sweep", "Enabled", "0");
+		benchmarkIni.SetValue("Trade Evaluation", "Enabled", "0");
+		benchmarkIni.SetValue("Parallel Simulations", "Configurations", "");
+		benchmarkIni.SetValue("Market", "DataFolder", config.dataFolder.c_str());
+		benchmarkIni.SetValue("Market", "TradesFolder", "saves/benchmark/trades");
+		benchmarkIni.SetValue("Statistics", "Enabled", "1");
+		benchmarkIni.SetValue("Statistics", "OutputFilename", "saves/benchmark/variables.csv");
+		benchmarkIni.SetValue("Virtual Market", "Enabled", "1");
+		benchmarkIni.SetValue("Virtual Market", "Begin", dateToString(dates.front()).c_str());
+		benchmarkIni.SetValue("Virtual Market", "End", dateToString(dates.back()).c_str());
+		benchmarkIni.SetValue("Virtual Market", "Hours", "0-0");
+		benchmarkIni.SetValue("Virtual Market", "Symbols", symbolList.c_str());
+		benchmarkIni.SetValue("Virtual Market", "MinimumDayTicks", "1");
+		benchmarkIni.SetValue("Virtual Market", "Silent", "1");
+		benchmarkIni.SetValue("Virtual Market", "WaitOnFinished", "0");
+		benchmarkIni.SetValue("Virtual Market", "CheckpointInterval", "0");
+		benchmarkIni.SetValue("Virtual Market", "Resume", "");
+		benchmarkIni.SetValue("Virtual Market", "Profiler", "0");
+		benchmarkIni.SetValue("Virtual Market", "TradesLogFilename", "saves/benchmark/trades.tsv");
+		for (size_t i = 0; i < 10; ++i)
+			benchmarkIni.Delete((std::string("Virtual Market Data ") + std::to_string(i + 1)).c_str(), nullptr);
+		// External agents would block the market on their requests and be timed along with it.
+		for (size_t i = 0; i < 255; ++i)
+			benchmarkIni.Delete((std::string("External Agent ") + std::to_string(i + 1)).c_str(), nullptr);
+
+		benchmarkIni.SaveFile(config.configurationFilename.c_str());
+	}
+
+	void Benchmark::report(const std::string &name, uint64_t operations, Clock::duration duration)
+	{
+		const double seconds = std::chrono::duration<double>(duration).count();
+		results.push_back({ name, operations, seconds });
+		std::cout << "\t" << std::left << std::setw(48) << name << std::right
+			<< std::setw(12) << std::fixed << std::setprecision(1) << (operations > 0 ? 1e9 * seconds / operations : 0.0) << " ns/op"
+			<< std::setw(14) << std::setprecision(0) << (seconds > 0.0 ? operations / seconds : 0.0) << " ops/s" << std::endl;
+		std::cout.unsetf(std::ios_base::floatfield);
+	}
+
+	void Benchmark::run()
+	{
+		std::cout << "BENCHMARK: " << symbols.size() << " pairs, " << dates.size() << " days from " << dateToString(dates.front()) << std::endl;
+		if (!generateDays())
+		{
+			removeDays();
+			return;
+		}
+		runMicrobenchmarks();
+		runVirtualMarket();
+		writeResults();
+		removeDays();
+	}
+
+	bool Benchmark::generateDays()
+	{
+		Clock::duration generateTime = Clock::duration::zero();
+		std::vector<Tick> ticks;
+		for (const QuantLib::Date &date : dates)
+		{
+			for (const std::string &symbol : symbols)
+			{
+				const filesystem::path directory = filesystem::path(config.dataFolder) / symbol;
+				const std::string filename = (directory / TradingDay::getSaveFileName(date)).string();
+				if (filesystem::exists(filesystem::path(filename)))
+				{
+					std::cout << "WARNING: The benchmark does not overwrite '" << filename << "'; remove the data folder '" << config.dataFolder << "' first." << std::endl;
+					return false;
+				}
+				filesystem::create_directories(directory);
+
+				Clock::time_point start = Clock::now();
+				generator.generateDay(symbol, date, ticks);
+				generateTime += Clock::now() - start;
+				totalTicks += ticks.size();
+
+				// Same format as TradingDay::serializeTick.
+				std::fstream file(filename.c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+				for (const Tick &tick : ticks)
+					file << tick;
+				file.close();
+				dayFilenames.push_back(filename);
+			}
+		}
+		report("SyntheticTickGenerator::generateDay (ticks)", totalTicks, generateTime);
+		return true;
+	}
+
+	void Benchmark::runMicrobenchmarks()
+	{
+		std::unique_ptr<SimulationContext> context = std::make_unique<SimulationContext>();
+		context->setConfigurationFilename(config.configurationFilename);
+		SimulationContextBinding binding(*context);
+
+		CSimpleIniA ini;
+		ini.LoadFile(config.configurationFilename.c_str());
+		environmentVariables().init(&ini);
+		market().setVirtual(true);
+		market().init(&ini);
+		statistics().init(&ini);
+
+		Stock *stock = market().getStock(symbols.front(), true);
+
+		// Loading. The days are released right away, so every load reads the file.
+		std::vector<std::time_t> times;
+		{ // scope
+			uint64_t loadedTicks = 0;
+			Clock::duration loadTime = Clock::duration::zero();
+			for (const QuantLib::Date &date : dates)
+			{
+				for (const std::string &symbol : symbols)
+				{
+					TradingDay day(date, market().getStock(symbol, true));
+					const Clock::time_point start = Clock::now();
+					day.loadFromFile();
+					loadTime += Clock::now() - start;
+					loadedTicks += day.getTicks().size();
+
+					// The sample times are spread over the first day of the leading pair.
+					if (times.empty() && date == dates.front() && !day.getTicks().empty())
+					{
+						const size_t count = std::min(config.samples, day.getTicks().size());
+						for (size_t i = 0; i < count; ++i)
+							times.push_back(day.getTicks()[i * day.getTicks().size() / count].getTime());
+						times.erase(std::unique(times.begin(), times.end()), times.end());
+					}
+				}
+			}
+			report("TradingDay::loadFromFile (ticks)", loadedTicks, loadTime);
+		}
+
+		// Saving, the way the live market records ticks: the first loaded day of every pair is received again
+		// by the day after the benchmark range.
+		{ // scope
+			const QuantLib::Date saveDate = dates.back() + 1;
+			uint64_t savedTicks = 0;
+			Clock::duration saveTime = Clock::duration::zero();
+			for (const std::string &symbol : symbols)
+			{
+				Stock *savingStock = market().getStock(symbol, true);
+				const std::string filename = TradingDay::getSavePath(savingStock, saveDate);
+				if (filesystem::exists(filesystem::path(filename)))
+				{
+					std::cout << "WARNING: The benchmark does not overwrite '" << filename << "', skipping the save benchmark." << std::endl;
+					break;
+				}
+				TradingDay loaded(dates.front(), savingStock);
+				loaded.loadFromFile();
+
+				// TradingDay only writes ticks outside of the virtual market.
+				market().setVirtual(false);
+				{ // scope
+					TradingDay day(saveDate, savingStock);
+					dayFilenames.push_back(filename);
+					const Clock::time_point start = Clock::now();
+					for (const Tick &tick : loaded.getTicks())
+						day.receiveFreshTick(tick);
+					saveTime += Clock::now() - start;
+				}
+				market().setVirtual(true);
+				savedTicks += loaded.getTicks().size();
+			}
+			report("TradingDay::receiveFreshTick save (ticks)", savedTicks, saveTime);
+		}
+		if (times.empty())
+		{
+			std::cout << "WARNING: No synthetic ticks were generated; increase the tick rate or the hours." << std::endl;
+			context.reset();
+			return;
+		}
+
+		for (const int seconds : { ONEMINUTE, 5 * ONEMINUTE, 15 * ONEMINUTE })
+		{
+			const Clock::time_point start = Clock::now();
+			for (const std::time_t &time : times)
+			{
+				TimePeriod period = stock->getTimePeriod(time - seconds, time);
+				period.getClose();
+				period.getHigh();
+				period.getLow();
+				period.getAverage();
+			}
+			report("TimePeriod close/high/low/average (" + std::to_string(seconds) + "s)", 4 * times.size(), Clock::now() - start);
+		}
+
+		// Every indicator type at least once; the market creates most of them already.
+		{ // scope
+			const std::string &pair = symbols.front();
+			Indicators::get<Indicators::ADX>(pair, 14, ONEMINUTE);
+			Indicators::get<Indicators::ATR>(pair, 14, ONEMINUTE);
+			Indicators::get<Indicators::CCI>(pair, 14, ONEMINUTE);
+			Indicators::get<Indicators::KRI>(pair, 14, ONEMINUTE);
+			Indicators::get<Indicators::LocalRelativeChange>(pair, std::vector<int>({ 15 * ONEMINUTE, 5 * ONEMINUTE, ONEMINUTE, 0 }));
+			Indicators::get<Indicators::Moves>(pair, 14, ONEMINUTE);
+			Indicators::get<Indicators::RSI>(pair, 14, ONEMINUTE);
+			Indicators::get<Indicators::Renko>(pair, 20, 5 * pipSize(pair));
+			Indicators::get<Indicators::SMA>(pair, 14, ONEMINUTE);
+			Indicators::get<Indicators::StochasticOscillator>(pair, 14, ONEMINUTE);
+			Indicators::get<Indicators::TSI>(pair, 14, ONEMINUTE);
+			Indicators::get<Indicators::TargetLookbackMean>(pair, 15);
+		}
+
+		// Updated in market order, as the indicators may depend on each other.
+		{ // scope
+			std::vector<Indicators::Base*> &indicators = market().getIndicators();
+			std::vector<Clock::duration> durations(indicators.size(), Clock::duration::zero());
+			for (const std::time_t &time : times)
+			{
+				for (size_t i = 0; i < indicators.size(); ++i)
+				{
+					const Clock::time_point start = Clock::now();
+					indicators[i]->execute(time - times.front(), time);
+					durations[i] += Clock::now() - start;
+				}
+			}
+
+			std::map<std::string, std::pair<uint64_t, Clock::duration>> byType;
+			for (size_t i = 0; i < indicators.size(); ++i)
+			{
+				std::pair<uint64_t, Clock::duration> &total = byType.emplace(indicators[i]->getTypeName(), std::make_pair(uint64_t(0), Clock::duration::zero())).first->second;
+				total.first += times.size();
+				total.second += durations[i];
+			}
+			for (const auto &type : byType)
+				report(type.first + "::update", type.second.first, type.second.second);
+		}
+
+		{ // scope
+			std::vector<SymbolID> ids;
+			for (const std::string &symbol : symbols)
+				ids.push_back(symbolTable().intern(symbol));
+
+			const QuantLib::Date date = dates.front();
+			const Clock::time_point start = Clock::now();
+			for (const std::time_t &time : times)
+			{
+				for (const SymbolID &id : ids)
+					market().addEvent(Event(Event::NEW_TICK, id, date, time));
+			}
+			report("Market::addEvent", times.size() * ids.size(), Clock::now() - start);
+		}
+
+		{ // scope
+			const size_t variableCount = statistics().getVariables().size();
+			const Clock::time_point start = Clock::now();
+			for (size_t i = 0; i < times.size(); ++i)
+			{
+				statistics().invalidateSnapshot();
+				statistics().log();
+			}
+			statistics().close();
+			report("Statistics::log (" + std::to_string(variableCount) + " variables)", times.size(), Clock::now() - start);
+		}
+
+		// Experts and indicators might still access their market while being destroyed.
+		context.reset();
+	}
+
+	void Benchmark::runVirtualMarket()
+	{
+		std::unique_ptr<TickReplay> replay;
+		std::unique_ptr<SimulationContext> context = std::make_unique<SimulationContext>();
+		context->setConfigurationFilename(config.configurationFilename);
+		SimulationContextBinding binding(*context);
+
+		CSimpleIniA ini;
+		ini.LoadFile(config.configurationFilename.c_str());
+		environmentVariables().init(&ini);
+		market().setVirtual(true);
+		market().init(&ini);
+		statistics().init(&ini);
+		if (!config.logStatistics)
+			statistics().enableLogging(false);
+
+		replay = std::make_unique<TickReplay>();
+		replay->init(&ini);
+		context->virtualMarket.reset(new VirtualMarket());
+		virtualMarket()->init(&ini, replay.get());
+
+		// Same loop as the parameter sweep, with a single market.
+		uint64_t replayedTicks = 0;
+		ReplayBatch batch;
+		const Clock::time_point start = Clock::now();
+		while (true)
+		{
+			if (replay->isDayFinished())
+			{
+				virtualMarket()->finishDay();
+				replay->advanceDay();
+				if (replay->isOutOfPeriod())
+					break;
+			}
+
+			batch.clear();
+			while (batch.steps.size() < 1024 && replay->nextStep(batch));
+			replayedTicks += batch.ticks.size();
+
+			VirtualMarket *vm = virtualMarket();
+			for (size_t step = 0; step < batch.steps.size(); ++step)
+			{
+				vm->processStep(batch, step);
+				market().step();
+			}
+		}
+		virtualMarket()->finish();
+		report("VirtualMarket end-to-end (ticks)", replayedTicks, Clock::now() - start);
+
+		context.reset();
+	}
+
+	void Benchmark::writeResults()
+	{
+		const filesystem::path outputPath(config.outputFilename);
+		if (!outputPath.parent_path().empty())
+			filesystem::create_directories(outputPath.parent_path());
+		const bool exists = filesystem::exists(outputPath) && filesystem::file_size(outputPath) > 0;
+
+		// Appended, so that runs of different builds end up in one table.
+		std::fstream output(config.outputFilename, std::ios_base::out | std::ios_base::app);
+		if (!exists)
+			output << "Label\tTime\tBenchmark\tOperations\tSeconds\tns/op\tops/s" << std::endl;
+
+		const std::time_t now = std::time(nullptr);
+		output << std::setprecision(10);
+		for (const Result &result : results)
+		{
+			output << config.label << "\t" << now << "\t" << result.name << "\t" << result.operations << "\t" << result.seconds
+				<< "\t" << (result.operations > 0 ? 1e9 * result.seconds / result.operations : 0.0)
+				<< "\t" << (result.seconds > 0.0 ? result.operations / result.seconds : 0.0) << std::endl;
+		}
+		std::cout << "BENCHMARK: results written to " << config.outputFilename << std::endl;
+	}
+
+	void Benchmark::removeDays()
+	{
+		if (config.keepData) return;
+		for (const std::string &filename : dayFilenames)
+			std::remove(filename.c_str());
+	}
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include <ql/time/date.hpp>
+
+#include "SyntheticTicks.h"
+
+namespace MM
+{
+	/*
+		Performance benchmarks on synthetic data (see SyntheticTickGenerator).
+		The configured days are generated and saved as tick data in a separate data folder, then the day loading, TimePeriod queries,
+		every indicator update, Market::addEvent and Statistics::log are timed in isolation. Finally, a complete virtual market
+		runs through the generated period.
+		Every benchmark appends one row (operations, seconds, ns/op, ops/s) to the output, so that builds can be compared.
+	*/
+	class Benchmark
+	{
+	public:
+		static bool isEnabled(void *ini);
+		void init(void *ini);
+		void run();
+
+	private:
+		typedef std::chrono::high_resolution_clock Clock;
+
+		struct Result
+		{
+			std::string name;
+			uint64_t operations;
+			double seconds;
+		};
+		std::vector<Result> results;
+		void report(const std::string &name, uint64_t operations, Clock::duration duration);
+
+		SyntheticTickGenerator generator;
+		std::vector<std::string> symbols;
+		std::vector<QuantLib::Date> dates;
+		// Of the generated files.
+		std::vector<std::string> dayFilenames;
+		uint64_t totalTicks = 0;
+
+		struct _config
+		{
+			std::string label;
+			std::string outputFilename;
+			std::string configurationFilename;
+			// The market's data folder while benchmarking; the generated days never go to the regular one.
+			std::string dataFolder = "saves/benchmark/data";
+			// Points in time of the first day that the microbenchmarks query.
+			size_t samples = 20000;
+			bool logStatistics = false;
+			bool keepData = false;
+		} config;
+
+		void writeConfiguration(void *ini);
+		// False if a day file exists already.
+		bool generateDays();
+		void runMicrobenchmarks();
+		void runVirtualMarket();
+		void writeResults();
+		void removeDays();
+	};
+};
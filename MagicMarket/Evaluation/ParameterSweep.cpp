@@ -0,0 +1,246 @@
+#include "ParameterSweep.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <filesystem>
+namespace filesystem = std::tr2::sys;
+
+#include <SimpleIni.h>
+
+#include "EnvironmentVariables.h"
+#include "Market.h"
+#include "SimulationContext.h"
+#include "Statistics.h"
+#include "VirtualMarket.h"
+
+namespace MM
+{
+	ParameterSweep::ParameterSweep()
+	{
+	}
+
+	ParameterSweep::~ParameterSweep()
+	{
+		// Experts and indicators might still access their market while being destroyed.
+		for (Variant &variant : variants)
+		{
+			SimulationContextBinding binding(*variant.context);
+			variant.context.reset();
+		}
+	}
+
+	bool ParameterSweep::isEnabled(void *_ini)
+	{
+		const CSimpleIniA &ini = *(CSimpleIniA*)_ini;
+		return ini.GetBoolValue("Parameter Sweep", "Enabled", false);
+	}
+
+	std::vector<double> ParameterSweep::parseRange(const std::string &definition)
+	{
+		std::vector<double> values;
+
+		if (definition.find(':') != std::string::npos)
+		{
+			double from = 0.0, to = 0.0, step = 1.0;
+			char separator;
+			std::istringstream is(definition);
+			is >> from >> separator >> to;
+			if (is >> separator) is >> step;
+
+			if (step <= 0.0 || to < from)
+			{
+				std::cout << "WARNING: Invalid parameter range '" << definition << "'." << std::endl;
+				values.push_back(from);
+				return values;
+			}
+			// Tolerate rounding errors at the inclusive end.
+			const size_t count = static_cast<size_t>(std::floor((to - from) / step + 1e-9)) + 1;
+			for (size_t i = 0; i < count; ++i)
+				values.push_back(from + static_cast<double>(i) * step);
+			return values;
+		}
+
+		std::istringstream is(definition);
+		std::string value;
+		while (std::getline(is, value, ','))
+		{
+			if (value.empty()) continue;
+			values.push_back(std::stod(value));
+		}
+		return values;
+	}
+
+	void ParameterSweep::init(void *_ini)
+	{
+		const CSimpleIniA &ini = *(CSimpleIniA*)_ini;
+		config.batchSteps = std::max(1L, ini.GetLongValue("Parameter Sweep", "BatchSteps", static_cast<long>(config.batchSteps)));
+		config.threads = std::max(1L, ini.GetLongValue("Parameter Sweep", "Threads", static_cast<long>(config.threads)));
+		config.logStatistics = ini.GetBoolValue("Parameter Sweep", "LogStatistics", false);
+		config.summaryFilename = environmentVariables().replace(ini.GetValue("Parameter Sweep", "SummaryFilename", "saves/sweep/summary.tsv"));
+
+		// The replay belongs to the bound (driving) context; its market only holds the stocks of the replayed days.
+		market().setVirtual(true);
+		market().setSaveFolderName(environmentVariables().replace(ini.GetValue("Market", "DataFolder", "saves")));
+		replay = std::make_unique<TickReplay>();
+		replay->init(_ini);
+
+		createVariants(_ini);
+		std::cout << "PARAMETER SWEEP: " << variants.size() << " variants" << std::endl;
+
+		for (size_t i = 0; i < variants.size(); ++i)
+			initVariant(i, _ini);
+	}
+
+	void ParameterSweep::createVariants(void *_ini)
+	{
+		const CSimpleIniA &ini = *(CSimpleIniA*)_ini;
+
+		CSimpleIniA::TNamesDepend keys;
+		ini.GetAllKeys("Parameter Sweep Ranges", keys);
+		keys.sort(CSimpleIniA::Entry::LoadOrder());
+
+		std::vector<std::vector<double>> ranges;
+		for (const CSimpleIniA::Entry &key : keys)
+		{
+			std::vector<double> values = parseRange(ini.GetValue("Parameter Sweep Ranges", key.pItem, ""));
+			if (values.empty()) continue;
+			parameterNames.push_back(key.pItem);
+			ranges.push_back(std::move(values));
+		}
+
+		// Cartesian product of all ranges; the last parameter changes fastest.
+		std::vector<size_t> indices(ranges.size(), 0);
+		while (true)
+		{
+			Variant variant;
+			for (size_t i = 0; i < ranges.size(); ++i)
+				variant.parameters[parameterNames[i]] = ranges[i][indices[i]];
+			variants.push_back(std::move(variant));
+
+			size_t digit = ranges.size();
+			while (digit > 0)
+			{
+				--digit;
+				if (++indices[digit] < ranges[digit].size()) break;
+				indices[digit] = 0;
+				if (digit == 0) return;
+			}
+			if (ranges.empty()) return;
+		}
+	}
+
+	void ParameterSweep::initVariant(size_t index, void *_ini)
+	{
+		Variant &variant = variants[index];
+		variant.context = std::make_unique<SimulationContext>();
+		variant.context->setConfigurationFilename(SimulationContext::current().getConfigurationFilename());
+
+		SimulationContextBinding binding(*variant.context);
+		environmentVariables().init(_ini);
+		environmentVariables().set("SWEEP_VARIANT", std::to_string(index));
+
+		market().setParameters(variant.parameters);
+		market().setExternalAgentsEnabled(false);
+		market().init(_ini);
+		statistics().init(_ini);
+		if (!config.logStatistics)
+			statistics().enableLogging(false);
+
+		variant.context->virtualMarket.reset(new VirtualMarket());
+		virtualMarket()->init(_ini, replay.get());
+	}
+
+	template<typename Function> void ParameterSweep::forEachVariant(const Function &function)
+	{
+		auto processRange = [this, &function](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				SimulationContextBinding binding(*variants[i].context);
+				function();
+			}
+		};
+
+		const size_t threadCount = std::min(config.threads, variants.size());
+		if (threadCount <= 1)
+		{
+			processRange(0, variants.size());
+			return;
+		}
+
+		// The variants only read the replayed data, so they can be processed concurrently.
+		std::vector<std::thread> threads;
+		const size_t perThread = (variants.size() + threadCount - 1) / threadCount;
+		for (size_t begin = 0; begin < variants.size(); begin += perThread)
+			threads.emplace_back(processRange, begin, std::min(begin + perThread, variants.size()));
+		for (std::thread &thread : threads)
+			thread.join();
+	}
+
+	void ParameterSweep::run()
+	{
+		while (true)
+		{
+			if (replay->isDayFinished())
+			{
+				forEachVariant([]() { virtualMarket()->finishDay(); });
+				std::cout << "\r\t" << replay->getDate() << " done." << std::flush;
+				replay->advanceDay();
+
+				if (replay->isOutOfPeriod())
+					break;
+			}
+
+			batch.clear();
+			while (batch.steps.size() < config.batchSteps && replay->nextStep(batch));
+
+			forEachVariant([this]()
+			{
+				VirtualMarket *vm = virtualMarket();
+				Market &variantMarket = market();
+				for (size_t step = 0; step < batch.steps.size(); ++step)
+				{
+					vm->processStep(batch, step);
+					variantMarket.step();
+				}
+			});
+		}
+		std::cout << std::endl;
+
+		forEachVariant([]() { virtualMarket()->finish(); });
+		writeSummary();
+	}
+
+	void ParameterSweep::writeSummary()
+	{
+		filesystem::path outputPath = filesystem::path(config.summaryFilename).parent_path();
+		if (!outputPath.empty())
+			filesystem::create_directories(outputPath);
+		std::fstream output(config.summaryFilename, std::ios_base::out | std::ios_base::trunc);
+
+		output << "Variant";
+		for (const std::string &name : parameterNames)
+			output << "\t" << name;
+		output << "\tProfit\tWon Trades\tLost Trades" << std::endl;
+
+		size_t bestVariant = 0;
+		for (size_t i = 0; i < variants.size(); ++i)
+		{
+			const VirtualMarket &vm = *variants[i].context->virtualMarket;
+			output << i;
+			for (const std::string &name : parameterNames)
+				output << "\t" << variants[i].parameters.at(name);
+			output << "\t" << vm.getTotalProfitPips() << "\t" << vm.getWonTrades() << "\t" << vm.getLostTrades() << std::endl;
+
+			if (vm.getTotalProfitPips() > variants[bestVariant].context->virtualMarket->getTotalProfitPips())
+				bestVariant = i;
+		}
+
+		if (!variants.empty())
+			std::cout << "BEST VARIANT: " << bestVariant << " with " << variants[bestVariant].context->virtualMarket->getTotalProfitPips() << " pips" << std::endl;
+	}
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "TickReplay.h"
+
+namespace MM
+{
+	class SimulationContext;
+
+	/*
+		Runs many parameterized variants of the experts through a single replay of the tick data.
+		Every variant is a complete simulation context with its own market, experts, indicators, account and trade log.
+		The parameters are taken from the [Parameter Sweep Ranges] section (see Market::getParameter); every combination
+		of the values becomes one variant.
+		The replay collects a batch of virtual market steps once and every variant then processes the whole batch.
+	*/
+	class ParameterSweep
+	{
+	public:
+		ParameterSweep();
+		~ParameterSweep();
+
+		static bool isEnabled(void *ini);
+		// Has to be called with the context bound that the replay should use.
+		void init(void *ini);
+		void run();
+
+		// Accepts "from:to:step" (inclusive), comma separated lists and single values.
+		static std::vector<double> parseRange(const std::string &definition);
+
+	private:
+		struct Variant
+		{
+			std::map<std::string, double> parameters;
+			std::unique_ptr<SimulationContext> context;
+		};
+		std::vector<Variant> variants;
+		std::vector<std::string> parameterNames;
+
+		std::unique_ptr<TickReplay> replay;
+		ReplayBatch batch;
+
+		struct _config
+		{
+			size_t batchSteps = 4096;
+			size_t threads = 1;
+			bool logStatistics = false;
+			std::string summaryFilename;
+		} config;
+
+		void createVariants(void *ini);
+		void initVariant(size_t index, void *ini);
+		// Calls the function for every variant with its context bound, distributed over the configured threads.
+		template<typename Function> void forEachVariant(const Function &function);
+		void writeSummary();
+	};
+};
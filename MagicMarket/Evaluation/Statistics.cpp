@@ -7,13 +7,57 @@ namespace filesystem = std::tr2::sys;
 #include "Market.h"
 #include <SimpleIni.h>
 #include "VirtualMarket.h"
+#include "VM/Profiler.h"
+#include "IO/ColumnarWriter.h"
+#include "IO/Snapshot.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <iterator>
+#include <limits>
 #include <sstream>
-
-MM::Statistics statistics;
+#if defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+#endif
 
 namespace MM
 {
+	namespace
+	{
+		const size_t CSV_WRITE_BLOCK_SIZE = 1 << 20;
+
+		void appendNumber(std::string &output, double value)
+		{
+			if (std::isnan(value))
+			{
+				output += "nan";
+				return;
+			}
+			char buffer[64];
+#if defined(__cpp_lib_to_chars)
+			const std::to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+			if (result.ec == std::errc())
+			{
+				output.append(buffer, result.ptr);
+				return;
+			}
+#else
+			// Same formatting as std::to_string, without the temporary string.
+			const int length = std::snprintf(buffer, sizeof(buffer), "%f", value);
+			if (length > 0 && length < static_cast<int>(sizeof(buffer)))
+			{
+				output.append(buffer, length);
+				return;
+			}
+#endif
+			output += std::to_string(value);
+		}
+	};
+
 	std::string Variable::getS() const
 	{
 		const double val = get();
@@ -39,7 +83,12 @@ namespace MM
 	void Statistics::close()
 	{
 		if (outputStream.is_open())
+		{
+			flushRowBuffer();
 			outputStream.close();
+		}
+		if (binaryWriter)
+			binaryWriter->close();
 	}
 
 	void Statistics::init(void *_ini)
@@ -52,13 +101,24 @@ namespace MM
 			config.delimiter = "\t";
 		else if (config.delimiter == "space")
 			config.delimiter = " ";
+
+		const std::string format = ini.GetValue("Statistics", "Format", "csv");
+		if (format == "binary")
+			config.format = OutputFormat::BINARY;
+		else if (format != "csv")
+			std::cout << "WARNING: Unknown statistics format '" << format << "', using csv." << std::endl;
+		config.flushEveryRow = ini.GetBoolValue("Statistics", "FlushEveryRow", false);
+		config.chunkRows = static_cast<size_t>(ini.GetLongValue("Statistics", "ChunkRows", static_cast<long>(config.chunkRows)));
 	}
 
 	void Statistics::addVariable(const Variable &var)
 	{
-		const size_t duplicateCount = std::count_if(variables.begin(), variables.end(), [&](const Variable &other) { return other.originalName == var.name; }); 
+		const size_t duplicateCount = originalNameCounts[var.name]++;
+		const VariableID id = variables.size();
 
 		variables.push_back(var);
+		variableIndex.emplace(makeKey(var.originalName, var.description), id);
+		sortedByName.clear();
 
 		if (duplicateCount > 0)
 		{
@@ -70,51 +130,326 @@ namespace MM
 
 	Variable Statistics::getVariableByNameDescription(std::string name, std::string desc) const
 	{
-		auto found = std::find_if(variables.begin(), variables.end(), [&](const Variable &var) { return var.originalName == name && var.description == desc; });
-		if (found != variables.end()) return *found;
+		const VariableID id = findVariable(name, desc);
+		if (id != INVALID_VARIABLE) return variables[id];
 
 		// Return a NaN-variable
 		return Variable::NaN();
 	}
 
+	VariableID Statistics::findVariable(const std::string &name, const std::string &desc) const
+	{
+		auto found = variableIndex.find(makeKey(name, desc));
+		if (found == variableIndex.end()) return INVALID_VARIABLE;
+		return found->second;
+	}
+
+	const std::vector<VariableID> &Statistics::getSortedByName() const
+	{
+		if (sortedByName.size() != variables.size())
+		{
+			sortedByName.resize(variables.size());
+			for (VariableID id = 0; id < variables.size(); ++id)
+				sortedByName[id] = id;
+			std::sort(sortedByName.begin(), sortedByName.end(), [&](VariableID a, VariableID b) { return variables[a].name < variables[b].name; });
+		}
+		return sortedByName;
+	}
+
+	std::vector<VariableID> Statistics::findVariablesByPrefix(const std::string &prefix) const
+	{
+		const std::vector<VariableID> &sorted = getSortedByName();
+		auto begin = std::lower_bound(sorted.begin(), sorted.end(), prefix, [&](VariableID id, const std::string &value) { return variables[id].name < value; });
+		auto end = begin;
+		while (end != sorted.end() && variables[*end].name.compare(0, prefix.size(), prefix) == 0)
+			++end;
+		return std::vector<VariableID>(begin, end);
+	}
+
+	std::vector<VariableID> Statistics::findVariablesByPattern(const std::string &pattern) const
+	{
+		// Everything up to the first wildcard narrows down the range in the sorted index.
+		const std::string prefix = pattern.substr(0, pattern.find_first_of("*?"));
+		if (prefix.size() == pattern.size())
+		{
+			std::vector<VariableID> result;
+			for (const VariableID id : findVariablesByPrefix(prefix))
+				if (variables[id].name == pattern) result.push_back(id);
+			return result;
+		}
+
+		std::function<bool(const char*, const char*)> matches = [&](const char *p, const char *s) -> bool
+		{
+			for (; *p != '\0'; ++p, ++s)
+			{
+				if (*p == '*')
+				{
+					for (const char *rest = s;; ++rest)
+					{
+						if (matches(p + 1, rest)) return true;
+						if (*rest == '\0') return false;
+					}
+				}
+				if (*s == '\0' || (*p != '?' && *p != *s)) return false;
+			}
+			return *s == '\0';
+		};
+
+		std::vector<VariableID> result;
+		for (const VariableID id : findVariablesByPrefix(prefix))
+			if (matches(pattern.c_str(), variables[id].name.c_str())) result.push_back(id);
+		return result;
+	}
+
+	void Statistics::compile()
+	{
+		directIDs.clear();
+		directSources.clear();
+		computedIDs.clear();
+		for (VariableID id = 0; id < variables.size(); ++id)
+		{
+			const double *source = variables[id].getSource();
+			if (source != nullptr)
+			{
+				directIDs.push_back(id);
+				directSources.push_back(source);
+			}
+			else
+				computedIDs.push_back(id);
+		}
+		snapshot.assign(variables.size(), std::numeric_limits<double>::quiet_NaN());
+		snapshotValid = false;
+	}
+
+	void Statistics::refreshSnapshot()
+	{
+		if (snapshot.size() != variables.size())
+			compile();
+
+		double * const row = snapshot.data();
+		const size_t directCount = directSources.size();
+		for (size_t i = 0; i < directCount; ++i)
+			row[directIDs[i]] = *directSources[i];
+		for (const VariableID id : computedIDs)
+			row[id] = variables[id].get();
+		snapshotValid = true;
+	}
+
+	const double *Statistics::getSnapshot()
+	{
+		if (!snapshotValid || snapshot.size() != variables.size())
+			refreshSnapshot();
+		return snapshot.data();
+	}
+
 	void Statistics::log()
 	{
 		if (!loggingActive) return;
 
+		static const vm::ZoneID profilerZone = vm::Profiler::registerZone("Statistics::log");
+		vm::ProfilerZone zone(profilerZone);
+
 		// try to open for the very first time?
-		if (!outputStream.is_open())
-		{
-			// Allow name replacements.
-			config.outputFilename = environmentVariables.replace(config.outputFilename);
-			// And make sure the folder exists.
-			filesystem::path outputPath = filesystem::path(config.outputFilename).parent_path();
-			filesystem::create_directories(outputPath);
-			// log variable descriptions
-			std::fstream descriptionStream(config.outputFilename + ".info", std::ios_base::out);
-			// open real stream
-			outputStream.open(config.outputFilename, std::ios_base::out);
-			if (!outputStream.good()) return;
-
-			// print header row
-			descriptionStream << "name" << config.delimiter << "description" << std::endl;
-			outputStream << "time";
-			for (const Variable &var : variables)
+		if (!isOutputOpen() && !openOutput()) return;
+
+		const std::time_t time = market().getLastTickTime();
+		const double *row = getSnapshot();
+		if (!columnsMatchSnapshot)
+		{
+			for (size_t i = 0; i < columns.size(); ++i)
+				columnValues[i] = (columns[i] != INVALID_VARIABLE) ? row[columns[i]] : std::numeric_limits<double>::quiet_NaN();
+			row = columnValues.data();
+		}
+
+		if (config.format == OutputFormat::BINARY)
+		{
+			binaryWriter->appendRow(static_cast<int64_t>(time), row);
+			return;
+		}
+
+		// get all observations and log them
+		rowBuffer += std::to_string(time);
+		for (size_t i = 0; i < columns.size(); ++i)
+		{
+			rowBuffer += config.delimiter;
+			appendNumber(rowBuffer, row[i]);
+		}
+		rowBuffer += '\n';
+
+		if (config.flushEveryRow || rowBuffer.size() >= CSV_WRITE_BLOCK_SIZE)
+			flushRowBuffer();
+	}
+
+	bool Statistics::isOutputOpen() const
+	{
+		if (config.format == OutputFormat::BINARY)
+			return binaryWriter && binaryWriter->isOpen();
+		return outputStream.is_open();
+	}
+
+	bool Statistics::openOutput()
+	{
+		// Allow name replacements.
+		config.outputFilename = environmentVariables().replace(config.outputFilename);
+		// And make sure the folder exists.
+		filesystem::path outputPath = filesystem::path(config.outputFilename).parent_path();
+		filesystem::create_directories(outputPath);
+
+		const std::string infoFilename = config.outputFilename + ".info";
+		std::vector<std::pair<std::string, std::string>> columnHeaders;
+		assignColumns(infoFilename, columnHeaders);
+
+		// log variable descriptions together with their column IDs; the binary format embeds them as its schema
+		std::ostringstream description;
+		description << "name" << config.delimiter << "description" << config.delimiter << "id" << std::endl;
+		for (size_t i = 0; i < columnHeaders.size(); ++i)
+			description << columnHeaders[i].first << config.delimiter << columnHeaders[i].second << config.delimiter << i << std::endl;
+		const std::string schema = description.str();
+		{ // scope
+			std::fstream descriptionStream(infoFilename, std::ios_base::out);
+			descriptionStream << schema;
+		}
+
+		if (resumePosition && resumeOutput())
+			return true;
+
+		if (config.format == OutputFormat::BINARY)
+		{
+			binaryWriter = std::make_unique<io::ColumnarWriter>();
+			return binaryWriter->open(config.outputFilename, schema, columns.size(), config.chunkRows);
+		}
+
+		// open real stream
+		outputStream.open(config.outputFilename, std::ios_base::out);
+		if (!outputStream.good()) return false;
+
+		// print header row
+		rowBuffer = "time";
+		for (const std::pair<std::string, std::string> &header : columnHeaders)
+		{
+			rowBuffer += config.delimiter;
+			rowBuffer += header.first;
+		}
+		rowBuffer += '\n';
+		flushRowBuffer();
+		return true;
+	}
+
+	void Statistics::assignColumns(const std::string &infoFilename, std::vector<std::pair<std::string, std::string>> &columnHeaders)
+	{
+		columns.clear();
+		columnHeaders.clear();
+
+		std::unordered_map<std::string, VariableID> byColumnHeader;
+		for (VariableID id = 0; id < variables.size(); ++id)
+			byColumnHeader.emplace(makeKey(variables[id].name, variables[id].originalName + " " + variables[id].description), id);
+		std::vector<bool> assigned(variables.size(), false);
+
+		// Keep the column order of the previous run. Files without an id column are taken in line order.
+		std::ifstream previousInfo(infoFilename);
+		std::string line;
+		if (previousInfo.good() && std::getline(previousInfo, line))
+		{
+			const bool hasIDColumn = (line == "name" + config.delimiter + "description" + config.delimiter + "id");
+			while (std::getline(previousInfo, line))
 			{
-				outputStream << config.delimiter << var.name;
+				const size_t nameEnd = line.find(config.delimiter);
+				if (nameEnd == std::string::npos) continue;
+				const size_t descriptionEnd = hasIDColumn ? line.rfind(config.delimiter) : line.size();
 
-				descriptionStream << var.name << config.delimiter << var.originalName << " " << var.description << std::endl;
+				const std::string name = line.substr(0, nameEnd);
+				const size_t descriptionBegin = nameEnd + config.delimiter.size();
+				const std::string description = line.substr(descriptionBegin, descriptionEnd - descriptionBegin);
+
+				auto found = byColumnHeader.find(makeKey(name, description));
+				if (found != byColumnHeader.end() && !assigned[found->second])
+				{
+					assigned[found->second] = true;
+					columns.push_back(found->second);
+				}
+				else
+					columns.push_back(INVALID_VARIABLE);
+				columnHeaders.emplace_back(name, description);
 			}
-			outputStream << std::endl << std::flush;
 		}
 
-		// get all observations and log them
-		outputStream << market.getLastTickTime();
+		for (VariableID id = 0; id < variables.size(); ++id)
+		{
+			if (assigned[id]) continue;
+			columns.push_back(id);
+			columnHeaders.emplace_back(variables[id].name, variables[id].originalName + " " + variables[id].description);
+		}
+
+		columnsMatchSnapshot = true;
+		for (size_t i = 0; i < columns.size(); ++i)
+			columnsMatchSnapshot = columnsMatchSnapshot && (columns[i] == i);
+		columnsMatchSnapshot = columnsMatchSnapshot && (columns.size() == variables.size());
+		columnValues.resize(columns.size());
+	}
+
+	void Statistics::flushRowBuffer()
+	{
+		if (rowBuffer.empty()) return;
+		outputStream.write(rowBuffer.data(), rowBuffer.size());
+		outputStream.flush();
+		rowBuffer.clear();
+	}
+
+	void Statistics::serialize(io::SnapshotWriter &writer)
+	{
+		const bool open = loggingActive && isOutputOpen();
+		writer.write(static_cast<uint8_t>(config.format));
+		writer.write(open);
+		if (!open) return;
+
+		if (config.format == OutputFormat::BINARY)
+		{
+			binaryWriter->serialize(writer);
+			return;
+		}
+		flushRowBuffer();
+		writer.write(static_cast<uint64_t>(columns.size()));
+		writer.write(static_cast<uint64_t>(outputStream.tellp()));
+	}
+
+	void Statistics::deserialize(io::SnapshotReader &reader)
+	{
+		const OutputFormat format = static_cast<OutputFormat>(reader.read<uint8_t>());
+		const bool open = reader.read<bool>();
+		// Without any output written so far, there is nothing to continue.
+		if (!reader.good() || !open) return;
+		if (format != config.format)
+		{
+			std::cout << "WARNING: Statistics format differs from the checkpoint, the output is rewritten." << std::endl;
+			return;
+		}
+		resumePosition = std::make_unique<io::SnapshotReader>(reader);
+	}
+
+	bool Statistics::resumeOutput()
+	{
+		std::unique_ptr<io::SnapshotReader> position = std::move(resumePosition);
+
+		if (config.format == OutputFormat::BINARY)
+		{
+			binaryWriter = std::make_unique<io::ColumnarWriter>();
+			if (binaryWriter->resume(config.outputFilename, columns.size(), config.chunkRows, *position))
+				return true;
+			std::cout << "WARNING: Could not continue the statistics output '" << config.outputFilename << "', the output is rewritten." << std::endl;
+			return false;
+		}
 
-		for (const Variable &var : variables)
+		// Rows after the checkpoint are dropped; the header is already there.
+		const uint64_t columnCount = position->read<uint64_t>();
+		const uint64_t size = position->read<uint64_t>();
+		const filesystem::path outputPath(config.outputFilename);
+		if (!position->good() || columnCount != columns.size() || !filesystem::exists(outputPath) || filesystem::file_size(outputPath) < size)
 		{
-			outputStream << config.delimiter << var.getS();
+			std::cout << "WARNING: Could not continue the statistics output '" << config.outputFilename << "', the output is rewritten." << std::endl;
+			return false;
 		}
-		// flush file to allow killing the application without losses
-		outputStream << std::endl << std::flush;
+		filesystem::resize_file(outputPath, size);
+		outputStream.open(config.outputFilename, std::ios_base::out | std::ios_base::app);
+		return outputStream.good();
 	}
 };
\ No newline at end of file
@@ -2,22 +2,30 @@
 
 #include <string>
 #include <map>
+#include <unordered_map>
 #include <vector>
 
 #include <functional>
 #include <fstream>
+#include <memory>
 
 namespace MM
 {
+	namespace io
+	{
+		class ColumnarWriter;
+		class SnapshotWriter;
+		class SnapshotReader;
+	};
 
 	struct Variable
 	{
 		Variable(std::string name, std::function<double()> accessor, std::string description) : 
-			name(name), originalName(name), accessor(accessor), description(description) {}
+			name(name), originalName(name), description(description), accessor(accessor), source(nullptr) {}
 		Variable(std::string name, const double *source, std::string description) : 
-			Variable(name, std::bind([source] { return *source; }), description) {};
+			name(name), originalName(name), description(description), source(source) {};
 
-		double get() const { return accessor(); }
+		double get() const { return (source != nullptr) ? *source : accessor(); }
 		std::string getS() const;
 		std::string name;
 		std::string originalName;
@@ -25,10 +33,17 @@ namespace MM
 
 		static Variable NaN();
 		bool isNan() { return originalName == "NaN"; }
+		// Direct variables can be read without calling an accessor.
+		const double *getSource() const { return source; }
 	private:
 		std::function<double()> accessor;
+		const double *source;
 	};
 
+	// Index into Statistics::getVariables() and into the snapshot row. Assigned in registration order.
+	typedef size_t VariableID;
+	const VariableID INVALID_VARIABLE = static_cast<VariableID>(-1);
+
 	class Statistics
 	{
 	public:
@@ -40,23 +55,92 @@ namespace MM
 		void enableLogging(bool enable = true) { loggingActive = enable; }
 		void log();
 		void init(void *ini);
+		// Checkpointing of the output position, see VirtualMarket. A restored output is continued when it is opened.
+		void serialize(io::SnapshotWriter &writer);
+		void deserialize(io::SnapshotReader &reader);
 
 		Variable getVariableByNameDescription(std::string name, std::string desc) const;
+		// Looks up by original name and description.
+		VariableID findVariable(const std::string &name, const std::string &desc) const;
+		// Query the (unique) variable names. Results are sorted by name.
+		std::vector<VariableID> findVariablesByPrefix(const std::string &prefix) const;
+		// Supports '*' and '?'.
+		std::vector<VariableID> findVariablesByPattern(const std::string &pattern) const;
 
 		const std::vector<Variable> & getVariables() { return variables; };
 
+		// Splits the variables into direct pointer sources and computed accessors. Called once all exports are declared;
+		// variables that are added later are picked up automatically.
+		void compile();
+		// Has to be called whenever exported values may have changed, i.e. after indicators or experts were executed.
+		void invalidateSnapshot() { snapshotValid = false; }
+		// Values of all variables, indexed by VariableID. Refreshed in a single pass if invalidated.
+		const double *getSnapshot();
+		// The current value of one variable, without the snapshot. For readers of a few variables, e.g. experts.
+		double getValue(VariableID id) const { return variables[id].get(); }
+
 	private:
 		std::vector<Variable> variables;
+
+		// Keyed by originalName + '\x1f' + description.
+		std::unordered_map<std::string, VariableID> variableIndex;
+		// Number of variables per original name; used to generate unique names.
+		std::unordered_map<std::string, size_t> originalNameCounts;
+		// Variable IDs sorted by name for range queries. Rebuilt lazily.
+		mutable std::vector<VariableID> sortedByName;
+		static std::string makeKey(const std::string &name, const std::string &desc) { return name + '\x1f' + desc; }
+		const std::vector<VariableID> &getSortedByName() const;
+
+		// The compiled snapshot.
+		std::vector<double> snapshot;
+		std::vector<VariableID> directIDs;
+		std::vector<const double*> directSources;
+		std::vector<VariableID> computedIDs;
+		bool snapshotValid = false;
+		void refreshSnapshot();
 		bool loggingActive;
 		std::fstream outputStream;
 
+		enum class OutputFormat
+		{
+			CSV,
+			BINARY
+		};
+
 		struct c_{
 			std::string outputFilename;
 			std::string delimiter;
+			OutputFormat format = OutputFormat::CSV;
+			// Flushing every row allows killing the application without losses but is slow.
+			bool flushEveryRow = false;
+			size_t chunkRows = 3600;
 		} config;
+
+		bool openOutput();
+		bool isOutputOpen() const;
+
+		// CSV rows are collected here and written in large blocks.
+		std::string rowBuffer;
+		void flushRowBuffer();
+
+		std::unique_ptr<io::ColumnarWriter> binaryWriter;
+		// Output position of a restored checkpoint. Applied by openOutput().
+		std::unique_ptr<io::SnapshotReader> resumePosition;
+		bool resumeOutput();
+
+		/*
+			Output columns, fixed when the output is opened. Columns of a previous run (as listed in its .info file) keep
+			their position; variables that do not exist anymore are logged as NaN (INVALID_VARIABLE) and new ones are appended.
+		*/
+		std::vector<VariableID> columns;
+		// Whether columns[i] == i, which allows logging the snapshot row directly.
+		bool columnsMatchSnapshot = true;
+		std::vector<double> columnValues;
+		void assignColumns(const std::string &infoFilename, std::vector<std::pair<std::string, std::string>> &columnHeaders);
 	};
 
 };
 
 
-extern MM::Statistics statistics;
\ No newline at end of file
+// Of the simulation bound to the calling thread, see SimulationContext.
+MM::Statistics &statistics();
\ No newline at end of file
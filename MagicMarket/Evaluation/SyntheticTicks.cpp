@@ -0,0 +1,129 @@
+#include "SyntheticTicks.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <random>
+
+#include <SimpleIni.h>
+
+namespace MM
+{
+	namespace
+	{
+		struct SymbolDefinition
+		{
+			const char *name;
+			double startPrice;
+		};
+		const SymbolDefinition KNOWN_SYMBOLS[] =
+		{
+			{ "EURUSD", 1.10 },
+			{ "EURCHF", 1.08 },
+			{ "EURGBP", 0.78 },
+			{ "GBPUSD", 1.40 },
+			{ "USDCHF", 0.98 },
+			{ "USDJPY", 110.0 }
+		};
+		const size_t KNOWN_SYMBOL_COUNT = sizeof(KNOWN_SYMBOLS) / sizeof(KNOWN_SYMBOLS[0]);
+
+		const double SECONDS_PER_YEAR = 365.0 * 24.0 * 3600.0;
+	};
+
+	void SyntheticTickGenerator::init(void *_ini)
+	{
+		const CSimpleIniA &ini = *(CSimpleIniA*)_ini;
+		config.tickRate = std::max(1e-3, ini.GetDoubleValue("Benchmark", "TickRate", config.tickRate));
+		config.excitation = std::max(0.0, ini.GetDoubleValue("Benchmark", "Excitation", config.excitation));
+		config.decay = std::max(1e-3, ini.GetDoubleValue("Benchmark", "Decay", config.decay));
+		config.volatility = std::max(0.0, ini.GetDoubleValue("Benchmark", "Volatility", config.volatility));
+		config.spread = std::max(0.0, ini.GetDoubleValue("Benchmark", "Spread", config.spread));
+		config.gapProbability = std::max(0.0, ini.GetDoubleValue("Benchmark", "GapProbability", config.gapProbability));
+		config.gapSeconds = std::max(1, static_cast<int>(ini.GetLongValue("Benchmark", "GapSeconds", config.gapSeconds)));
+		config.seed = static_cast<uint64_t>(ini.GetLongValue("Benchmark", "Seed", static_cast<long>(config.seed)));
+
+		std::string hourString = ini.GetValue("Benchmark", "Hours", "0-24");
+		sscanf_s(hourString.c_str(), "%d-%d", &config.fromHour, &config.toHour);
+		config.fromHour = std::min(std::max(config.fromHour, 0), 24);
+		config.toHour = std::min(std::max(config.toHour, config.fromHour), 24);
+
+		if (config.excitation >= config.decay)
+		{
+			std::cout << "WARNING: Tick arrivals explode with an excitation of at least the decay; using " << 0.9 * config.decay << "." << std::endl;
+			config.excitation = 0.9 * config.decay;
+		}
+	}
+
+	std::string SyntheticTickGenerator::getSymbolName(size_t index)
+	{
+		if (index < KNOWN_SYMBOL_COUNT)
+			return KNOWN_SYMBOLS[index].name;
+		char name[16];
+		std::snprintf(name, sizeof(name), "SYN%03d", static_cast<int>(index));
+		return name;
+	}
+
+	void SyntheticTickGenerator::generateDay(const std::string &currencyPair, const QuantLib::Date &date, std::vector<Tick> &ticks) const
+	{
+		ticks.clear();
+
+		double price = 1.0;
+		for (const SymbolDefinition &symbol : KNOWN_SYMBOLS)
+		{
+			if (currencyPair == symbol.name)
+				price = symbol.startPrice;
+		}
+		const double spread = config.spread * pipSize(currencyPair);
+
+		std::seed_seq seed = { static_cast<uint32_t>(config.seed), static_cast<uint32_t>(config.seed >> 32),
+			static_cast<uint32_t>(std::hash<std::string>()(currencyPair)), static_cast<uint32_t>(date.serialNumber()) };
+		std::mt19937_64 random(seed);
+		std::uniform_real_distribution<double> uniform(0.0, 1.0);
+		std::normal_distribution<double> normal(0.0, 1.0);
+		std::exponential_distribution<double> exponential(1.0);
+
+		const double secondVolatility = config.volatility / std::sqrt(SECONDS_PER_YEAR);
+		const double drift = -0.5 * secondVolatility * secondVolatility;
+
+		const std::time_t dayStart = mktime(date, 0, 0, 0);
+		const double begin = static_cast<double>(config.fromHour * ONEHOUR);
+		const double end = static_cast<double>(config.toHour * ONEHOUR);
+		ticks.reserve(static_cast<size_t>((end - begin) * std::min(1.0, config.tickRate / (1.0 - config.excitation / config.decay))) + 1);
+
+		// Ogata's thinning: candidates are drawn at the (decaying, thus upper bound) current intensity and accepted by the ratio of the new intensity.
+		double now = begin, lastMove = begin;
+		double excitation = 0.0;
+		while (true)
+		{
+			const double bound = config.tickRate + excitation;
+			const double wait = exponential(random) / bound;
+			now += wait;
+			if (now >= end) break;
+			excitation *= std::exp(-config.decay * wait);
+			if (uniform(random) * bound > config.tickRate + excitation) continue;
+			excitation += config.excitation;
+
+			// The price moves over the whole time since the last quote, including gaps.
+			const double elapsed = now - lastMove;
+			price *= std::exp(drift * elapsed + secondVolatility * std::sqrt(elapsed) * normal(random));
+			lastMove = now;
+
+			Tick tick;
+			tick.time = dayStart + static_cast<std::time_t>(now);
+			tick.bid = price - 0.5 * spread;
+			tick.ask = price + 0.5 * spread;
+			if (!ticks.empty() && ticks.back().time == tick.time)
+				ticks.back() = tick;
+			else
+				ticks.push_back(tick);
+
+			if (config.gapProbability > 0.0 && uniform(random) < config.gapProbability)
+			{
+				now += uniform(random) * config.gapSeconds;
+				excitation = 0.0;
+			}
+		}
+	}
+};
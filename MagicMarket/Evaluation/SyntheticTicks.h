@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include <ql/time/date.hpp>
+
+#include "Tick.h"
+
+namespace MM
+{
+	/*
+		Generates trading days of artificial tick data, e.g. for benchmarks.
+		Prices follow a geometric Brownian motion. Quotes arrive as a self-exciting (Hawkes) process with an exponential kernel,
+		so that ticks come in bursts like real data. Occasionally, the feed pauses for a while (gaps) and the price continues
+		from wherever the motion went in the meantime.
+		Ticks have a resolution of one second; quotes that arrive within the same second only keep the last price.
+		The data of a day only depends on the seed, the symbol and the date.
+	*/
+	class SyntheticTickGenerator
+	{
+	public:
+		struct _config
+		{
+			// Base arrival rate of quotes per second.
+			double tickRate = 2.0;
+			// Jump of the arrival rate after every quote and its decay per second. excitation / decay has to be below one.
+			double excitation = 0.5;
+			double decay = 1.0;
+			// Annualized volatility of the prices.
+			double volatility = 0.1;
+			// In pips.
+			double spread = 1.0;
+			// Chance of a pause after a tick and its maximum duration.
+			double gapProbability = 0.0001;
+			int gapSeconds = 300;
+			int fromHour = 0, toHour = 24;
+			uint64_t seed = 1;
+		} config;
+
+		void init(void *ini);
+
+		// Replaces the ticks with the ones of the symbol on that date.
+		void generateDay(const std::string &currencyPair, const QuantLib::Date &date, std::vector<Tick> &ticks) const;
+
+		// Real pairs first, so that experts find their data; then generic names.
+		static std::string getSymbolName(size_t index);
+	};
+};
@@ -0,0 +1,378 @@
+#include "TickReplay.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <functional>
+#include <mutex>
+#include <regex>
+#include <sstream>
+#include <iostream>
+#include <limits>
+#include <filesystem>
+namespace filesystem = std::tr2::sys;
+
+#include <SimpleIni.h>
+
+#include "Indicators/TargetLookbackMean.h"
+
+#include "Helpers.h"
+#include "Market.h"
+#include "Tick.h"
+#include "TradingDay.h"
+#include "IO/DataConverter.h"
+#include "IO/KeyValueDB.h"
+#include "VM/Profiler.h"
+
+namespace MM
+{
+	TickReplay::TickReplay()
+	{
+		lastLeadingTick = nullptr;
+		config.fromHour = config.toHour = 0;
+		priceChangeEstimate = 0.0;
+	}
+
+	TickReplay::~TickReplay()
+	{
+		cleanUpDayData();
+		for (TradingDay *day : dayPool)
+			delete day;
+	}
+
+	void TickReplay::init(void *_ini)
+	{
+		const CSimpleIniA &ini = *(CSimpleIniA*)_ini;
+
+		convertDataFiles(_ini);
+
+		auto readDate = [&](std::string key)
+		{
+			int day, month, year;
+			std::string dayString = ini.GetValue("Virtual Market", key.c_str(), "2014-01-30");
+			sscanf_s(dayString.c_str(), "%d-%d-%d", &year, &month, &day);
+			return QuantLib::Date(day, (QuantLib::Month)(month), year);
+		};
+		config.datePeriodBegin = readDate("Begin");
+		config.datePeriodEnd   = readDate("End");
+		config.date            = config.datePeriodBegin;
+
+		std::string hourString = ini.GetValue("Virtual Market", "Hours", "0-0");
+		sscanf_s(hourString.c_str(), "%d-%d", &config.fromHour, &config.toHour);
+
+		{ // scope
+			std::istringstream is(ini.GetValue("Virtual Market", "Symbols", "EURUSD,EURCHF,EURGBP,GBPUSD,USDCHF,USDJPY"));
+			std::string pair;
+			while (std::getline(is, pair, ','))
+			{
+				if (pair.empty() || std::find(symbols.begin(), symbols.end(), pair) != symbols.end()) continue;
+				symbols.push_back(pair);
+			}
+			if (symbols.empty())
+				symbols.push_back("EURUSD");
+		}
+		config.minimumDayTicks = static_cast<size_t>(ini.GetLongValue("Virtual Market", "MinimumDayTicks", static_cast<long>(config.minimumDayTicks)));
+		config.requireAllSymbols = ini.GetBoolValue("Virtual Market", "RequireAllSymbols", config.requireAllSymbols);
+
+		days.resize(symbols.size(), nullptr);
+		heap.reserve(symbols.size());
+		prepareDayData();
+
+		std::cout << "------------VIRTUAL MARKET SETUP--------(" << config.fromHour << "-" << config.toHour << ")" << std::endl;
+		std::cout << "\tSYMBOLS\t" << symbols.size() << " (leading " << getLeadingPair() << ")" << std::endl;
+		if (days.front() != nullptr && !days.front()->getTicks().empty())
+		{
+			std::cout << "\tTOTAL TICK COUNT\t" << days.front()->getTicks().size() << std::endl;
+			std::cout << "\tFIRST TICK AT\t" << timeToString(days.front()->getTicks().front().getTime()) << std::endl;
+			std::cout << "\tLAST TICK AT\t" << timeToString(days.front()->getTicks().back().getTime()) << std::endl;
+		}
+		std::cout << "----------------------------------------------" << std::endl;
+	}
+
+	void TickReplay::convertDataFiles(void *_ini)
+	{
+		const CSimpleIniA &ini = *(CSimpleIniA*)_ini;
+
+		// Possibly convert some data files first.
+		// Parallel simulations share the data directory, so only one of them may convert at a time.
+		{ // scope
+			static std::mutex conversionMutex;
+			std::lock_guard<std::mutex> lock(conversionMutex);
+
+			io::KeyValueDB db(market().getSaveFolderName() + "/virtual_market.datafiles");
+			size_t skipped = 0;
+
+			for (size_t i = 0; i < 10; ++i)
+			{
+				const std::string configName = std::string("Virtual Market Data ") + std::to_string(i + 1);
+				const bool isRegexp = ini.GetLongValue(configName.c_str(), "Regexp", 0) == 1;
+				std::string baseFilename = ini.GetValue(configName.c_str(), "Filename", "");
+				if (baseFilename.empty()) continue;
+
+				std::vector<std::string> filenames;
+
+				if (!isRegexp) filenames = { baseFilename };
+				else
+				{
+					// Get all files in the directory.
+					const std::string directory = ini.GetValue(configName.c_str(), "Directory", ".");
+					// That matches the given filename-regexp.
+					std::regex filePattern(baseFilename);
+
+					filesystem::directory_iterator iter(directory), end;
+					for (; iter != end; ++iter)
+					{
+						const filesystem::path current = *iter;
+						const std::string currentName = current.filename().string();
+						if (!std::regex_match(currentName, filePattern)) continue;
+						
+						filenames.push_back(directory + "/" + currentName);
+					}
+				}
+
+				for (const std::string &filename : filenames)
+				{
+					// Check if already converted once.
+					if (db.get(filename) == "1")
+					{
+						skipped += 1;
+						continue;
+					}
+					std::cout << "Data file '" << filename << "': \t\tconverting file.." << std::endl;
+					std::string filetype = ini.GetValue(configName.c_str(), "Filetype", "");
+					// Try to read the file
+					io::DataConverter converter(filename, filetype);
+					if (converter.convert() == true)
+					{
+						db.put(filename, "1");
+					}
+					else
+					{
+						std::cout << "\t! Reading Data failed!" << std::endl;
+					}
+				}
+			}
+
+			if (skipped > 0)
+				std::cout << "Skipped " << skipped << " data input files." << std::endl;
+		}
+	}
+
+	void TickReplay::advanceDay()
+	{
+		config.date += QuantLib::Period(1, QuantLib::Days);
+		prepareDayData();
+	}
+
+	void TickReplay::seekDay(const QuantLib::Date &date)
+	{
+		config.date = date;
+		prepareDayData();
+	}
+
+	void TickReplay::cleanUpDayData()
+	{
+		for (TradingDay *&day : days)
+		{
+			if (day == nullptr) continue;
+			// Releases the shared ticks right away.
+			day->reset(day->getDate(), day->getStock());
+			dayPool.push_back(day);
+			day = nullptr;
+		}
+		heap.clear();
+		lastLeadingTick = nullptr;
+	}
+
+	TradingDay *TickReplay::acquireDay(const QuantLib::Date &date, Stock *stock)
+	{
+		if (dayPool.empty())
+			return new TradingDay(date, stock);
+		TradingDay *day = dayPool.back();
+		dayPool.pop_back();
+		day->reset(date, stock);
+		return day;
+	}
+
+	void TickReplay::pushCursor(const Cursor &cursor)
+	{
+		heap.push_back(cursor);
+		std::push_heap(heap.begin(), heap.end(), std::greater<Cursor>());
+	}
+
+	TickReplay::Cursor TickReplay::popCursor()
+	{
+		std::pop_heap(heap.begin(), heap.end(), std::greater<Cursor>());
+		const Cursor cursor = heap.back();
+		heap.pop_back();
+		return cursor;
+	}
+
+	void TickReplay::prepareDayData()
+	{
+		static const vm::ZoneID profilerZone = vm::Profiler::registerZone("TickReplay::prepareDayData");
+		vm::ProfilerZone zone(profilerZone);
+
+		cleanUpDayData();
+
+		auto skipDay = [&](int tickCount, std::string currencyPair)
+		{
+			std::cout << "WARNING: " << currencyPair << " day " << config.date << " has not enough ticks: " << tickCount << std::endl;
+			// Nothing left to replay on this day.
+			heap.clear();
+			if (config.date <= config.datePeriodEnd)
+				advanceDay();
+			return;
+		};
+
+		// load tick data
+		for (size_t symbol = 0; symbol < symbols.size(); ++symbol)
+		{
+			TradingDay *day = acquireDay(config.date, market().getStock(symbols[symbol], true));
+			day->loadFromFile();
+
+			// check if the day is even OK - arbitrary required tick count here
+			if (day->getTicks().size() <= config.minimumDayTicks)
+			{
+				const int tickCount = static_cast<int>(day->getTicks().size());
+				day->reset(config.date, day->getStock());
+				dayPool.push_back(day);
+				if (symbol == 0 || config.requireAllSymbols)
+					return skipDay(tickCount, symbols[symbol]);
+				std::cout << "WARNING: " << symbols[symbol] << " day " << config.date << " has not enough ticks: " << tickCount << ", ignored." << std::endl;
+				continue;
+			}
+			days[symbol] = day;
+
+			// fast forward to start of market day
+			size_t index = 0;
+			if (config.fromHour > 0)
+			{
+				const auto first = std::partition_point(day->getTicks().begin(), day->getTicks().end(), [&](const Tick &tick)
+				{
+					std::time_t time = tick.getTime();
+					return std::gmtime(&time)->tm_hour < config.fromHour;
+				});
+				index = static_cast<size_t>(first - day->getTicks().begin());
+				if (symbol == 0 && index > 0)
+					lastLeadingTick = &day->getTicks()[index - 1];
+			}
+			if (index < day->getTicks().size())
+				pushCursor({ day->getTicks()[index].getTime(), symbol, index });
+		}
+
+		precomputeTradeEfficiency();
+	}
+
+	bool TickReplay::isDayFinished() const
+	{
+		return heap.empty();
+	}
+
+	bool TickReplay::nextStep(ReplayBatch &batch)
+	{
+		if (isDayFinished()) return false;
+
+		const std::time_t time = heap.front().time;
+		// check end of market day
+		if (config.toHour > 0)
+		{
+			std::time_t stepTime = time;
+			if (std::gmtime(&stepTime)->tm_hour > config.toHour)
+			{
+				heap.clear();
+				return false;
+			}
+		}
+
+		// calculate predictive value of efficiency of trades executed at this time point
+		predictTradeEfficiency();
+
+		ReplayBatch::Step step;
+		step.firstTick = batch.ticks.size();
+		step.priceChangeEstimate = priceChangeEstimate;
+		batch.steps.push_back(step);
+
+		// all ticks of this timestamp, in the order of the symbols
+		while (!heap.empty() && heap.front().time == time)
+		{
+			Cursor cursor = popCursor();
+			TradingDay *day = days[cursor.symbol];
+			const Tick &tick = day->getTicks()[cursor.index];
+			assert(std::isnormal(tick.getAsk()));
+			assert(std::isnormal(tick.getBid()));
+			batch.ticks.push_back({ &tick, day });
+			if (cursor.symbol == 0)
+				lastLeadingTick = &tick;
+
+			if (++cursor.index < day->getTicks().size())
+			{
+				cursor.time = day->getTicks()[cursor.index].getTime();
+				pushCursor(cursor);
+			}
+		}
+		return true;
+	}
+
+	void TickReplay::predictTradeEfficiency()
+	{
+		if (!lastLeadingTick) return;
+		const size_t index = static_cast<size_t>(lastLeadingTick - days.front()->getTicks().data());
+		assert(index < leadingEstimates.size());
+
+		// Without an estimation, the last one is kept.
+		const double estimate = leadingEstimates[index];
+		if (!std::isnan(estimate))
+			priceChangeEstimate = estimate;
+	}
+
+	void TickReplay::precomputeTradeEfficiency()
+	{
+		static const vm::ZoneID profilerZone = vm::Profiler::registerZone("TickReplay::precomputeTradeEfficiency");
+		vm::ProfilerZone zone(profilerZone);
+
+		leadingEstimates.clear();
+		if (days.front() == nullptr) return;
+		const TickRange ticks = days.front()->getTicks();
+		leadingEstimates.resize(ticks.size(), std::numeric_limits<double>::quiet_NaN());
+		if (ticks.size() < 3) return;
+
+		/*
+			Same as TargetLookbackMean::calculateTarget on the 15 minutes after every tick:
+			sample k is the price of the last tick before tick time + k minutes.
+			The sample positions only move forward, so the whole day takes one pass.
+		*/
+		const int lookaheadTime = 15 * ONEMINUTE;
+		const size_t sampleCount = lookaheadTime / ONEMINUTE + 1;
+		std::vector<size_t> sampleEnd(sampleCount, 0);
+		std::vector<QuantLib::Decimal> samples(sampleCount);
+		const std::time_t lastTime = ticks.back().getTime();
+
+		for (size_t i = 0; i < ticks.size(); ++i)
+		{
+			const std::time_t time = ticks[i].getTime();
+			if (time + lookaheadTime > lastTime) break;
+			if (i > 0 && time == ticks[i - 1].getTime())
+			{
+				leadingEstimates[i] = leadingEstimates[i - 1];
+				continue;
+			}
+			// The window may not span two (UTC) days.
+			if (time / ONEDAY != (time + lookaheadTime) / ONEDAY) continue;
+
+			for (size_t sample = 0; sample < sampleCount; ++sample)
+			{
+				const std::time_t sampleTime = time + static_cast<std::time_t>(sample) * ONEMINUTE;
+				size_t &end = sampleEnd[sample];
+				while (end < ticks.size() && ticks[end].getTime() < sampleTime)
+					++end;
+			}
+			// The tick before the window is the open; it may not be the first tick of the day.
+			if (sampleEnd[0] < 2) continue;
+
+			for (size_t sample = 0; sample < sampleCount; ++sample)
+				samples[sample] = ticks[sampleEnd[sample] - 1].getMid();
+			leadingEstimates[i] = Indicators::TargetLookbackMean::calculateTarget(samples.data(), samples.size());
+		}
+	}
+};
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <ql/time/date.hpp>
+#include <vector>
+#include <string>
+#include <ctime>
+
+namespace MM
+{
+	class TradingDay;
+	class Tick;
+	class Stock;
+
+	/*
+		Consecutive steps of the virtual market as produced by the tick replay.
+		Every step consists of all ticks (of all symbols) that share one timestamp.
+	*/
+	struct ReplayBatch
+	{
+		struct Entry
+		{
+			const Tick *tick;
+			TradingDay *day;
+		};
+
+		struct Step
+		{
+			// Index of the step's first tick in ReplayBatch::ticks.
+			size_t firstTick;
+			// Future-aware estimation for the leading pair at the time of the previous step.
+			double priceChangeEstimate;
+		};
+
+		std::vector<Entry> ticks;
+		std::vector<Step> steps;
+
+		void clear() { ticks.clear(); steps.clear(); }
+		size_t getTickEnd(size_t stepIndex) const { return (stepIndex + 1 < steps.size()) ? steps[stepIndex + 1].firstTick : ticks.size(); }
+	};
+
+	/*
+		Walks through the configured period day by day and merges the ticks of all configured symbols in timestamp order.
+		The tick data is only read, so one replay can feed any number of virtual markets (see ParameterSweep).
+		Day data stays valid until advanceDay() is called.
+	*/
+	class TickReplay
+	{
+	public:
+		TickReplay();
+		~TickReplay();
+
+		void init(void *ini);
+
+		// Appends the next step to the batch. Returns false if the current day has no more ticks.
+		bool nextStep(ReplayBatch &batch);
+		bool isDayFinished() const;
+		void advanceDay();
+		// Continues the period at the given day, e.g. when resuming from a checkpoint.
+		void seekDay(const QuantLib::Date &date);
+		bool isOutOfPeriod() const { return config.date > config.datePeriodEnd; }
+
+		const QuantLib::Date &getDate() const { return config.date; }
+		const QuantLib::Date &getPeriodBegin() const { return config.datePeriodBegin; }
+		bool hasClosingHour() const { return config.toHour > 0; }
+		const std::string &getLeadingPair() const { return symbols.front(); }
+		// All replayed pairs, starting with the leading one.
+		const std::vector<std::string> &getPairs() const { return symbols; }
+
+	private:
+		// The leading pair comes first. Its ticks decide whether a day is valid and are used for the look-ahead estimation.
+		std::vector<std::string> symbols;
+		// Indexed like symbols. nullptr if a pair has no valid data for the current day.
+		std::vector<TradingDay*> days;
+		// Days of earlier dates, reused with their tick buffers.
+		std::vector<TradingDay*> dayPool;
+		TradingDay *acquireDay(const QuantLib::Date &date, Stock *stock);
+		const Tick *lastLeadingTick;
+
+		// Position of the next tick of one symbol.
+		struct Cursor
+		{
+			std::time_t time;
+			size_t symbol;
+			size_t index;
+
+			// Orders the heap by time, ties are broken by the symbol order.
+			bool operator>(const Cursor &other) const { return (time != other.time) ? (time > other.time) : (symbol > other.symbol); }
+		};
+		// Min-heap with one cursor per symbol that still has ticks left on the current day.
+		std::vector<Cursor> heap;
+		void pushCursor(const Cursor &cursor);
+		Cursor popCursor();
+
+		struct _config
+		{
+			QuantLib::Date datePeriodBegin, datePeriodEnd;
+			QuantLib::Date date;
+			int fromHour, toHour;
+			size_t minimumDayTicks = 15000;
+			// Whether a day is skipped if any symbol lacks data, or only if the leading one does.
+			bool requireAllSymbols = true;
+		} config;
+
+		double priceChangeEstimate;
+		// Look-ahead estimation for every tick of the leading pair's day, NaN where none can be made. See predictTradeEfficiency().
+		std::vector<double> leadingEstimates;
+		void precomputeTradeEfficiency();
+
+		void convertDataFiles(void *ini);
+		void cleanUpDayData();
+		void prepareDayData();
+		void predictTradeEfficiency();
+	};
+};
@@ -0,0 +1,304 @@
+#include "TradeEvaluation.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <filesystem>
+namespace filesystem = std::tr2::sys;
+
+#include <SimpleIni.h>
+
+#include "EnvironmentVariables.h"
+
+namespace MM
+{
+	namespace
+	{
+		// Resamples that are processed in one piece; also the granularity of the random streams.
+		const size_t CHUNK_SIZE = 256;
+
+		// Linear interpolation between the closest ranks. The values have to be sorted.
+		float percentile(const std::vector<float> &sorted, double percent)
+		{
+			if (sorted.empty()) return std::numeric_limits<float>::quiet_NaN();
+			const double rank = std::min(std::max(percent, 0.0), 100.0) / 100.0 * static_cast<double>(sorted.size() - 1);
+			const size_t lower = static_cast<size_t>(std::floor(rank));
+			const size_t upper = std::min(lower + 1, sorted.size() - 1);
+			const double weight = rank - static_cast<double>(lower);
+			return static_cast<float>((1.0 - weight) * sorted[lower] + weight * sorted[upper]);
+		}
+	};
+
+	bool TradeEvaluation::isEnabled(void *_ini)
+	{
+		const CSimpleIniA &ini = *(CSimpleIniA*)_ini;
+		return ini.GetBoolValue("Trade Evaluation", "Enabled", false);
+	}
+
+	void TradeEvaluation::init(void *_ini)
+	{
+		const CSimpleIniA &ini = *(CSimpleIniA*)_ini;
+
+		{ // scope
+			std::istringstream is(ini.GetValue("Trade Evaluation", "Input", "saves/trades.tsv"));
+			std::string input;
+			while (std::getline(is, input, ','))
+			{
+				if (!input.empty())
+					config.inputs.push_back(environmentVariables().replace(input));
+			}
+		}
+		config.outputFilename = environmentVariables().replace(ini.GetValue("Trade Evaluation", "OutputFilename", "saves/evaluation.tsv"));
+
+		const std::string method = ini.GetValue("Trade Evaluation", "Method", "bootstrap");
+		if (method == "permutation")
+			config.method = PERMUTATION;
+		else if (method != "bootstrap")
+			std::cout << "WARNING: Unknown evaluation method '" << method << "', using bootstrap." << std::endl;
+
+		config.resamples = std::max(1L, ini.GetLongValue("Trade Evaluation", "Resamples", static_cast<long>(config.resamples)));
+		config.threads = std::max(0L, ini.GetLongValue("Trade Evaluation", "Threads", 0));
+		if (config.threads == 0)
+			config.threads = std::max(1u, std::thread::hardware_concurrency());
+		config.seed = static_cast<uint64_t>(ini.GetLongValue("Trade Evaluation", "Seed", static_cast<long>(config.seed)));
+
+		{ // scope
+			std::istringstream is(ini.GetValue("Trade Evaluation", "Percentiles", "5,25,50,75,95"));
+			std::string value;
+			while (std::getline(is, value, ','))
+			{
+				if (!value.empty())
+					config.percentiles.push_back(std::stod(value));
+			}
+		}
+	}
+
+	void TradeEvaluation::collectFiles(std::vector<std::string> &filenames) const
+	{
+		for (const std::string &input : config.inputs)
+		{
+			const filesystem::path path(input);
+			if (!filesystem::is_directory(path))
+			{
+				filenames.push_back(input);
+				continue;
+			}
+
+			// Folders contribute all their trade logs, e.g. the ones of a parameter sweep.
+			std::vector<std::string> found;
+			filesystem::directory_iterator iter(path), end;
+			for (; iter != end; ++iter)
+			{
+				const filesystem::path current = *iter;
+				if (current.extension().string() != ".tsv") continue;
+				std::ifstream file(current.string());
+				std::string header;
+				std::getline(file, header);
+				if (header.compare(0, 8, "Trade ID") != 0) continue;
+				found.push_back(current.string());
+			}
+			std::sort(found.begin(), found.end());
+			filenames.insert(filenames.end(), found.begin(), found.end());
+		}
+	}
+
+	bool TradeEvaluation::loadTradeLog(TradeLog &log)
+	{
+		std::ifstream file(log.filename);
+		if (!file.good()) return false;
+
+		std::vector<std::pair<std::time_t, float>> trades;
+		std::string line;
+		size_t malformedLines = 0;
+		std::getline(file, line); // header
+		while (std::getline(file, line))
+		{
+			if (line.empty()) continue;
+			// Trade ID, Opening Time, Type, Profit, Closing Time, ...
+			std::istringstream is(line);
+			std::string field;
+			float profit = 0.0f;
+			std::time_t closingTime = 0;
+			int parsedColumns = 0;
+			for (int column = 0; column < 5 && std::getline(is, field, '\t'); ++column)
+			{
+				if (column < 3) continue;
+				const char *begin = field.c_str();
+				char *end = nullptr;
+				if (column == 3) profit = static_cast<float>(std::strtod(begin, &end));
+				else closingTime = static_cast<std::time_t>(std::strtoll(begin, &end, 10));
+				if (end != begin) ++parsedColumns;
+			}
+			if (parsedColumns != 2)
+			{
+				++malformedLines;
+				continue;
+			}
+			trades.emplace_back(closingTime, profit);
+		}
+		if (malformedLines > 0)
+			std::cout << "WARNING: Skipped " << malformedLines << " malformed lines in '" << log.filename << "'." << std::endl;
+
+		// The log is written per day in no particular order.
+		std::stable_sort(trades.begin(), trades.end(), [](const std::pair<std::time_t, float> &a, const std::pair<std::time_t, float> &b) { return a.first < b.first; });
+		log.profits.resize(trades.size());
+		for (size_t i = 0; i < trades.size(); ++i)
+			log.profits[i] = trades[i].second;
+		return true;
+	}
+
+	TradeEvaluation::Metrics TradeEvaluation::evaluate(const float *profits, size_t count)
+	{
+		Metrics metrics = { 0.0f, 0.0f, 0.0f };
+		if (count == 0) return metrics;
+
+		// Accumulated in double; sums of thousands of trades lose too much in float.
+		double equity = 0.0, peak = 0.0, maxDrawdown = 0.0;
+		size_t won = 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			equity += profits[i];
+			if (profits[i] > 0.0f) won += 1;
+			peak = std::max(peak, equity);
+			maxDrawdown = std::max(maxDrawdown, peak - equity);
+		}
+		metrics.totalPips = static_cast<float>(equity);
+		metrics.maxDrawdown = static_cast<float>(maxDrawdown);
+		metrics.winRate = static_cast<float>(won) / static_cast<float>(count);
+		return metrics;
+	}
+
+	void TradeEvaluation::resample(TradeLog &log, size_t first, size_t end, uint64_t stream) const
+	{
+		std::seed_seq seed = { static_cast<uint32_t>(config.seed), static_cast<uint32_t>(config.seed >> 32), static_cast<uint32_t>(stream), static_cast<uint32_t>(stream >> 32) };
+		std::mt19937_64 random(seed);
+
+		const size_t count = log.profits.size();
+		std::vector<float> sample(log.profits);
+		std::uniform_int_distribution<size_t> draw(0, count - 1);
+		for (size_t i = first; i < end; ++i)
+		{
+			if (config.method == BOOTSTRAP)
+			{
+				for (float &profit : sample)
+					profit = log.profits[draw(random)];
+			}
+			else
+			{
+				// The previous permutation is as good a start as any.
+				std::shuffle(sample.begin(), sample.end(), random);
+			}
+			log.resamples[i] = evaluate(sample.data(), count);
+		}
+	}
+
+	template<typename Function> void TradeEvaluation::parallelFor(size_t count, const Function &function) const
+	{
+		std::atomic<size_t> next(0);
+		auto work = [&next, count, &function]()
+		{
+			for (size_t index = next++; index < count; index = next++)
+				function(index);
+		};
+
+		const size_t threadCount = std::min(config.threads, count);
+		if (threadCount <= 1)
+		{
+			work();
+			return;
+		}
+		std::vector<std::thread> threads;
+		for (size_t i = 0; i < threadCount; ++i)
+			threads.emplace_back(work);
+		for (std::thread &thread : threads)
+			thread.join();
+	}
+
+	void TradeEvaluation::run()
+	{
+		std::vector<std::string> filenames;
+		collectFiles(filenames);
+		logs.resize(filenames.size());
+		for (size_t i = 0; i < filenames.size(); ++i)
+			logs[i].filename = filenames[i];
+
+		parallelFor(logs.size(), [this](size_t index)
+		{
+			TradeLog &log = logs[index];
+			if (!loadTradeLog(log))
+				std::cout << "WARNING: Could not read trade log '" << log.filename << "'." << std::endl;
+			log.original = evaluate(log.profits.data(), log.profits.size());
+			if (!log.profits.empty())
+				log.resamples.resize(config.resamples);
+		});
+
+		// Chunks of all logs in one list, so that a few long logs do not leave the other threads idle.
+		struct Chunk
+		{
+			size_t log;
+			size_t first, end;
+			uint64_t stream;
+		};
+		std::vector<Chunk> chunks;
+		for (size_t log = 0; log < logs.size(); ++log)
+		{
+			if (logs[log].profits.empty()) continue;
+			for (size_t first = 0; first < config.resamples; first += CHUNK_SIZE)
+				chunks.push_back({ log, first, std::min(first + CHUNK_SIZE, config.resamples), (static_cast<uint64_t>(log) << 32) | (first / CHUNK_SIZE) });
+		}
+
+		std::cout << "TRADE EVALUATION: " << logs.size() << " trade logs, " << config.resamples << " resamples each, " << config.threads << " threads" << std::endl;
+		parallelFor(chunks.size(), [this, &chunks](size_t index)
+		{
+			const Chunk &chunk = chunks[index];
+			resample(logs[chunk.log], chunk.first, chunk.end, chunk.stream);
+		});
+
+		writeResults();
+	}
+
+	void TradeEvaluation::writeResults()
+	{
+		filesystem::path outputPath = filesystem::path(config.outputFilename).parent_path();
+		if (!outputPath.empty())
+			filesystem::create_directories(outputPath);
+		std::fstream output(config.outputFilename, std::ios_base::out | std::ios_base::trunc);
+
+		const char *metricNames[] = { "Total Pips", "Max Drawdown", "Win Rate" };
+		output << "Trade Log\tTrades";
+		for (const char *name : metricNames)
+			output << "\t" << name;
+		for (const char *name : metricNames)
+		{
+			for (const double percent : config.percentiles)
+				output << "\t" << name << " P" << percent;
+		}
+		output << std::endl;
+
+		std::vector<float> values;
+		for (const TradeLog &log : logs)
+		{
+			output << log.filename << "\t" << log.profits.size()
+				<< "\t" << log.original.totalPips << "\t" << log.original.maxDrawdown << "\t" << log.original.winRate;
+
+			for (float Metrics::*metric : { &Metrics::totalPips, &Metrics::maxDrawdown, &Metrics::winRate })
+			{
+				values.resize(log.resamples.size());
+				for (size_t i = 0; i < log.resamples.size(); ++i)
+					values[i] = log.resamples[i].*metric;
+				std::sort(values.begin(), values.end());
+				for (const double percent : config.percentiles)
+					output << "\t" << percentile(values, percent);
+			}
+			output << std::endl;
+		}
+		std::cout << "TRADE EVALUATION: results written to " << config.outputFilename << std::endl;
+	}
+};
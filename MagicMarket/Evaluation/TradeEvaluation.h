@@ -0,0 +1,67 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace MM
+{
+	/*
+		Resampling analysis of trade logs as written by the virtual market (see VirtualMarket::saveTrades).
+		Every log is resampled many times, either by drawing the trades with replacement (bootstrap) or by shuffling their order (permutation).
+		The percentiles of the total profit, the maximum drawdown and the win rate over all resamples are written to one line per log.
+		The resamples of all logs are processed in chunks by all threads; every chunk has its own random stream, so the results
+		only depend on the seed and not on the number of threads.
+	*/
+	class TradeEvaluation
+	{
+	public:
+		static bool isEnabled(void *ini);
+		void init(void *ini);
+		void run();
+
+	private:
+		enum Method
+		{
+			BOOTSTRAP,
+			PERMUTATION
+		};
+
+		struct Metrics
+		{
+			float totalPips;
+			float maxDrawdown;
+			float winRate;
+		};
+
+		struct TradeLog
+		{
+			std::string filename;
+			// Profits in pips, ordered by closing time.
+			std::vector<float> profits;
+			Metrics original;
+			// One entry per resample.
+			std::vector<Metrics> resamples;
+		};
+		std::vector<TradeLog> logs;
+
+		struct _config
+		{
+			std::vector<std::string> inputs;
+			std::string outputFilename;
+			Method method = BOOTSTRAP;
+			size_t resamples = 10000;
+			size_t threads = 0;
+			uint64_t seed = 1;
+			std::vector<double> percentiles;
+		} config;
+
+		void collectFiles(std::vector<std::string> &filenames) const;
+		static bool loadTradeLog(TradeLog &log);
+		static Metrics evaluate(const float *profits, size_t count);
+		void resample(TradeLog &log, size_t first, size_t end, uint64_t stream) const;
+		// Calls the function for every index in [0, count) distributed over the configured threads.
+		template<typename Function> void parallelFor(size_t count, const Function &function) const;
+		void writeResults();
+	};
+};
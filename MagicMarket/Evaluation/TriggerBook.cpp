@@ -0,0 +1,92 @@
+#include "TriggerBook.h"
+
+namespace MM
+{
+	void TriggerBook::add(SymbolID symbol, int32_t ticketID, Trade::Type type, QuantLib::Decimal stopLossPrice, QuantLib::Decimal takeProfitPrice)
+	{
+		if (symbol == INVALID_SYMBOL) return;
+		remove(ticketID);
+		if (stopLossPrice == 0.0 && takeProfitPrice == 0.0) return;
+
+		if (static_cast<size_t>(symbol) >= books.size())
+			books.resize(symbol + 1);
+		Side &side = (type == Trade::T_BUY) ? books[symbol].buy : books[symbol].sell;
+		if (stopLossPrice != 0.0)
+			side.stopLoss.emplace(stopLossPrice, ticketID);
+		if (takeProfitPrice != 0.0)
+			side.takeProfit.emplace(takeProfitPrice, ticketID);
+
+		registered[ticketID] = { symbol, type, stopLossPrice, takeProfitPrice };
+	}
+
+	void TriggerBook::eraseLevel(Levels &levels, QuantLib::Decimal price, int32_t ticketID)
+	{
+		auto range = levels.equal_range(price);
+		for (auto iter = range.first; iter != range.second; ++iter)
+		{
+			if (iter->second != ticketID) continue;
+			levels.erase(iter);
+			return;
+		}
+	}
+
+	void TriggerBook::remove(int32_t ticketID)
+	{
+		auto found = registered.find(ticketID);
+		if (found == registered.end()) return;
+
+		const Registration &registration = found->second;
+		Side &side = (registration.type == Trade::T_BUY) ? books[registration.symbol].buy : books[registration.symbol].sell;
+		if (registration.stopLossPrice != 0.0)
+			eraseLevel(side.stopLoss, registration.stopLossPrice, ticketID);
+		if (registration.takeProfitPrice != 0.0)
+			eraseLevel(side.takeProfit, registration.takeProfitPrice, ticketID);
+		registered.erase(found);
+	}
+
+	void TriggerBook::clear()
+	{
+		for (Book &book : books)
+		{
+			book.buy.stopLoss.clear();
+			book.buy.takeProfit.clear();
+			book.sell.stopLoss.clear();
+			book.sell.takeProfit.clear();
+		}
+		registered.clear();
+	}
+
+	void TriggerBook::collect(SymbolID symbol, QuantLib::Decimal bid, QuantLib::Decimal ask, std::vector<Fired> &fired)
+	{
+		if (registered.empty() || symbol == INVALID_SYMBOL || static_cast<size_t>(symbol) >= books.size()) return;
+		Book &book = books[symbol];
+
+		candidates.clear();
+		// Levels at or above the price.
+		auto collectFrom = [this](const Levels &levels, QuantLib::Decimal price, Kind kind)
+		{
+			for (auto iter = levels.lower_bound(price); iter != levels.end(); ++iter)
+				candidates.push_back({ iter->second, kind });
+		};
+		// Levels at or below the price.
+		auto collectUpTo = [this](const Levels &levels, QuantLib::Decimal price, Kind kind)
+		{
+			for (auto iter = levels.begin(); iter != levels.end() && iter->first <= price; ++iter)
+				candidates.push_back({ iter->second, kind });
+		};
+
+		// Stop losses first.
+		collectFrom(book.buy.stopLoss, bid, STOP_LOSS);
+		collectUpTo(book.sell.stopLoss, ask, STOP_LOSS);
+		collectUpTo(book.buy.takeProfit, bid, TAKE_PROFIT);
+		collectFrom(book.sell.takeProfit, ask, TAKE_PROFIT);
+
+		for (const Fired &candidate : candidates)
+		{
+			// Already fired by its other level.
+			if (!registered.count(candidate.ticketID)) continue;
+			remove(candidate.ticketID);
+			fired.push_back(candidate);
+		}
+	}
+};
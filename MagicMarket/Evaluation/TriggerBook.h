@@ -0,0 +1,70 @@
+#pragma once
+
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+
+#include <ql/types.hpp>
+
+#include "SymbolTable.h"
+#include "Trade.h"
+
+namespace MM
+{
+	/*
+		Stop loss and take profit levels of the open virtual trades, sorted by price per symbol and side.
+		Buy trades are closed at the bid, sell trades at the ask. A tick only visits the levels it crosses.
+	*/
+	class TriggerBook
+	{
+	public:
+		enum Kind
+		{
+			STOP_LOSS = 1,
+			TAKE_PROFIT = 2
+		};
+
+		struct Fired
+		{
+			int32_t ticketID;
+			Kind kind;
+		};
+
+		// Levels of 0 are not set.
+		void add(SymbolID symbol, int32_t ticketID, Trade::Type type, QuantLib::Decimal stopLossPrice, QuantLib::Decimal takeProfitPrice);
+		void remove(int32_t ticketID);
+		void clear();
+		bool empty() const { return registered.empty(); }
+
+		// Appends the trades whose levels are crossed by the prices and removes them from the book.
+		// If both levels of a trade are crossed at once, the stop loss wins.
+		void collect(SymbolID symbol, QuantLib::Decimal bid, QuantLib::Decimal ask, std::vector<Fired> &fired);
+
+	private:
+		typedef std::multimap<QuantLib::Decimal, int32_t> Levels;
+		struct Side
+		{
+			Levels stopLoss, takeProfit;
+		};
+		struct Book
+		{
+			Side buy, sell;
+		};
+		// Indexed by SymbolID.
+		std::vector<Book> books;
+
+		struct Registration
+		{
+			SymbolID symbol;
+			Trade::Type type;
+			QuantLib::Decimal stopLossPrice, takeProfitPrice;
+		};
+		std::unordered_map<int32_t, Registration> registered;
+
+		// Reused between calls of collect().
+		std::vector<Fired> candidates;
+
+		static void eraseLevel(Levels &levels, QuantLib::Decimal price, int32_t ticketID);
+	};
+};
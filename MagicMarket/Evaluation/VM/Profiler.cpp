@@ -1,9 +1,17 @@
 #include "Statistics.h"
 
 #include "Market.h"
+#include "EnvironmentVariables.h"
 #include <SimpleIni.h>
 #include "Profiler.h"
 
+#include <filesystem>
+namespace filesystem = std::tr2::sys;
+
+#include <algorithm>
+#include <cassert>
+#include <iomanip>
+#include <iostream>
 #include <sstream>
 
 
@@ -11,19 +19,227 @@ namespace MM
 {
 	namespace vm
 	{
+		thread_local Profiler *Profiler::active = nullptr;
+		std::mutex Profiler::registryMutex;
+		std::map<std::string, ZoneID> Profiler::zoneIDs;
+		std::vector<std::string> Profiler::zoneNames;
+		std::atomic<uint64_t> Profiler::nextGeneration(1);
+
+		namespace
+		{
+			// Every thread caches its buffer of the currently active profiler.
+			thread_local uint64_t threadBufferGeneration = 0;
+			thread_local void *threadBuffer = nullptr;
+
+			double toMilliseconds(const Profiler::Clock::duration &duration)
+			{
+				return std::chrono::duration<double, std::milli>(duration).count();
+			}
+
+			double toMicroseconds(const Profiler::Clock::duration &duration)
+			{
+				return std::chrono::duration<double, std::micro>(duration).count();
+			}
+
+			std::string escapeJSON(const std::string &value)
+			{
+				std::string escaped;
+				escaped.reserve(value.size());
+				for (const char c : value)
+				{
+					if (c == '"' || c == '\\') escaped.push_back('\\');
+					escaped.push_back(c);
+				}
+				return escaped;
+			}
+		};
 
-		Profiler::Profiler()
+		Profiler::Profiler() : generation(nextGeneration++), maxTraceEvents(0), traceEventCount(0)
 		{
 		}
 
 
 		Profiler::~Profiler()
 		{
+			close();
+		}
+
+		void Profiler::close()
+		{
+			if (active != this) return;
+			writeTrace();
+			reportStream.close();
+			active = nullptr;
 		}
 
 		void Profiler::init(void *_ini)
 		{
 			const CSimpleIniA &ini = *(CSimpleIniA*)_ini;
+			if (!ini.GetBoolValue("Virtual Market", "Profiler", false)) return;
+
+			reportFilename = environmentVariables().replace(ini.GetValue("Virtual Market", "ProfilerReport", "saves/profiler.txt"));
+			traceFilename = environmentVariables().replace(ini.GetValue("Virtual Market", "ProfilerTrace", ""));
+			maxTraceEvents = static_cast<size_t>(ini.GetLongValue("Virtual Market", "ProfilerTraceMaxEvents", 1000000));
+
+			for (const std::string &filename : { reportFilename, traceFilename })
+			{
+				if (filename.empty()) continue;
+				const filesystem::path outputPath = filesystem::path(filename).parent_path();
+				if (!outputPath.empty())
+					filesystem::create_directories(outputPath);
+			}
+
+			reportStream.open(reportFilename, std::ios_base::out);
+			if (!reportStream.good())
+				std::cout << "WARNING: Could not open profiler report '" << reportFilename << "'." << std::endl;
+
+			startTime = lastLogTime = Clock::now();
+			active = this;
+		}
+
+		ZoneID Profiler::registerZone(const std::string &name)
+		{
+			std::lock_guard<std::mutex> lock(registryMutex);
+			auto found = zoneIDs.find(name);
+			if (found != zoneIDs.end()) return found->second;
+
+			const ZoneID zone = zoneNames.size();
+			zoneNames.push_back(name);
+			zoneIDs[name] = zone;
+			return zone;
+		}
+
+		Profiler::ThreadBuffer &Profiler::getThreadBuffer()
+		{
+			if (threadBufferGeneration == generation)
+				return *static_cast<ThreadBuffer*>(threadBuffer);
+
+			std::lock_guard<std::mutex> lock(buffersMutex);
+			threadBuffers.push_back(std::make_unique<ThreadBuffer>());
+			ThreadBuffer *buffer = threadBuffers.back().get();
+			buffer->threadIndex = static_cast<int>(threadBuffers.size());
+			buffer->stack.reserve(32);
+
+			threadBufferGeneration = generation;
+			threadBuffer = buffer;
+			return *buffer;
+		}
+
+		void Profiler::enter(ZoneID zone)
+		{
+			ThreadBuffer &buffer = getThreadBuffer();
+			buffer.stack.push_back(Frame{ zone, Clock::now(), Clock::duration::zero() });
+		}
+
+		void Profiler::leave()
+		{
+			const Clock::time_point end = Clock::now();
+			ThreadBuffer &buffer = getThreadBuffer();
+			assert(!buffer.stack.empty());
+
+			const Frame frame = buffer.stack.back();
+			buffer.stack.pop_back();
+			const Clock::duration elapsed = end - frame.start;
+
+			if (frame.zone >= buffer.zones.size())
+				buffer.zones.resize(frame.zone + 1);
+			ZoneStatistics &zone = buffer.zones[frame.zone];
+			zone.calls += 1;
+			zone.total += elapsed;
+			zone.self += elapsed - frame.children;
+
+			if (!buffer.stack.empty())
+				buffer.stack.back().children += elapsed;
+
+			if (!traceFilename.empty() && traceEventCount.fetch_add(1, std::memory_order_relaxed) < maxTraceEvents)
+			{
+				buffer.trace.push_back(TraceEvent{ frame.zone, frame.start, elapsed });
+			}
+		}
+
+		void Profiler::log(const std::string &heading)
+		{
+			if (active != this || !reportStream.is_open()) return;
+
+			// Sum up all threads. The buffers are only modified by their threads, so this should be called while those are idle.
+			std::vector<ZoneStatistics> zones;
+			{ // scope
+				std::lock_guard<std::mutex> lock(buffersMutex);
+				for (std::unique_ptr<ThreadBuffer> &buffer : threadBuffers)
+				{
+					if (buffer->zones.size() > zones.size())
+						zones.resize(buffer->zones.size());
+					for (size_t i = 0; i < buffer->zones.size(); ++i)
+					{
+						zones[i].calls += buffer->zones[i].calls;
+						zones[i].total += buffer->zones[i].total;
+						zones[i].self += buffer->zones[i].self;
+					}
+					buffer->zones.clear();
+				}
+			}
+
+			std::vector<std::string> names;
+			{ // scope
+				std::lock_guard<std::mutex> lock(registryMutex);
+				names = zoneNames;
+			}
+
+			std::vector<ZoneID> order;
+			for (ZoneID i = 0; i < zones.size(); ++i)
+				if (zones[i].calls > 0) order.push_back(i);
+			std::sort(order.begin(), order.end(), [&](ZoneID a, ZoneID b) { return zones[a].self > zones[b].self; });
+
+			const Clock::time_point now = Clock::now();
+			const double wallTime = toMilliseconds(now - lastLogTime);
+			lastLogTime = now;
+
+			reportStream << "=== " << heading << " (" << std::fixed << std::setprecision(1) << wallTime << " ms) ===" << std::endl;
+			reportStream << "zone\tcalls\ttotal_ms\tself_ms\tself_percent\tavg_us" << std::endl;
+			for (const ZoneID zone : order)
+			{
+				const ZoneStatistics &stats = zones[zone];
+				reportStream << names[zone] << "\t" << stats.calls
+					<< "\t" << std::setprecision(2) << toMilliseconds(stats.total)
+					<< "\t" << toMilliseconds(stats.self)
+					<< "\t" << (wallTime > 0.0 ? 100.0 * toMilliseconds(stats.self) / wallTime : 0.0)
+					<< "\t" << toMicroseconds(stats.total) / static_cast<double>(stats.calls) << std::endl;
+			}
+			reportStream << std::endl << std::flush;
+		}
+
+		void Profiler::writeTrace()
+		{
+			if (traceFilename.empty()) return;
+
+			std::ofstream traceStream(traceFilename, std::ios_base::out);
+			if (!traceStream.good())
+			{
+				std::cout << "WARNING: Could not write profiler trace '" << traceFilename << "'." << std::endl;
+				return;
+			}
+
+			std::vector<std::string> names;
+			{ // scope
+				std::lock_guard<std::mutex> lock(registryMutex);
+				names = zoneNames;
+			}
+
+			traceStream << "{\"traceEvents\":[" << std::endl;
+			traceStream << std::fixed << std::setprecision(3);
+			bool first = true;
+			std::lock_guard<std::mutex> lock(buffersMutex);
+			for (const std::unique_ptr<ThreadBuffer> &buffer : threadBuffers)
+			{
+				for (const TraceEvent &event : buffer->trace)
+				{
+					if (!first) traceStream << "," << std::endl;
+					first = false;
+					traceStream << "{\"name\":\"" << escapeJSON(names[event.zone]) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadIndex
+						<< ",\"ts\":" << toMicroseconds(event.start - startTime) << ",\"dur\":" << toMicroseconds(event.duration) << "}";
+				}
+			}
+			traceStream << std::endl << "],\"displayTimeUnit\":\"ms\"}" << std::endl;
 		}
 	};
-};
\ No newline at end of file
+};
@@ -1,9 +1,14 @@
 #pragma once
 
+#include <atomic>
+#include <stdint.h>
 #include <string>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <vector>
 
+#include <chrono>
 #include <functional>
 #include <fstream>
 
@@ -11,15 +16,109 @@ namespace MM
 {
 	namespace vm
 	{
+		typedef size_t ZoneID;
+
+		/*
+			Hierarchical scope profiler for the virtual market.
+			Zones are registered once by name and entered through ProfilerZone objects.
+			Every thread records into its own buffer; log() aggregates the buffers into a per-day report
+			and the individual zone executions can additionally be written as a Chrome trace-event file (chrome://tracing).
+		*/
 		class Profiler
 		{
 		public:
+			typedef std::chrono::steady_clock Clock;
+
 			Profiler();
 			~Profiler();
 
-			void log();
+			// Appends the report of all zones since the last call to the report file and resets the counters.
+			void log(const std::string &heading);
 			void init(void *ini);
+			// Writes the trace file and detaches the profiler from all zones.
+			void close();
+
+			// Returns the same ID for the same name. Thread-safe; zones can be registered while no profiler is active.
+			static ZoneID registerZone(const std::string &name);
+			// The profiler that zones report to. nullptr if profiling is disabled.
+			static Profiler *getActive() { return active; }
+
+			void enter(ZoneID zone);
+			void leave();
+		private:
+			struct Frame
+			{
+				ZoneID zone;
+				Clock::time_point start;
+				Clock::duration children;
+			};
+
+			struct ZoneStatistics
+			{
+				size_t calls = 0;
+				Clock::duration total = Clock::duration::zero();
+				Clock::duration self = Clock::duration::zero();
+			};
+
+			struct TraceEvent
+			{
+				ZoneID zone;
+				Clock::time_point start;
+				Clock::duration duration;
+			};
+
+			struct ThreadBuffer
+			{
+				int threadIndex;
+				std::vector<Frame> stack;
+				// Indexed by ZoneID.
+				std::vector<ZoneStatistics> zones;
+				std::vector<TraceEvent> trace;
+			};
+
+			ThreadBuffer &getThreadBuffer();
+			void writeTrace();
+
+			// Per thread, so that parallel simulations each report to their own profiler.
+			static thread_local Profiler *active;
+			static std::mutex registryMutex;
+			static std::map<std::string, ZoneID> zoneIDs;
+			static std::vector<std::string> zoneNames;
+			// Identifies the profiler in the threads' buffer caches; an address can be reused by a later profiler.
+			static std::atomic<uint64_t> nextGeneration;
+			const uint64_t generation;
+
+			std::mutex buffersMutex;
+			std::vector<std::unique_ptr<ThreadBuffer>> threadBuffers;
+
+			Clock::time_point startTime;
+			Clock::time_point lastLogTime;
+			std::ofstream reportStream;
+			std::string reportFilename;
+			std::string traceFilename;
+			size_t maxTraceEvents;
+			std::atomic<size_t> traceEventCount;
+		};
+
+		/*
+			Attributes the time between construction and destruction to a zone.
+			Costs a single pointer check when profiling is disabled.
+		*/
+		class ProfilerZone
+		{
+		public:
+			explicit ProfilerZone(ZoneID zone) : profiler(Profiler::getActive())
+			{
+				if (profiler != nullptr) profiler->enter(zone);
+			}
+			~ProfilerZone()
+			{
+				if (profiler != nullptr) profiler->leave();
+			}
+			ProfilerZone(const ProfilerZone &) = delete;
+			ProfilerZone &operator=(const ProfilerZone &) = delete;
 		private:
+			Profiler *profiler;
 		};
 	}
 };
@@ -2,42 +2,40 @@
 
 #include <WinSock2.h>
 
-#include <regex>
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
 #include <filesystem>
 namespace filesystem = std::tr2::sys;
 
 #include <SimpleIni.h>
 
-#include "Indicators/TargetLookbackMean.h"
-
 #include "EnvironmentVariables.h"
 #include "Helpers.h"
 #include "Market.h"
+#include "SimulationContext.h"
 #include "Statistics.h"
 #include "Tick.h"
 #include "TradingDay.h"
 #include "Stock.h"
 #include "ExpertAdvisor.h"
-#include "IO/DataConverter.h"
-#include "IO/KeyValueDB.h"
 #include "VM/Profiler.h"
+#include "IO/Snapshot.h"
 
 
-MM::VirtualMarket *virtualMarket = nullptr;
-
 namespace MM
 {
 	void VirtualMarket::checkInit()
 	{
-		{ // scope
-			CSimpleIniA ini;
-			ini.LoadFile("market.ini");
+		CSimpleIniA ini;
+		ini.LoadFile(SimulationContext::current().getConfigurationFilename().c_str());
 
-			if (ini.IsEmpty())
-			{
-				std::cout << "ERROR: Could not load configuration!" << std::endl;
-			}
+		if (ini.IsEmpty())
+		{
+			std::cout << "ERROR: Could not load configuration!" << std::endl;
+		}
 
+		{ // scope
 			std::istringstream is(ini.GetValue("Virtual Market", "Enabled", "0"));
 			bool enabled;
 			is >> enabled;
@@ -45,138 +43,98 @@ namespace MM
 			if (!enabled) return;
 		}
 
-		virtualMarket = new VirtualMarket();
-		virtualMarket->init();
+		SimulationContext::current().virtualMarket.reset(new VirtualMarket());
+		virtualMarket()->init(static_cast<void*>(&ini));
 	}
 
 
-	void VirtualMarket::init()
+	void VirtualMarket::init(void *_ini, TickReplay *sharedReplay)
 	{
-		CSimpleIniA ini;
-		ini.LoadFile("market.ini");
+		const CSimpleIniA &ini = *(CSimpleIniA*)_ini;
 
-		// Init profiler.
+		// Init profiler. Simulations on a shared replay (parameter sweep, benchmark) are not profiled.
 		profiler = new vm::Profiler();
-		profiler->init(static_cast<void*>(&ini));
+		if (sharedReplay == nullptr)
+			profiler->init(_ini);
 
-		// Possibly convert some data files first.
-		io::KeyValueDB db("saves/virtual_market.datafiles");
-		size_t skipped = 0;
-
-		for (size_t i = 0; i < 10; ++i)
+		if (sharedReplay == nullptr)
 		{
-			const std::string configName = std::string("Virtual Market Data ") + std::to_string(i + 1);
-			const bool isRegexp = ini.GetLongValue(configName.c_str(), "Regexp", 0) == 1;
-			std::string baseFilename = ini.GetValue(configName.c_str(), "Filename", "");
-			if (baseFilename.empty()) continue;
-
-			std::vector<std::string> filenames;
-
-			if (!isRegexp) filenames = { baseFilename };
-			else
-			{
-				// Get all files in the directory.
-				const std::string directory = ini.GetValue(configName.c_str(), "Directory", ".");
-				// That matches the given filename-regexp.
-				std::regex filePattern(baseFilename);
-
-				filesystem::directory_iterator iter(directory), end;
-				for (; iter != end; ++iter)
-				{
-					const filesystem::path current = *iter;
-					const std::string currentName = current.filename().string();
-					if (!std::regex_match(currentName, filePattern)) continue;
-					
-					filenames.push_back(directory + "/" + currentName);
-				}
-			}
-
-			for (const std::string &filename : filenames)
-			{
-				// Check if already converted once.
-				if (db.get(filename) == "1")
-				{
-					skipped += 1;
-					continue;
-				}
-				std::cout << "Data file '" << filename << "': \t\tconverting file.." << std::endl;
-				std::string filetype = ini.GetValue(configName.c_str(), "Filetype", "");
-				// Try to read the file
-				io::DataConverter converter(filename, filetype);
-				if (converter.convert() == true)
-				{
-					db.put(filename, "1");
-				}
-				else
-				{
-					std::cout << "\t! Reading Data failed!" << std::endl;
-				}
-			}
+			ownReplay = std::make_unique<TickReplay>();
+			ownReplay->init(_ini);
+			replay = ownReplay.get();
 		}
-
-		if (skipped > 0)
-			std::cout << "Skipped " << skipped << " data input files." << std::endl;
-
-		auto readDate = [&](std::string key)
+		else
 		{
-			int day, month, year;
-			std::string dayString = ini.GetValue("Virtual Market", key.c_str(), "2014-01-30");
-			sscanf_s(dayString.c_str(), "%d-%d-%d", &year, &month, &day);
-			return QuantLib::Date(day, (QuantLib::Month)(month), year);
-		};
-		config.datePeriodBegin = readDate("Begin");
-		config.datePeriodEnd   = readDate("End");
-		config.date            = config.datePeriodBegin;
+			replay = sharedReplay;
+			config.printStatus = false;
+		}
 
 		// And set date as environment variable.
-		environmentVariables.set("YEAR", environmentVariables.get("YEAR") + std::to_string(config.datePeriodBegin.year()));
-
-		std::string hourString = ini.GetValue("Virtual Market", "Hours", "0-0");
-		sscanf_s(hourString.c_str(), "%d-%d", &config.fromHour, &config.toHour);
+		environmentVariables().set("YEAR", environmentVariables().get("YEAR") + std::to_string(replay->getPeriodBegin().year()));
 		
 		isSilent = ini.GetValue("Virtual Market", "Silent", "0") == std::string("1");
 		config.waitOnFinished = ini.GetValue("Virtual Market", "WaitOnFinished", "0") == std::string("1");
 		config.tradesLogFilename = ini.GetValue("Virtual Market", "TradesLogFilename", "saves/trades.tsv");
+		config.batchSteps = std::max(1L, ini.GetLongValue("Virtual Market", "BatchSteps", static_cast<long>(config.batchSteps)));
+		config.triggerLimits = ini.GetBoolValue("Virtual Market", "TriggerLimits", config.triggerLimits);
+		config.triggerSlippage = ini.GetDoubleValue("Virtual Market", "TriggerSlippage", config.triggerSlippage);
+		config.triggerLatency = std::max(0L, ini.GetLongValue("Virtual Market", "TriggerLatency", static_cast<long>(config.triggerLatency)));
+		config.checkpointFolder = environmentVariables().replace(ini.GetValue("Virtual Market", "CheckpointFolder", "saves/checkpoints"));
+		config.checkpointInterval = std::max(0, static_cast<int>(ini.GetLongValue("Virtual Market", "CheckpointInterval", config.checkpointInterval)));
+		// Every variant of a parameter sweep needs its own log.
+		if (sharedReplay != nullptr)
+			config.tradesLogFilename = ini.GetValue("Parameter Sweep", "TradesLogFilename", "saves/sweep/trades_{SWEEP_VARIANT}.tsv");
 		// update market to match settings
-		market.setVirtual(true);
-		market.setSleepDuration(0);
+		market().setVirtual(true);
+		market().setSleepDuration(0);
 
 		// feed statistics module
-		statistics.addVariable(Variable("price_estimate", &(currentEstimation.priceChangeEstimate), "Future-aware estimation of efficiency of trades."));
-
-		decltype(requiredSecondaryPairs) allPairs(requiredSecondaryPairs.begin(), requiredSecondaryPairs.end());
-		allPairs.push_back("EURUSD");
+		statistics().addVariable(Variable("price_estimate", &(currentEstimation.priceChangeEstimate), "Future-aware estimation of efficiency of trades."));
 
-		for (const std::string & pair : allPairs)
+		for (const std::string & pair : replay->getPairs())
 		{
-			statistics.addVariable(Variable(pair, std::bind(&VirtualMarket::getLastKnownPrice, this, pair), "Current price of " + pair + "."));
+			const SymbolID symbol = symbolTable().intern(pair);
+			statistics().addVariable(Variable(pair, std::bind(&VirtualMarket::getLastKnownPrice, this, symbol), "Current price of " + pair + "."));
 		}
+		lastKnownPrice.resize(symbolTable().size(), std::numeric_limits<double>::quiet_NaN());
+		lastTicks.resize(symbolTable().size(), nullptr);
 
-		prepareDayData();
-
-		std::cout << "------------VIRTUAL MARKET SETUP--------(" << config.fromHour << "-" << config.toHour << ")" << std::endl;
-		std::cout << "\tTOTAL TICK COUNT\t" << tradingDay->ticks.size() << std::endl;
-		std::cout << "\tSTARTING AT TICK\t" << tickIndex << std::endl;
-		std::cout << "\tFIRST TICK AT\t" << timeToString(tradingDay->ticks.front().getTime()) << std::endl;
-		std::cout << "\tLAST TICK AT\t" << timeToString(tradingDay->ticks.back().getTime()) << std::endl;
-		std::cout << "----------------------------------------------" << std::endl;
+		// Continue a previous run? "latest" (or 1) picks the most recent checkpoint of the folder.
+		const std::string resume = ini.GetValue("Virtual Market", "Resume", "");
+		if (!resume.empty() && resume != "0")
+		{
+			if (sharedReplay != nullptr)
+				std::cout << "WARNING: Resuming is not supported for parameter sweeps." << std::endl;
+			else
+			{
+				const std::string filename = (resume == "latest" || resume == "1") ? findLatestCheckpoint() : resume;
+				if (filename.empty())
+					std::cout << "WARNING: No checkpoint found in '" << config.checkpointFolder << "', starting from the beginning." << std::endl;
+				else
+					restoreCheckpoint(filename);
+			}
+		}
+		// Parameter sweeps drive the days themselves.
+		if (sharedReplay != nullptr)
+			config.checkpointInterval = 0;
 	}
 
 	VirtualMarket::VirtualMarket()
 	{
-		tradingDay = nullptr;
+		replay = nullptr;
 		tradeCounter = 1000;
-		lastTick = nullptr;
+		lastTickTime = 0;
+		nextBatchStep = 0;
+		lastStatusTime = 0;
+		daysSinceCheckpoint = 0;
 		results.totalProfitPips = 0.0;
 		results.wonTrades = results.lostTrades = 0;
-		config.fromHour = config.toHour = 0;
 		profiler = nullptr;
 	}
 
 
 	VirtualMarket::~VirtualMarket()
 	{
-		cleanUpDayData();
 		delete profiler;
 	}
 
@@ -190,218 +148,147 @@ namespace MM
 		saveTrades();
 	}
 
-	void VirtualMarket::advanceDay(bool noevaluation)
+	void VirtualMarket::finishDay()
 	{
 		// clean up remaining trades and possibly do some statistics
-		if (!noevaluation) evaluateDay();
-		// advance day and load new data.
-		config.date += QuantLib::Period(1, QuantLib::Days);
-		prepareDayData();
-	}
-
-	void VirtualMarket::cleanUpDayData()
-	{
-		// clean up old stuff
-		delete tradingDay;
-		for (auto &day : secondaryCurrencies)
-		{
-			delete day;
+		evaluateDay();
+		{ // scope
+			std::ostringstream os;
+			os << replay->getDate();
+			profiler->log(os.str());
 		}
-		secondaryCurrencies.clear();
-		secondaryCurrenciesIterators.clear();
 
 		trades.clear();
 		tradesMetaInfo.clear();
+		triggers.clear();
+		pendingExecutions.clear();
+		// The day data belongs to the replay and is about to be released.
+		std::fill(lastTicks.begin(), lastTicks.end(), nullptr);
 	}
 
-	void VirtualMarket::prepareDayData()
+	void VirtualMarket::finish()
 	{
-		cleanUpDayData();
-
-		// load tick data
-		tradingDay = new TradingDay(config.date, market.getStock("EURUSD", true));
-		tradingDay->loadFromFile();
-		
-		auto checkValid = [](TradingDay *tradingDay)
-		{
-			return tradingDay->ticks.size() > 15000;
-		};
-
-		auto skipDay = [&](int tickCount, std::string currencyPair)
-		{
-			std::cout << "WARNING: " << currencyPair << " day " << config.date << " has not enough ticks: " << tickCount << std::endl;
-			if (config.date <= config.datePeriodEnd)
-			{
-				advanceDay(true);
-				prepareDayData();
-			}
-			return;
-		};
-
-		// check if the day is even OK - arbitrary required tick count here
-		if (!checkValid(tradingDay))
+		if (config.printStatus)
 		{
-			return skipDay(tradingDay->ticks.size(), tradingDay->getCurrencyPair());
+			std::cout << "VIRTUAL MARKET IS DONE." << std::endl;
+			std::cout << "YOUR PROFIT:\t\t" << results.totalProfitPips << std::endl;
 		}
 
-		tickIndex = 0;
+		statistics().close();
+		profiler->close();
 
-		
-		for (std::string &pair : requiredSecondaryPairs)
+		if (config.waitOnFinished && config.printStatus)
 		{
-			TradingDay *secondaryDay = new TradingDay(config.date, market.getStock(pair, true));
-			secondaryCurrencies.push_back(secondaryDay);
-			secondaryDay->loadFromFile();
-
-			if (!checkValid(secondaryDay))
-				return skipDay(secondaryDay->ticks.size(), secondaryDay->getCurrencyPair());
+			getchar();
 		}
-
-		// fast forward to start of market day
-		if (config.fromHour > 0)
-		{
-			for (; tickIndex < tradingDay->ticks.size(); ++tickIndex)
-			{
-				Tick &tick = tradingDay->getTickByIndex(tickIndex);
-				std::time_t time = tick.getTime();
-				std::tm *tm = std::gmtime(&time);
-				if (tm->tm_hour < config.fromHour)
-				{
-					lastTick = &tick;
-					continue;
-				}
-				break;
-			}
-		}
-	}
-
-	double VirtualMarket::getLastKnownPrice(std::string currencyPair)
-	{
-		decltype(lastKnownPrice)::iterator iter = lastKnownPrice.find(currencyPair);
-		if (iter == lastKnownPrice.end()) return std::numeric_limits<double>::quiet_NaN();
-		return iter->second;
+		running = false;
 	}
 
-	bool VirtualMarket::isOutOfPeriod()
+	double VirtualMarket::getLastKnownPrice(SymbolID symbol)
 	{
-		return config.date > config.datePeriodEnd;
+		if (static_cast<size_t>(symbol) >= lastKnownPrice.size()) return std::numeric_limits<double>::quiet_NaN();
+		return lastKnownPrice[symbol];
 	}
 
 	void VirtualMarket::execute()
 	{
-		// Market is stop when no more ticks are available.
-		// This check is done in the beginning of the function, because at this point the market has processed any prior information.
-		if (tickIndex >= tradingDay->ticks.size())
+		// Steps already taken from the replay are delivered one by one, so that the market processes every step on its own.
+		if (nextBatchStep >= ownBatch.steps.size())
 		{
-			advanceDay();
-
-			if (isOutOfPeriod())
+			// Market is stop when no more ticks are available.
+			// This check is done in the beginning of the function, because at this point the market has processed any prior information.
+			if (replay->isDayFinished())
 			{
-				std::cout << "VIRTUAL MARKET IS DONE." << std::endl;
-				std::cout << "YOUR PROFIT:\t\t" << results.totalProfitPips << std::endl;
+				finishDay();
+				replay->advanceDay();
 
-				statistics.close();
+				if (replay->isOutOfPeriod())
+				{
+					finish();
+					return;
+				}
 
-				if (config.waitOnFinished)
+				if (config.checkpointInterval > 0 && ++daysSinceCheckpoint >= config.checkpointInterval)
 				{
-					getchar();
+					writeCheckpoint();
+					daysSinceCheckpoint = 0;
 				}
-				running = false;
-				return;
 			}
+
+			ownBatch.clear();
+			nextBatchStep = 0;
+			while (ownBatch.steps.size() < config.batchSteps && replay->nextStep(ownBatch));
+			if (ownBatch.steps.empty()) return;
 		}
 
-		// calculate predictive value of efficiency of trades executed at this time point
-		predictTradeEfficiency();
+		processStep(ownBatch, nextBatchStep++);
+	}
+
+	void VirtualMarket::processStep(const ReplayBatch &batch, size_t stepIndex)
+	{
+		const ReplayBatch::Step &step = batch.steps[stepIndex];
+		currentEstimation.priceChangeEstimate = step.priceChangeEstimate;
 
 		// send the general state of the market BEFORE the ticks
 		publishGeneralInfo();
 
-		// send next tick
-		std::time_t previousTime = 0;
-		if (lastTick) previousTime = lastTick->getTime();
+		const std::time_t previousTime = lastTickTime;
 
-		lastTick = &tradingDay->getTickByIndex(tickIndex++);
-		sendTickMsg(lastTick, tradingDay);
-		
-		// send all ticks of secondary currencies up to the time of the leading currency
-		if (secondaryCurrenciesIterators.empty())
-		{
-			for (TradingDay *&day : secondaryCurrencies)
-			{
-				secondaryCurrenciesIterators.push_back(day->ticks.begin());
-			}
-		}
-		
-		for (size_t secondaryIndex = 0; secondaryIndex < secondaryCurrencies.size(); ++secondaryIndex)
-		{
-			TradingDay *&day = secondaryCurrencies[secondaryIndex];
-			std::vector<Tick>::iterator &iter = secondaryCurrenciesIterators[secondaryIndex];
-			while (iter != day->ticks.end())
-			{
-				const Tick &tick = *iter;
-				// fast forward?
-				if (tick.getTime() <= previousTime)
-				{
-					++iter;
-					continue;
-				}
-				// too far..?
-				if (tick.getTime() > lastTick->getTime()) break;
-				assert(std::isnormal(tick.getAsk()));
-				assert(std::isnormal(tick.getBid()));
-				sendTickMsg(&tick, day);
-				++iter;
-			}
-		}
+		// All ticks of a step share their timestamp, so the events only need one date.
+		const QuantLib::Date receptionDate = QuantLib::Date::todaysDate();
+		const size_t end = batch.getTickEnd(stepIndex);
+		for (size_t i = step.firstTick; i < end; ++i)
+			sendTickMsg(batch.ticks[i].tick, batch.ticks[i].day, receptionDate);
 
-		// check end of market day
-		if ((config.toHour > 0) && (previousTime != 0))
+		// The status line only shows minutes.
+		if (config.printStatus && replay->hasClosingHour() && (previousTime != 0) && (previousTime / ONEMINUTE != lastStatusTime / ONEMINUTE))
 		{
+			lastStatusTime = previousTime;
+			const QuantLib::Date &date = replay->getDate();
 			std::tm *tm = std::gmtime(&previousTime);
-			printf("\r\tTIME %d-%02d-%02d %02d:%02d\tTRADES: %02d\tPROFIT: %.0f", config.date.year(), static_cast<int>(config.date.month()), config.date.dayOfMonth(), tm->tm_hour, tm->tm_min, trades.size(), results.totalProfitPips);
-			if (tm->tm_hour > config.toHour)
-			{
-				// fast forward to end
-				tickIndex = tradingDay->ticks.size();
-			}
+			printf("\r\tTIME %d-%02d-%02d %02d:%02d\tTRADES: %02d\tPROFIT: %.0f", date.year(), static_cast<int>(date.month()), date.dayOfMonth(), tm->tm_hour, tm->tm_min, trades.size(), results.totalProfitPips);
 		}
 	}
 
 	void VirtualMarket::publishGeneralInfo()
 	{
 		// account info message gets abused for the profit stuff
-		market.account.update(0.0, results.totalProfitPips, results.wonTrades, results.lostTrades);
-
-		// Clear all current trades in the market (same would be done by a conventional update message)
-		market.saveAndClearTrades();
-		// publish all currently open trades 
-		for (Trade &trade : trades)
-		{
-			// do not simply copy the trade to mimick the interface as closely as possible...
-			Trade *newTrade = new Trade();
-			newTrade->currencyPair = trade.currencyPair;
-			newTrade->lotSize = trade.lotSize;
-			newTrade->orderPrice = trade.orderPrice;
-			newTrade->setStopLossPrice(trade.getStopLossPrice());
-			newTrade->setTakeProfitPrice(trade.getTakeProfitPrice());
-			newTrade->ticketID = trade.ticketID;
-			newTrade->type = trade.type;
-
-			market.onNewTradeMessageReceived(newTrade);
-		}
+		market().account.update(0.0, results.totalProfitPips, results.wonTrades, results.lostTrades);
+
+		// publish all currently open trades (same as a conventional update message)
+		// Only the fields known to the interface are taken over, to mimick it as closely as possible.
+		market().beginOpenTradesUpdate();
+		for (const Trade &trade : trades)
+			market().onOpenTradeReceived(trade);
+		market().endOpenTradesUpdate();
 	}
 
-	void VirtualMarket::sendTickMsg(const Tick *tick, TradingDay *day)
+	void VirtualMarket::sendTickMsg(const Tick *tick, TradingDay *day, const QuantLib::Date &receptionDate)
 	{
-		lastKnownPrice[day->getCurrencyPair()] = tick->getMid();
-		market.onNewTickMessageReceived(day->getCurrencyPair(), tick->getBid(), tick->getAsk(), tick->getTime());
+		const SymbolID replaySymbol = day->getStock()->getSymbol();
+		if (static_cast<size_t>(replaySymbol) >= replaySymbols.size())
+			replaySymbols.resize(replaySymbol + 1, INVALID_SYMBOL);
+		SymbolID &symbol = replaySymbols[replaySymbol];
+		if (symbol == INVALID_SYMBOL)
+			symbol = symbolTable().intern(day->getCurrencyPair());
+		if (static_cast<size_t>(symbol) >= lastKnownPrice.size())
+		{
+			lastKnownPrice.resize(symbol + 1, std::numeric_limits<double>::quiet_NaN());
+			lastTicks.resize(symbol + 1, nullptr);
+		}
+		lastKnownPrice[symbol] = tick->getMid();
+		lastTicks[symbol] = tick;
+		lastTickTime = tick->getTime();
+		// The broker acts on the tick before the market sees it.
+		if (config.triggerLimits)
+			processTriggers(symbol, *tick);
+		market().onNewTickMessageReceived(symbol, tick->getBid(), tick->getAsk(), tick->getTime(), receptionDate);
 	}
 
-	template<> void VirtualMarket::onReceive<>(const ::Interface::MetaTrader::Message::NewOrder &data)
+	void VirtualMarket::onReceive(const ::Interface::MetaTrader::Message::NewOrder &data, const std::string &currencyPair)
 	{
 		Trade trade;
-		trade.currencyPair = "EURUSD";
+		trade.currencyPair = currencyPair;
 		trade.orderPrice = data.orderPrice;
 		trade.getTakeProfitPrice() = data.takeProfitPrice;
 		trade.getStopLossPrice() = data.stopLossPrice;
@@ -409,10 +296,11 @@ namespace MM
 		trade.type = (data.type == 0) ? Trade::T_BUY : Trade::T_SELL;
 
 		trade.ticketID = ++tradeCounter;
-		trade.removeSaveFile();
 
 		trades.push_back(trade);
-		tradesMetaInfo.emplace(trade.ticketID, VirtualTradeMetaInfo(trade.type, market.getLastTickTime()));
+		tradesMetaInfo.emplace(trade.ticketID, VirtualTradeMetaInfo(trade.currencyPair, trade.type, market().getLastTickTime()));
+		if (config.triggerLimits)
+			triggers.add(symbolTable().intern(currencyPair), trade.ticketID, trade.type, trade.getStopLossPrice(), trade.getTakeProfitPrice());
 	}
 
 	template<> void VirtualMarket::onReceive<>(const ::Interface::MetaTrader::Message::CloseOrder &data)
@@ -422,7 +310,7 @@ namespace MM
 			Trade &trade = *iter;
 			if (trade.ticketID != data.ticketID) continue;
 			evaluateTrade(trade);
-			trade.removeSaveFile();
+			triggers.remove(trade.ticketID);
 			trades.erase(iter);
 			break;
 		}
@@ -436,42 +324,79 @@ namespace MM
 			if (trade.ticketID != data.ticketID) continue;
 			trade.getTakeProfitPrice() = data.takeProfitPrice;
 			trade.getStopLossPrice() = data.stopLossPrice;
+			// Already triggered trades keep their pending execution.
+			if (config.triggerLimits && std::none_of(pendingExecutions.begin(), pendingExecutions.end(), [&](const PendingExecution &pending) { return pending.ticketID == trade.ticketID; }))
+				triggers.add(symbolTable().intern(trade.currencyPair), trade.ticketID, trade.type, trade.getStopLossPrice(), trade.getTakeProfitPrice());
 			break;
 		}
 	}
 
 	void VirtualMarket::evaluateTrade(const Trade &trade, bool forceful)
 	{
-		if (trade.currencyPair != tradingDay->getCurrencyPair()) return;
+		const SymbolID symbol = symbolTable().find(trade.currencyPair);
+		if (symbol == INVALID_SYMBOL || static_cast<size_t>(symbol) >= lastTicks.size()) return;
+		const Tick *lastTick = lastTicks[symbol];
+		if (lastTick == nullptr) return;
 
-		QuantLib::Decimal profit = trade.getProfitAtTick(*lastTick);
-		profit /= ONEPIP;
+		bookClosedTrade(trade, trade.getProfitAtTick(*lastTick), market().getLastTickTime(), forceful, 0);
+	}
+
+	void VirtualMarket::bookClosedTrade(const Trade &trade, QuantLib::Decimal profit, std::time_t closingTime, bool forceful, int trigger)
+	{
+		profit /= pipSize(trade.currencyPair);
 		
 		if (profit > 0.0) results.wonTrades += 1;
 		else if (profit < 0.0) results.lostTrades += 1;
 		results.totalProfitPips += profit;
 
-		tradesMetaInfo.at(trade.ticketID).setClosed(profit, market.getLastTickTime(), lastTick->getTime(), forceful);
+		tradesMetaInfo.at(trade.ticketID).setClosed(profit, closingTime, 0, forceful, trigger);
 	}
 
-	void VirtualMarket::predictTradeEfficiency()
+	void VirtualMarket::processTriggers(SymbolID symbol, const Tick &tick)
 	{
-		if (!lastTick) return;
+		// Tick times have a resolution of one second.
+		const int64_t now = static_cast<int64_t>(tick.getTime()) * 1000;
 
-		std::time_t time = lastTick->getTime();
-
-		const int lookaheadTime = 15 * ONEMINUTE;
-		std::time_t endTime = time + lookaheadTime;
-		if (endTime > tradingDay->ticks.back().getTime()) return;
+		// Closes that were triggered earlier and have waited long enough.
+		for (size_t i = 0; i < pendingExecutions.size();)
+		{
+			const PendingExecution pending = pendingExecutions[i];
+			if (pending.symbol != symbol || pending.dueTime > now)
+			{
+				++i;
+				continue;
+			}
+			pendingExecutions[i] = pendingExecutions.back();
+			pendingExecutions.pop_back();
+			executeTrigger(pending.ticketID, pending.kind, tick);
+		}
 
-		TimePeriod period = TimePeriod(nullptr, time, endTime, &Tick::getMid);
-		period.setTradingDay(tradingDay);
-		
-		PossibleDecimal open;
-		open = period.getOpen();
-		if (!open) return;
+		if (triggers.empty()) return;
+		firedTriggers.clear();
+		triggers.collect(symbol, tick.getBid(), tick.getAsk(), firedTriggers);
+		for (const TriggerBook::Fired &fired : firedTriggers)
+		{
+			if (config.triggerLatency == 0)
+				executeTrigger(fired.ticketID, fired.kind, tick);
+			else
+				pendingExecutions.push_back({ fired.ticketID, symbol, now + config.triggerLatency, fired.kind });
+		}
+	}
 
-		currentEstimation.priceChangeEstimate = Indicators::TargetLookbackMean::calculateTarget(period);
+	void VirtualMarket::executeTrigger(int32_t ticketID, TriggerBook::Kind kind, const Tick &tick)
+	{
+		auto iter = std::find_if(trades.begin(), trades.end(), [ticketID](const Trade &trade) { return trade.ticketID == ticketID; });
+		// Closed by the market in the meantime.
+		if (iter == trades.end()) return;
+		const Trade &trade = *iter;
+
+		// The close is executed at the current price, which may be worse than the level.
+		const QuantLib::Decimal slippage = config.triggerSlippage * pipSize(trade.currencyPair);
+		const QuantLib::Decimal profit = (trade.type == Trade::T_BUY)
+			? (tick.getBid() - slippage) - trade.orderPrice
+			: trade.orderPrice - (tick.getAsk() + slippage);
+		bookClosedTrade(trade, profit, tick.getTime(), false, kind);
+		trades.erase(iter);
 	}
 
 	void VirtualMarket::saveTrades()
@@ -482,13 +407,13 @@ namespace MM
 		else
 			mode |= std::ios_base::trunc;
 		// Open the output file (allow variables in the filename and make sure the path exists).
-		const std::string outputFilename = environmentVariables.replace(config.tradesLogFilename);
+		const std::string outputFilename = environmentVariables().replace(config.tradesLogFilename);
 		filesystem::path outputPath = filesystem::path(outputFilename).parent_path();
 		filesystem::create_directories(outputPath);
 		std::fstream output(outputFilename, mode);
 		// headlines only when exporting the trades for the very first day
 		if (!results.tradesHeaderPrinted)
-			output << "Trade ID\tOpening Time\tType\tProfit\tClosing Time\tForced Close" << std::endl;
+			output << "Trade ID\tOpening Time\tType\tProfit\tClosing Time\tForced Close\tCurrency Pair\tTrigger" << std::endl;
 
 		for (auto &data : tradesMetaInfo)
 		{
@@ -502,9 +427,194 @@ namespace MM
 				<< metaData.profit
 				<< "\t" << metaData.closingTime
 				<< "\t" << metaData.forcefulClose
+				<< "\t" << metaData.currencyPair
+				<< "\t" << metaData.trigger
 				<< std::endl;
 		}
 
 		results.tradesHeaderPrinted = true;
 	}
+
+	std::string VirtualMarket::getCheckpointFilename(const QuantLib::Date &date) const
+	{
+		// ISO dates, so that the latest checkpoint sorts last.
+		char name[64];
+		std::snprintf(name, sizeof(name), "checkpoint_%04d-%02d-%02d.mmcp", date.year(), static_cast<int>(date.month()), date.dayOfMonth());
+		return config.checkpointFolder + "/" + name;
+	}
+
+	std::string VirtualMarket::findLatestCheckpoint() const
+	{
+		const filesystem::path folder(config.checkpointFolder);
+		if (!filesystem::exists(folder)) return "";
+
+		std::string latest;
+		filesystem::directory_iterator iter(folder), end;
+		for (; iter != end; ++iter)
+		{
+			const filesystem::path current = *iter;
+			const std::string currentName = current.filename().string();
+			if (currentName.compare(0, 11, "checkpoint_") != 0 || current.extension().string() != ".mmcp") continue;
+			if (currentName > latest) latest = currentName;
+		}
+		if (latest.empty()) return "";
+		return config.checkpointFolder + "/" + latest;
+	}
+
+	void VirtualMarket::writeCheckpoint()
+	{
+		static const vm::ZoneID profilerZone = vm::Profiler::registerZone("VirtualMarket::writeCheckpoint");
+		vm::ProfilerZone zone(profilerZone);
+
+		io::SnapshotWriter writer;
+		writer.beginSection("virtual market");
+		serialize(writer);
+		writer.endSection();
+		writer.beginSection("market");
+		market().serialize(writer);
+		writer.endSection();
+		writer.beginSection("statistics");
+		statistics().serialize(writer);
+		writer.endSection();
+
+		filesystem::create_directories(filesystem::path(config.checkpointFolder));
+		const std::string filename = getCheckpointFilename(replay->getDate());
+		if (!writer.save(filename))
+			std::cout << "WARNING: Could not write checkpoint '" << filename << "'." << std::endl;
+	}
+
+	bool VirtualMarket::restoreCheckpoint(const std::string &filename)
+	{
+		io::SnapshotReader reader;
+		if (!reader.load(filename))
+		{
+			std::cout << "WARNING: Could not read checkpoint '" << filename << "', starting from the beginning." << std::endl;
+			return false;
+		}
+		std::cout << "RESUMING FROM " << filename << std::endl;
+
+		std::string name;
+		io::SnapshotReader contents;
+		while (reader.nextSection(name, contents))
+		{
+			if (name == "virtual market")
+				deserialize(contents);
+			else if (name == "market")
+				market().deserialize(contents);
+			else if (name == "statistics")
+				statistics().deserialize(contents);
+			else
+				std::cout << "WARNING: Checkpoint contains unknown state '" << name << "', ignored." << std::endl;
+
+			if (!contents.good())
+				std::cout << "WARNING: Incomplete checkpoint state of '" << name << "'." << std::endl;
+		}
+		return true;
+	}
+
+	void VirtualMarket::serialize(io::SnapshotWriter &writer)
+	{
+		// The day to continue with.
+		writer.write(static_cast<int64_t>(replay->getDate().serialNumber()));
+		writer.write(tradeCounter);
+		writer.write(results.totalProfitPips);
+		writer.write(results.wonTrades);
+		writer.write(results.lostTrades);
+		writer.write(results.tradesHeaderPrinted);
+
+		// The trades log is truncated to this size on resume.
+		const std::string tradesLogFilename = environmentVariables().replace(config.tradesLogFilename);
+		uint64_t tradesLogSize = 0;
+		if (results.tradesHeaderPrinted && filesystem::exists(filesystem::path(tradesLogFilename)))
+			tradesLogSize = static_cast<uint64_t>(filesystem::file_size(filesystem::path(tradesLogFilename)));
+		writer.write(tradesLogSize);
+
+		writer.write(static_cast<uint32_t>(trades.size()));
+		for (Trade &trade : trades)
+		{
+			writer.write(trade.currencyPair);
+			writer.write(trade.orderPrice);
+			writer.write(trade.lotSize);
+			writer.write(trade.ticketID);
+			writer.write(trade.type);
+			writer.write(trade.getTakeProfitPrice());
+			writer.write(trade.getStopLossPrice());
+		}
+
+		writer.write(static_cast<uint32_t>(tradesMetaInfo.size()));
+		for (const auto &data : tradesMetaInfo)
+		{
+			const VirtualTradeMetaInfo &metaData = data.second;
+			writer.write(data.first);
+			writer.write(metaData.currencyPair);
+			writer.write(metaData.type);
+			writer.write(metaData.openingTime);
+			writer.write(metaData.profit);
+			writer.write(metaData.closingTime);
+			writer.write(metaData.forcefulClose);
+			writer.write(metaData.trigger);
+		}
+	}
+
+	void VirtualMarket::deserialize(io::SnapshotReader &reader)
+	{
+		const int64_t dateSerial = reader.read<int64_t>();
+		reader.read(tradeCounter);
+		reader.read(results.totalProfitPips);
+		reader.read(results.wonTrades);
+		reader.read(results.lostTrades);
+		reader.read(results.tradesHeaderPrinted);
+		const uint64_t tradesLogSize = reader.read<uint64_t>();
+
+		trades.clear();
+		const uint32_t tradeCount = reader.read<uint32_t>();
+		for (uint32_t i = 0; i < tradeCount && reader.good(); ++i)
+		{
+			Trade trade;
+			reader.read(trade.currencyPair);
+			reader.read(trade.orderPrice);
+			reader.read(trade.lotSize);
+			reader.read(trade.ticketID);
+			reader.read(trade.type);
+			reader.read(trade.getTakeProfitPrice());
+			reader.read(trade.getStopLossPrice());
+			trades.push_back(trade);
+		}
+
+		tradesMetaInfo.clear();
+		const uint32_t metaInfoCount = reader.read<uint32_t>();
+		for (uint32_t i = 0; i < metaInfoCount && reader.good(); ++i)
+		{
+			const int32_t ID = reader.read<int32_t>();
+			const std::string currencyPair = reader.read<std::string>();
+			const Trade::Type type = reader.read<Trade::Type>();
+			const std::time_t openingTime = reader.read<std::time_t>();
+			VirtualTradeMetaInfo metaData(currencyPair, type, openingTime);
+			reader.read(metaData.profit);
+			reader.read(metaData.closingTime);
+			reader.read(metaData.forcefulClose);
+			if (reader.getVersion() >= 2)
+				reader.read(metaData.trigger);
+			tradesMetaInfo.emplace(ID, metaData);
+		}
+
+		triggers.clear();
+		pendingExecutions.clear();
+		if (config.triggerLimits)
+		{
+			for (const Trade &trade : trades)
+				triggers.add(symbolTable().intern(trade.currencyPair), trade.ticketID, trade.type, trade.getStopLossPrice(), trade.getTakeProfitPrice());
+		}
+
+		if (!reader.good() || dateSerial == 0) return;
+
+		// Trades that were logged after the checkpoint would otherwise appear twice.
+		const filesystem::path tradesLogPath(environmentVariables().replace(config.tradesLogFilename));
+		if (results.tradesHeaderPrinted && filesystem::exists(tradesLogPath) && filesystem::file_size(tradesLogPath) >= tradesLogSize)
+			filesystem::resize_file(tradesLogPath, tradesLogSize);
+		else
+			results.tradesHeaderPrinted = false;
+
+		replay->seekDay(QuantLib::Date(static_cast<QuantLib::BigInteger>(dateSerial)));
+	}
 };
\ No newline at end of file
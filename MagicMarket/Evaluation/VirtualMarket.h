@@ -7,8 +7,12 @@
 #include <queue>
 #include <map>
 #include <ctime>
+#include <memory>
 #include "Trade.h"
+#include "SymbolTable.h"
 #include "Interfaces/MTInterface.h"
+#include "TickReplay.h"
+#include "TriggerBook.h"
 
 namespace MM
 {
@@ -19,9 +23,15 @@ namespace MM
 	{
 		class Profiler;
 	};
+	namespace io
+	{
+		class SnapshotWriter;
+		class SnapshotReader;
+	};
 
 	struct VirtualTradeMetaInfo
 	{
+		std::string currencyPair;
 		Trade::Type type;
 		std::time_t openingTime;
 		double profit;
@@ -29,20 +39,25 @@ namespace MM
 		std::time_t closingTime;
 		// whether the trade was automatically closed at the end of a day
 		int forcefulClose;
-		VirtualTradeMetaInfo(Trade::Type type, std::time_t openingTime) :
+		// TriggerBook::Kind if the trade was closed by its stop loss or take profit, 0 otherwise
+		int trigger;
+		VirtualTradeMetaInfo(const std::string &currencyPair, Trade::Type type, std::time_t openingTime) :
+			currencyPair(currencyPair),
 			type(type),
 			openingTime(openingTime),
-			forcefulClose(0)
+			forcefulClose(0),
+			trigger(0)
 		{
 			profit = 0.0;
 			closingTime = 0;
 		}
 
-		void VirtualTradeMetaInfo::setClosed(double profit, std::time_t closingTime, int closingSnapshotIndex, bool forceful = false)
+		void VirtualTradeMetaInfo::setClosed(double profit, std::time_t closingTime, int closingSnapshotIndex, bool forceful = false, int trigger = 0)
 		{
 			this->profit = profit;
 			this->closingTime = closingTime;
 			this->forcefulClose = forceful ? 1 : 0;
+			this->trigger = trigger;
 		}
 	};
 
@@ -54,58 +69,102 @@ namespace MM
 
 		
 		static void checkInit();
+		/*
+			Without a shared replay, the virtual market loads the tick data itself and is driven by execute().
+			Otherwise, the owner of the replay drives it through processStep(), finishDay() and finish().
+		*/
+		void init(void *ini, TickReplay *sharedReplay = nullptr);
 		void evaluate();
 
 		// called by the market
 		template<typename T> void onReceive(const T &data);
+		// The order message does not carry the pair; the MetaTrader bridge trades the pair of its chart.
+		void onReceive(const ::Interface::MetaTrader::Message::NewOrder &data, const std::string &currencyPair);
 		void execute();
 		bool isRunning() { return running; }
 
+		// Publishes one step of the replay to the market.
+		void processStep(const ReplayBatch &batch, size_t stepIndex);
+		// Has to be called before the replay advances to the next day.
+		void finishDay();
+		void finish();
+
+		QuantLib::Decimal getTotalProfitPips() const { return results.totalProfitPips; }
+		double getWonTrades() const { return results.wonTrades; }
+		double getLostTrades() const { return results.lostTrades; }
+
 		// config
 		bool isSilent;
 
 	private:
 		std::queue<std::string> pendingMessages;
 
-		void init();
 		bool running = true;
 		void evaluateTrade(const Trade &trade, bool forceful = false);
+		// Profit in price units.
+		void bookClosedTrade(const Trade &trade, QuantLib::Decimal profit, std::time_t tickTime, bool forceful, int trigger);
 		int tradeCounter;
 		std::vector<Trade> trades;
 		std::map<int32_t, VirtualTradeMetaInfo> tradesMetaInfo;
 		
-		void sendTickMsg(const Tick *tick, TradingDay *day);
+		void sendTickMsg(const Tick *tick, TradingDay *day, const QuantLib::Date &receptionDate);
 		void publishGeneralInfo();
 
-		// this is always the leading currency
-		TradingDay *tradingDay;
-		size_t tickIndex;
-		Tick *lastTick;
-		// the secondary currencies follow the timing of the primary one
-		std::vector<std::string> requiredSecondaryPairs = { "EURCHF", "EURGBP", "GBPUSD", "USDCHF", "USDJPY" };
-		std::vector<TradingDay*> secondaryCurrencies;
-		std::vector<std::vector<Tick>::iterator> secondaryCurrenciesIterators;
+		std::unique_ptr<TickReplay> ownReplay;
+		TickReplay *replay;
+		// Used when driven by execute(), which pulls several steps from the replay at once.
+		ReplayBatch ownBatch;
+		size_t nextBatchStep;
+		// Tick time of the last status line.
+		std::time_t lastStatusTime;
+
+		// Stop loss and take profit levels of the open trades.
+		TriggerBook triggers;
+		std::vector<TriggerBook::Fired> firedTriggers;
+		// Triggered closes that wait for the latency. They are executed at the first tick of their symbol after the due time.
+		struct PendingExecution
+		{
+			int32_t ticketID;
+			SymbolID symbol;
+			// In milliseconds, compared against the whole-second tick times.
+			int64_t dueTime;
+			TriggerBook::Kind kind;
+		};
+		std::vector<PendingExecution> pendingExecutions;
+		void processTriggers(SymbolID symbol, const Tick &tick);
+		void executeTrigger(int32_t ticketID, TriggerBook::Kind kind, const Tick &tick);
+
+		// Last tick of every symbol on the current day. Indexed by SymbolID.
+		std::vector<const Tick*> lastTicks;
+		std::time_t lastTickTime;
 		
-		// This is used to supply variables with required information.
-		std::map<std::string, double> lastKnownPrice;
-		double getLastKnownPrice(std::string currencyPair);
+		// This is used to supply variables with required information. Indexed by SymbolID.
+		std::vector<double> lastKnownPrice;
+		double getLastKnownPrice(SymbolID symbol);
+		// Maps the symbols of the replay's market to the ones of this market. They differ if the replay is shared.
+		std::vector<SymbolID> replaySymbols;
 
 		// config
 		struct _config
 		{
-			QuantLib::Date datePeriodBegin, datePeriodEnd;
-			QuantLib::Date date;
-			int fromHour, toHour;
 			bool waitOnFinished = true;
+			bool printStatus = true;
+			size_t batchSteps = 1024;
+			// Whether the virtual market closes trades at their stop loss and take profit itself.
+			bool triggerLimits = false;
+			// Adverse price change of triggered closes, in pips.
+			double triggerSlippage = 0.0;
+			// Delay between crossing a level and the execution, in milliseconds. Ticks only have whole seconds,
+			// so any latency above 0 is effectively rounded up to full seconds.
+			int64_t triggerLatency = 0;
 			std::string tradesLogFilename;
+			std::string checkpointFolder;
+			// In days; 0 disables checkpoints.
+			int checkpointInterval = 0;
 		} config;
 		
 
 		void evaluateDay();
-		void advanceDay(bool noevaluation = false);
-		void cleanUpDayData();
-		void prepareDayData();
-		bool isOutOfPeriod();
 
 		// evaluation and statistics
 		struct _estimation
@@ -126,10 +185,23 @@ namespace MM
 		} results;
 
 		vm::Profiler *profiler;
-		void predictTradeEfficiency();
 		void saveTrades();
+
+		/*
+			Checkpoints are written at day boundaries and contain everything needed to continue the simulation with the next day:
+			the results and trades of the virtual market, the state of the market (see Market::serialize) and the statistics output position.
+			Only available when the virtual market drives its own replay.
+		*/
+		int daysSinceCheckpoint;
+		std::string getCheckpointFilename(const QuantLib::Date &date) const;
+		std::string findLatestCheckpoint() const;
+		void writeCheckpoint();
+		bool restoreCheckpoint(const std::string &filename);
+		void serialize(io::SnapshotWriter &writer);
+		void deserialize(io::SnapshotReader &reader);
 	};
 
 };
 
-extern MM::VirtualMarket *virtualMarket;
\ No newline at end of file
+// Of the simulation bound to the calling thread, see SimulationContext. nullptr if the virtual market is disabled.
+MM::VirtualMarket *virtualMarket();
\ No newline at end of file
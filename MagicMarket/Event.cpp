@@ -4,13 +4,13 @@
 
 namespace MM
 {
-	Event::Event(Event::Type type) : type(type)
+	Event::Event(Event::Type type) : type(type), symbol(INVALID_SYMBOL)
 	{
 
 	}
 
-	Event::Event(Event::Type type, std::string currencyPair, QuantLib::Date date, std::time_t time) :
-		type(type), currencyPair(currencyPair), date(date), time(time)
+	Event::Event(Event::Type type, SymbolID symbol, QuantLib::Date date, std::time_t time) :
+		type(type), symbol(symbol), date(date), time(time)
 	{
 		assert(type == Event::Type::NEW_TICK);
 	}
@@ -18,7 +18,7 @@ namespace MM
 	bool Event::operator==(const Event &other) const
 	{
 		return (type == other.type)
-			&& (currencyPair == other.currencyPair)
+			&& (symbol == other.symbol)
 			&& (date == other.date)
 			&& (time == other.time);
 	}
@@ -26,7 +26,7 @@ namespace MM
 	bool Event::youngerThan(const Event &other) const
 	{
 		return (type == other.type)
-			&& (currencyPair == other.currencyPair)
+			&& (symbol == other.symbol)
 			&& ((date < other.date) || (time < other.time));
 	}
 
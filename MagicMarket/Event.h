@@ -1,11 +1,14 @@
 #pragma once
 
 #include <string>
+#include <chrono>
 #include <ctime>
 
 #include <ql/types.hpp>
 #include <ql/time/date.hpp>
 
+#include "SymbolTable.h"
+
 namespace MM
 {
 
@@ -21,12 +24,14 @@ namespace MM
 		Type type;
 
 		Event(Event::Type type);
-		Event(Event::Type type, std::string currencyPair, QuantLib::Date date, std::time_t time);
+		Event(Event::Type type, SymbolID symbol, QuantLib::Date date, std::time_t time);
 		~Event() {};
 
-		std::string currencyPair;
+		SymbolID symbol;
 		QuantLib::Date date;
 		std::time_t time;
+		// When the underlying message arrived at the MetaTrader interface. Not set in the virtual market.
+		std::chrono::steady_clock::time_point receivedAt;
 
 		bool operator==(const Event &other) const;
 		bool youngerThan(const Event &other) const;
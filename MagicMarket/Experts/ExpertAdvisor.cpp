@@ -2,6 +2,7 @@
 #include "Market.h"
 
 #include "Statistics.h"
+#include "IO/Snapshot.h"
 
 namespace MM
 {
@@ -27,7 +28,7 @@ namespace MM
 		if (message[0] != '@' && message == lastMessage) return;
 		lastMessage = message;
 
-		market.chat(getName(), message);
+		market().chat(getName(), message);
 	}
 
 	void ExpertAdvisor::setMood(float mood, float certainty)
@@ -48,6 +49,18 @@ namespace MM
 
 	void ExpertAdvisor::exportVariable(std::string name, std::function<double()> accessor, std::string description) const
 	{
-		statistics.addVariable(Variable(name, accessor, description));
+		statistics().addVariable(Variable(name, accessor, description));
+	}
+
+	void ExpertAdvisor::serialize(io::SnapshotWriter &writer) const
+	{
+		writer.write(lastMood);
+		writer.write(lastCertainty);
+	}
+
+	void ExpertAdvisor::deserialize(io::SnapshotReader &reader)
+	{
+		reader.read(lastMood);
+		reader.read(lastCertainty);
 	}
 };
\ No newline at end of file
@@ -12,6 +12,11 @@ namespace MM
 {
 	class Trade;
 	struct Variable;
+	namespace io
+	{
+		class SnapshotWriter;
+		class SnapshotReader;
+	};
 
 	class ExpertAdvisor
 	{
@@ -51,6 +56,11 @@ namespace MM
 		virtual void afterExportsDeclared() {};
 		// Can be used to make sure that this expert is evaluated after the experts it depends on.
 		virtual std::vector<std::string> getRequiredExperts() const { return{}; }
+
+		// Checkpointing of the internal state (see VirtualMarket). Overrides have to call their base class first.
+
+		virtual void serialize(io::SnapshotWriter &writer) const;
+		virtual void deserialize(io::SnapshotReader &reader);
 	private:
 		std::string lastMessage;
 		float lastMood, lastCertainty;
@@ -66,7 +66,7 @@ namespace MM
 		// get stock data
 		for (std::string &stockName : stocksToEvaluate)
 		{
-			Stock *stock = market.getStock(stockName);
+			Stock *stock = market().getStock(stockName);
 			if (stock == nullptr)
 			{
 				std::ostringstream os; os << "Could not load stock " << stockName;
@@ -5,6 +5,7 @@
 #include "Tick.h"
 #include "Helpers.h"
 #include "Trade.h"
+#include "IO/Snapshot.h"
 
 #include <algorithm>
 
@@ -18,6 +19,12 @@ namespace MM
 	
 	ExpertAdvisorBroker::ExpertAdvisorBroker()
 	{
+		stock = market().getStock("EURUSD", true);
+
+		config.cooldown = static_cast<std::time_t>(market().getParameter("Broker.Cooldown", ONEMINUTE));
+		config.confidenceMargin = market().getParameter("Broker.ConfidenceMargin", 0.4);
+		config.unanimityMargin = market().getParameter("Broker.UnanimityMargin", 0.25);
+		config.lotSize = market().getParameter("Broker.LotSize", 0.05);
 	}
 
 
@@ -27,12 +34,12 @@ namespace MM
 
 	void ExpertAdvisorBroker::onNewTick(const std::string &currencyPair, const QuantLib::Date &date, const std::time_t &time)
 	{
-		if (currencyPair != "EURUSD") return;
+		if (currencyPair != stock->getCurrencyPair()) return;
 
 		// cooldown!
-		if ((lastExecutionActionTime != 0) && (time < lastExecutionActionTime + ONEMINUTE)) return;
+		if ((lastExecutionActionTime != 0) && (time < lastExecutionActionTime + config.cooldown)) return;
 
-		std::vector<ExpertAdvisor*> &experts = market.getExperts();
+		std::vector<ExpertAdvisor*> &experts = market().getExperts();
 		double avgMood = 0.0;
 		double certaintySum = 0.0;
 		double avgCertaintyNormalized = 0.0;
@@ -59,12 +66,11 @@ namespace MM
 			avgCertainty = std::abs(avgCertaintyNormalized) / static_cast<double>(expertCount);
 		}
 
-		const double confidenceMargin = 0.4;
-		double ownCertainty = std::min(1.0, avgCertainty / confidenceMargin);
-		const double unanimityMargin = 0.25; // if the experts are very confident but all say different things - nope...
+		double ownCertainty = std::min(1.0, avgCertainty / config.confidenceMargin);
+		// if the experts are very confident but all say different things - nope...
 		double ownMood = 0.0;
-		if (avgMood <= -unanimityMargin) ownMood = -1.0;
-		else if (avgMood >= +unanimityMargin) ownMood = +1.0;
+		if (avgMood <= -config.unanimityMargin) ownMood = -1.0;
+		else if (avgMood >= +config.unanimityMargin) ownMood = +1.0;
 		setMood(ownMood, ownCertainty);
 
 		// okay, now execute whatever shit we need to satisfy our raving bunch of experts
@@ -77,7 +83,7 @@ namespace MM
 		// but only if we don't already have 2 trades of that type pending
 		int existingTradeCount = 0;
 		int otherTypeTradeCount = 0;
-		std::vector<Trade*> &currentTrades = market.getOpenTrades();
+		std::vector<Trade*> &currentTrades = market().getOpenTrades();
 
 		for (Trade *& trade : currentTrades)
 		{
@@ -99,7 +105,6 @@ namespace MM
 		lastExecutionActionTime = time;
 
 		QuantLib::Decimal orderPrice = 0.0;
-		Stock *stock = market.getStock(currencyPair);
 		if (!stock)
 		{
 			say("No stock data.");
@@ -116,18 +121,31 @@ namespace MM
 			return;
 		}
 
-		QuantLib::Decimal lotSize = 0.05 * Math::clamp(avgCertainty, 0.25, 1.0);
+		QuantLib::Decimal lotSize = config.lotSize * Math::clamp(avgCertainty, 0.25, 1.0);
 
 		Trade trade;
 		trade.currencyPair = currencyPair;
 		trade.lotSize = lotSize;
 		trade.type = type;
 		trade.orderPrice = *close;
-		const QuantLib::Decimal initialStopLoss = ONEPIP * market.getInitialStopLoss() * ((type == Trade::T_BUY) ? -1.0 : +1.0);
+		const QuantLib::Decimal initialStopLoss = ONEPIP * market().getInitialStopLoss() * ((type == Trade::T_BUY) ? -1.0 : +1.0);
 		trade.setStopLossPrice(trade.orderPrice + initialStopLoss);
-		market.newTrade(trade);
+		market().newTrade(trade);
 
 		std::ostringstream os; os << "@" << currencyPair << " executed " << action << " !!";
 		say(os.str());
 	}
+
+	void ExpertAdvisorBroker::serialize(io::SnapshotWriter &writer) const
+	{
+		ExpertAdvisor::serialize(writer);
+		writer.write(lastExecutionActionTime);
+	}
+
+	void ExpertAdvisorBroker::deserialize(io::SnapshotReader &reader)
+	{
+		ExpertAdvisor::deserialize(reader);
+		reader.read(lastExecutionActionTime);
+	}
+
 };
\ No newline at end of file
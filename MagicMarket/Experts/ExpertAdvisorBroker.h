@@ -4,6 +4,7 @@
 
 namespace MM
 {
+	class Stock;
 
 	class ExpertAdvisorBroker : public ExpertAdvisor
 	{
@@ -17,8 +18,23 @@ namespace MM
 		//virtual void execute(std::time_t secondsPassed);
 		virtual void onNewTick(const std::string &currencyPair, const QuantLib::Date &date, const std::time_t &time);
 		virtual std::vector<std::string> getRequiredExperts() const override { return{ "*" }; }
+
+		virtual void serialize(io::SnapshotWriter &writer) const override;
+		virtual void deserialize(io::SnapshotReader &reader) override;
+
 	private:
 		std::time_t lastExecutionActionTime;
+		// The broker only trades the leading pair.
+		Stock *stock;
+
+		// Can be swept, see Market::getParameter.
+		struct _config
+		{
+			std::time_t cooldown;
+			double confidenceMargin;
+			double unanimityMargin;
+			QuantLib::Decimal lotSize;
+		} config;
 	};
 
 };
\ No newline at end of file
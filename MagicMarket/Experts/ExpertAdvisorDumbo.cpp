@@ -18,6 +18,7 @@ namespace MM
 
 	ExpertAdvisorDumbo::ExpertAdvisorDumbo()
 	{
+		stock = market().getStock("EURUSD", true);
 	}
 
 
@@ -33,7 +34,7 @@ namespace MM
 		//if (time % (60 * 30) != 0)
 		//	return;
 
-		std::string currencyPair = "EURUSD";
+		const std::string &currencyPair = stock->getCurrencyPair();
 
 		std::tm *tm = std::gmtime(&time);
 
@@ -44,7 +45,6 @@ namespace MM
 			return;
 		}
 
-		Stock *stock = market.getStock(currencyPair);
 		TimePeriod pips = stock->getTimePeriod(time - 30 * ONEMINUTE, time);
 		PossibleDecimal close(pips.getClose()), open(pips.getOpen());
 
@@ -4,6 +4,8 @@
 namespace MM
 {
 
+	class Stock;
+
 	class ExpertAdvisorDumbo : public ExpertAdvisor
 	{
 	public:
@@ -16,6 +18,8 @@ namespace MM
 
 		virtual void execute(const std::time_t &secondsSinceStart, const std::time_t &time);
 		virtual void onNewTick(const std::string &currencyPair, const QuantLib::Date &date, const std::time_t &time);
+	private:
+		Stock *stock;
 	};
 
 }
\ No newline at end of file
@@ -8,6 +8,7 @@
 
 #include <tuple>
 #include <algorithm>
+#include <limits>
 
 std::tuple<std::string, std::string> unwrapVariableNameDesc(std::string variableNameDesc)
 {
@@ -46,7 +47,7 @@ namespace MM
 			{
 				std::string name, desc;
 				std::tie(name, desc) = unwrapVariableNameDesc(variableNameDesc);
-				statistics.addVariable(Variable(name, &providedVariables[counter], desc));
+				statistics().addVariable(Variable(name, &providedVariables[counter], desc));
 
 				counter += 1;
 			}
@@ -183,11 +184,10 @@ namespace MM
 		{
 			std::string name, desc;
 			std::tie(name, desc) = unwrapVariableNameDesc(namedesc);
-			Variable var = statistics.getVariableByNameDescription(name, desc);
-			const bool isNan = var.isNan();
-			variables.push_back(std::move(var));
+			const VariableID id = statistics().findVariable(name, desc);
+			variableIDs.push_back(id);
 
-			if (isNan)
+			if (id == INVALID_VARIABLE)
 			{
 				std::cout << "\tWARNING: variable not found: '" << name << "': '" << desc << "'" << std::endl;
 			}
@@ -206,8 +206,8 @@ namespace MM
 		// Construct message made up from all the observed variables.
 		Interfaces::ExpertMessage message;
 		message.set_type(messageType);
-		for (const Variable &var : variables)
-			message.add_variables(var.get());
+		for (const VariableID id : variableIDs)
+			message.add_variables((id != INVALID_VARIABLE) ? statistics().getValue(id) : std::numeric_limits<double>::quiet_NaN());
 		send(message);
 		
 		Interfaces::ExpertMessage reply = receive();
@@ -1,5 +1,6 @@
 #pragma once
 #include "ExpertAdvisor.h"
+#include "Statistics.h"
 
 #include <memory>
 #include <zmq.hpp>
@@ -12,8 +13,6 @@ namespace Interfaces
 
 namespace MM
 {
-	struct Variable;
-
 	class ExpertAdvisorExternal : public ExpertAdvisor
 	{
 	public:
@@ -42,7 +41,8 @@ namespace MM
 		void send(Interfaces::ExpertMessage &message);
 		Interfaces::ExpertMessage receive();
 
-		std::vector<Variable> variables;
+		// Positions of the required variables in the statistics snapshot; INVALID_VARIABLE if unknown.
+		std::vector<VariableID> variableIDs;
 		std::vector<std::string> requiredVariables;
 		std::vector<double> providedVariables;
 		std::vector<std::string> providedVariableNames;
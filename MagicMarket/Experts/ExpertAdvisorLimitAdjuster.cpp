@@ -3,6 +3,7 @@
 #include "Statistics.h"
 #include "Trade.h"
 #include "Stock.h"
+#include "IO/Snapshot.h"
 
 namespace MM
 {
@@ -25,7 +26,7 @@ namespace MM
 	{
 		ExpertAdvisor::declareExports();
 
-		statistics.addVariable(Variable("hour_of_day", [&](){ return static_cast<double>(this->hourOfDay); }, "Hour of the trading day (GMT)."));
+		statistics().addVariable(Variable("hour_of_day", [&](){ return static_cast<double>(this->hourOfDay); }, "Hour of the trading day (GMT)."));
 	}
 
 
@@ -41,12 +42,12 @@ namespace MM
 		std::string message = "";
 		int badTradeCount = 0;
 		// check all open trades and see if we can adjust the panic limit
-		std::vector<Trade*> &trades = market.getOpenTrades();
+		std::vector<Trade*> &trades = market().getOpenTrades();
 		//for (Trade *&trade : trades)
 		for (std::vector<Trade*>::iterator iter = trades.begin(); iter != trades.end(); ++iter)
 		{
 			Trade *&trade = *iter;
-			Stock * stock = market.getStock(trade->currencyPair);
+			Stock * stock = market().getStock(trade->currencyPair);
 			if (!stock)
 			{
 				message = "I can't judge " + trade->currencyPair;
@@ -81,7 +82,7 @@ namespace MM
 				if (improvement)
 				{
 					trade->setStopLossPrice(stopLoss);
-					market.updateTrade(trade);
+					market().updateTrade(trade);
 					std::ostringstream os; os << "@" << trade->currencyPair << "/" << *closePos << " set SL/" << stopLoss;
 					say(os.str());
 				}
@@ -100,14 +101,14 @@ namespace MM
 				|| ((trade->getTakeProfitPrice() != 0.0) && ((*closePos - ONEPIP) > trade->getTakeProfitPrice()))))
 				closeTrade = true;
 			// Now enforce default stop loss.
-			if (market.getInitialStopLoss() != 0.0)
-				closeTrade = closeTrade || (profitPips <= -market.getInitialStopLoss() * ONEPIP);
+			if (market().getInitialStopLoss() != 0.0)
+				closeTrade = closeTrade || (profitPips <= -market().getInitialStopLoss() * ONEPIP);
 
 			if (closeTrade)
 			{
 				std::ostringstream os; os << "@" << trade->currencyPair << " Closing Trade! PIPS: " << int(profitPips / ONEPIP);
 				say(os.str());
-				market.closeTrade(trade);
+				market().closeTrade(trade);
 			}
 		}
 
@@ -129,7 +130,7 @@ namespace MM
 		std::vector<Trade*> toClose;
 		int sameTypeCount = 0;
 
-		for (Trade *&trade : market.getOpenTrades())
+		for (Trade *&trade : market().getOpenTrades())
 		{
 			if (newTrade->currencyPair != trade->currencyPair) continue;
 			if (newTrade->type == trade->type)
@@ -139,8 +140,8 @@ namespace MM
 			}
 
 			// Close iff making profit atm.
-			Stock *stock = market.getStock(trade->currencyPair);
-			TimePeriod period = stock->getTimePeriod(market.getLastTickTime());
+			Stock *stock = market().getStock(trade->currencyPair);
+			TimePeriod period = stock->getTimePeriod(market().getLastTickTime());
 			const Tick *lastTick = period.getLastTick();
 			assert(lastTick != nullptr);
 
@@ -156,7 +157,7 @@ namespace MM
 
 		for (Trade *&trade : toClose)
 		{
-			market.closeTrade(trade);
+			market().closeTrade(trade);
 		}
 
 		if (!toClose.empty())
@@ -172,4 +173,16 @@ namespace MM
 		return true;
 	}
 
+	void ExpertAdvisorLimitAdjuster::serialize(io::SnapshotWriter &writer) const
+	{
+		ExpertAdvisor::serialize(writer);
+		writer.write(hourOfDay);
+	}
+
+	void ExpertAdvisorLimitAdjuster::deserialize(io::SnapshotReader &reader)
+	{
+		ExpertAdvisor::deserialize(reader);
+		reader.read(hourOfDay);
+	}
+
 }; // namespace MM
\ No newline at end of file
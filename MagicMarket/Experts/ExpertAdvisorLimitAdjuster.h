@@ -18,6 +18,9 @@ namespace MM
 		virtual void declareExports() const override;
 		virtual bool acceptNewTrade(Trade *trade);
 
+		virtual void serialize(io::SnapshotWriter &writer) const override;
+		virtual void deserialize(io::SnapshotReader &reader) override;
+
 	private:
 		// provides information about hour of day
 		int hourOfDay;
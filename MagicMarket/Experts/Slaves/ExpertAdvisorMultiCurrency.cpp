@@ -27,17 +27,17 @@ namespace MM
 		int signSum = 0;
 		double actualAverage = 0.0;
 
-		for (const Variable & var : variables)
+		for (const VariableID id : variableIDs)
 		{
-			const double val = var.get();
+			const double val = statistics().getValue(id);
 			actualAverage += val;
 
 			const int sign = Math::signum(val);
 			signSum += sign;
 		}
 
-		actualAverage /= static_cast<double>(variables.size());
-		const int requiredSigns = variables.size();
+		actualAverage /= static_cast<double>(variableIDs.size());
+		const int requiredSigns = variableIDs.size();
 		if (signSum >= requiredSigns)
 		{
 			mood = +1.0;
@@ -54,10 +54,6 @@ namespace MM
 
 	void ExpertAdvisorMultiCurrency::afterExportsDeclared()
 	{
-		for (const Variable & var : statistics.getVariables())
-		{
-			if (var.name.find("MC_tf") != 0) continue;
-			variables.push_back(var);
-		}
+		variableIDs = statistics().findVariablesByPrefix("MC_tf");
 	}
 };
\ No newline at end of file
@@ -1,12 +1,11 @@
 #pragma once
 #include "ExpertAdvisor.h"
+#include "Statistics.h"
 
 #include <vector>
 
 namespace MM
 {
-	struct Variable;
-
 	class ExpertAdvisorMultiCurrency : public ExpertAdvisor
 	{
 	public:
@@ -21,7 +20,8 @@ namespace MM
 
 		virtual std::vector<std::string> getRequiredExperts() const override { return {"MultiCurrencyANN"}; }
 	private:
-		std::vector<Variable> variables;
+		// Positions of the MC_tf* variables in the statistics snapshot.
+		std::vector<VariableID> variableIDs;
 	};
 
 };
\ No newline at end of file
@@ -13,14 +13,20 @@ namespace MM
 {
 	ExpertAdvisorCCI::ExpertAdvisorCCI()
 	{
-		cciShort = Indicators::get<Indicators::CCI>("EURUSD", 28, ONEMINUTE);
-		cciLong  = Indicators::get<Indicators::CCI>("EURUSD", 7, 5 * ONEMINUTE);
+		const int shortPeriods = static_cast<int>(market().getParameter("CCI.ShortPeriods", 28));
+		const int longPeriods = static_cast<int>(market().getParameter("CCI.LongPeriods", 7));
+		const int longTimeframe = static_cast<int>(market().getParameter("CCI.LongTimeframe", 5 * ONEMINUTE));
+		margin = market().getParameter("CCI.Margin", 100.0);
+
+		cciShort = Indicators::get<Indicators::CCI>("EURUSD", shortPeriods, ONEMINUTE);
+		cciLong  = Indicators::get<Indicators::CCI>("EURUSD", longPeriods, longTimeframe);
 
 		cciShortMA = Indicators::get<Indicators::SMA>("", 10, 0, std::bind(&Indicators::CCI::getCCI, cciShort));
 		cciLongMA  = Indicators::get<Indicators::SMA>("", 10, 0, std::bind(&Indicators::CCI::getCCI, cciLong));
 
-		cciShortMA->setCustomDescription("CCI(28, 60) ");
-		cciLongMA-> setCustomDescription("CCI(7, 5 * 60) ");
+		cciShortMA->setCustomDescription("CCI(" + std::to_string(shortPeriods) + ", 60) ");
+		const std::string longTimeframeDescription = (longTimeframe % ONEMINUTE == 0) ? std::to_string(longTimeframe / ONEMINUTE) + " * 60" : std::to_string(longTimeframe);
+		cciLongMA-> setCustomDescription("CCI(" + std::to_string(longPeriods) + ", " + longTimeframeDescription + ") ");
 	}
 
 
@@ -39,8 +45,6 @@ namespace MM
 
 		if (std::isnan(cci1) || std::isnan(cci2)) return;
 
-		const QuantLib::Decimal margin = 100.0;
-
 		double action = 0.0;
 		double confidence = 0.25;
 		double marginDistance = 0.0;
@@ -25,6 +25,8 @@ namespace MM
 
 		Indicators::SMA* cciShortMA;
 		Indicators::SMA* cciLongMA;
+
+		QuantLib::Decimal margin;
 	};
 
 };
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "Market.h"
 #include "Trade.h"
 #include "Stock.h"
+#include "IO/Snapshot.h"
 
 const int PERIOD = 10;
 const int COUNT = 10;
@@ -16,6 +17,7 @@ namespace MM
 
 	ExpertAdvisorMAAnalyser::ExpertAdvisorMAAnalyser()
 	{
+		stock = market().getStock("EURUSD", true);
 	}
 
 	ExpertAdvisorMAAnalyser::~ExpertAdvisorMAAnalyser()
@@ -24,10 +26,9 @@ namespace MM
 
 	void ExpertAdvisorMAAnalyser::execute(const std::time_t &secondsSinceStart, const std::time_t &time)
 	{
-		std::string currencyPair = "EURUSD";
+		const std::string &currencyPair = stock->getCurrencyPair();
 		std::tm *tm = std::gmtime(&time);
 
-		Stock *stock = market.getStock(currencyPair);
 		TimePeriod pips = stock->getTimePeriod(time - 30, time);
 
 		//Calc and store moving average
@@ -62,7 +63,7 @@ namespace MM
 		//check for other trades
 		int buyCount = 0;
 		int sellCount = 0;
-		std::vector<Trade*> &currentTrades = market.getOpenTrades();
+		std::vector<Trade*> &currentTrades = market().getOpenTrades();
 
 		for (Trade *& trade : currentTrades)
 		{
@@ -82,7 +83,7 @@ namespace MM
 			setMood(1.0, 0.95);
 			if (buyCount == 0)
 			{
-				//Trade *trade = market.newTrade(Trade::Buy(currencyPair, 0.01));
+				//Trade *trade = market().newTrade(Trade::Buy(currencyPair, 0.01));
 				say("I just bought " + currencyPair);
 			}
 		}
@@ -91,7 +92,7 @@ namespace MM
 			setMood(-1.0, 0.95);
 			if (sellCount == 0)
 			{
-				//Trade *trade = market.newTrade(Trade::Sell(currencyPair, 0.01));
+				//Trade *trade = market().newTrade(Trade::Sell(currencyPair, 0.01));
 				say("I just sold " + currencyPair);
 			}
 
@@ -107,4 +108,16 @@ namespace MM
 
 	}
 
+	void ExpertAdvisorMAAnalyser::serialize(io::SnapshotWriter &writer) const
+	{
+		ExpertAdvisorTechnical::serialize(writer);
+		writer.write(lastMASave);
+	}
+
+	void ExpertAdvisorMAAnalyser::deserialize(io::SnapshotReader &reader)
+	{
+		ExpertAdvisorTechnical::deserialize(reader);
+		reader.read(lastMASave);
+	}
+
 }; // namespace MM
\ No newline at end of file
@@ -3,6 +3,8 @@
 
 namespace MM
 {
+	class Stock;
+
 	namespace Indicators
 	{
 		class SMA;
@@ -20,8 +22,12 @@ namespace MM
 		virtual void execute(const std::time_t &secondsSinceStart, const std::time_t &time);
 		virtual void onNewTick(const std::string &currencyPair, const QuantLib::Date &date, const std::time_t &time);
 
+		virtual void serialize(io::SnapshotWriter &writer) const override;
+		virtual void deserialize(io::SnapshotReader &reader) override;
+
 	private:
 		std::time_t lastMASave;
+		Stock *stock;
 	};
 
 }
\ No newline at end of file
@@ -7,6 +7,7 @@
 #include "Stock.h"
 #include "Tick.h"
 #include "Helpers.h"
+#include "IO/Snapshot.h"
 
 namespace MM
 {
@@ -51,4 +52,18 @@ namespace MM
 		lastPercentK = percentK;
 	}
 
+	void ExpertAdvisorStochasticOscillator::serialize(io::SnapshotWriter &writer) const
+	{
+		ExpertAdvisorTechnical::serialize(writer);
+		writer.write(lastPercentK);
+		writer.write(lastPercentD);
+	}
+
+	void ExpertAdvisorStochasticOscillator::deserialize(io::SnapshotReader &reader)
+	{
+		ExpertAdvisorTechnical::deserialize(reader);
+		reader.read(lastPercentK);
+		reader.read(lastPercentD);
+	}
+
 };
\ No newline at end of file
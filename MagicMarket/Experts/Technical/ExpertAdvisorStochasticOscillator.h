@@ -18,6 +18,9 @@ namespace MM
 		virtual std::string getName() const override { return "TA_StochOsc"; };
 		virtual void execute(const std::time_t &secondsSinceStart, const std::time_t &time) override;
 
+		virtual void serialize(io::SnapshotWriter &writer) const override;
+		virtual void deserialize(io::SnapshotReader &reader) override;
+
 	private:
 		Indicators::StochasticOscillator *oscillator;
 		double lastPercentK, lastPercentD;
@@ -32,6 +32,12 @@ namespace MM
 		return std::mktime(&timeinfo);
 	}
 	
+	QuantLib::Decimal pipSize(const std::string &currencyPair)
+	{
+		if (currencyPair.find("JPY") != std::string::npos) return 0.01;
+		return ONEPIP;
+	}
+
 	std::string timeToString(std::time_t time)
 	{
 		char BUF[64];
@@ -17,6 +17,8 @@ namespace MM
 
 	// constants
 	const QuantLib::Decimal ONEPIP = 0.0001;
+	// Pairs quoted in yen have two decimal places less.
+	QuantLib::Decimal pipSize(const std::string &currencyPair);
 	const int ONESECOND = 1;
 	const int ONEMINUTE = ONESECOND * 60;
 	const int ONEHOUR = ONEMINUTE * 60;
@@ -0,0 +1,226 @@
+#include "ColumnarWriter.h"
+#include "Snapshot.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <filesystem>
+namespace filesystem = std::tr2::sys;
+
+namespace MM
+{
+	namespace io
+	{
+		namespace
+		{
+			template<typename T> void writeRaw(std::ofstream &output, const T &value)
+			{
+				output.write(reinterpret_cast<const char*>(&value), sizeof(T));
+			}
+
+			int64_t dayOf(int64_t time)
+			{
+				return (time >= 0) ? (time / (24 * 60 * 60)) : ((time + 1) / (24 * 60 * 60) - 1);
+			}
+		};
+
+		ColumnarWriter::ColumnarWriter() : opened(false), columnCount(0), maxRowsPerChunk(0), currentDay(0), stopping(false), writing(false)
+		{
+		}
+
+		ColumnarWriter::~ColumnarWriter()
+		{
+			close();
+		}
+
+		bool ColumnarWriter::open(const std::string &filename, const std::string &schema, size_t columnCount, size_t maxRowsPerChunk)
+		{
+			assert(!opened);
+			this->maxRowsPerChunk = std::max(size_t(1), maxRowsPerChunk);
+			output.open(filename, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+			if (!output.good()) return false;
+
+			this->columnCount = columnCount;
+			output.write("MMSTAT01", 8);
+			writeRaw(output, static_cast<uint32_t>(columnCount));
+			writeRaw(output, static_cast<uint32_t>(schema.size()));
+			output.write(schema.data(), schema.size());
+
+			stopping = false;
+			writer = std::thread(&ColumnarWriter::runWriter, this);
+			opened = true;
+			return true;
+		}
+
+		std::unique_ptr<ColumnarWriter::Chunk> ColumnarWriter::acquireChunk()
+		{
+			{ // scope
+				std::lock_guard<std::mutex> lock(queueMutex);
+				if (!freeChunks.empty())
+				{
+					std::unique_ptr<Chunk> chunk = std::move(freeChunks.back());
+					freeChunks.pop_back();
+					chunk->times.clear();
+					for (std::vector<double> &column : chunk->columns)
+						column.clear();
+					return chunk;
+				}
+			}
+			std::unique_ptr<Chunk> chunk = std::make_unique<Chunk>();
+			chunk->columns.resize(columnCount);
+			return chunk;
+		}
+
+		void ColumnarWriter::appendRow(int64_t time, const double *values)
+		{
+			if (!opened) return;
+
+			const int64_t day = dayOf(time);
+			if (currentChunk && (currentChunk->times.size() >= maxRowsPerChunk || day != currentDay))
+				submitCurrentChunk();
+			if (!currentChunk)
+			{
+				currentChunk = acquireChunk();
+				currentDay = day;
+			}
+
+			Chunk &chunk = *currentChunk;
+			chunk.times.push_back(time);
+			for (size_t column = 0; column < columnCount; ++column)
+				chunk.columns[column].push_back(values[column]);
+		}
+
+		void ColumnarWriter::submitCurrentChunk()
+		{
+			if (!currentChunk) return;
+			if (!currentChunk->times.empty())
+			{
+				std::lock_guard<std::mutex> lock(queueMutex);
+				pendingChunks.push_back(std::move(currentChunk));
+			}
+			currentChunk.reset();
+			queueChanged.notify_all();
+		}
+
+		void ColumnarWriter::runWriter()
+		{
+			while (true)
+			{
+				std::unique_ptr<Chunk> chunk;
+				{ // scope
+					std::unique_lock<std::mutex> lock(queueMutex);
+					queueChanged.wait(lock, [this] { return stopping || !pendingChunks.empty(); });
+					if (pendingChunks.empty()) break;
+					chunk = std::move(pendingChunks.front());
+					pendingChunks.pop_front();
+					writing = true;
+				}
+
+				writeChunk(*chunk);
+
+				{ // scope
+					std::lock_guard<std::mutex> lock(queueMutex);
+					freeChunks.push_back(std::move(chunk));
+					writing = false;
+				}
+				queueChanged.notify_all();
+			}
+		}
+
+		void ColumnarWriter::waitForPendingChunks()
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			queueChanged.wait(lock, [this] { return pendingChunks.empty() && !writing; });
+		}
+
+		void ColumnarWriter::writeChunk(const Chunk &chunk)
+		{
+			IndexEntry entry;
+			entry.offset = static_cast<uint64_t>(output.tellp());
+			entry.firstTime = chunk.times.front();
+			entry.lastTime = chunk.times.back();
+			entry.rowCount = static_cast<uint32_t>(chunk.times.size());
+			index.push_back(entry);
+
+			output.write("CHNK", 4);
+			writeRaw(output, entry.rowCount);
+			writeRaw(output, entry.firstTime);
+			writeRaw(output, entry.lastTime);
+			output.write(reinterpret_cast<const char*>(chunk.times.data()), chunk.times.size() * sizeof(int64_t));
+			for (const std::vector<double> &column : chunk.columns)
+				output.write(reinterpret_cast<const char*>(column.data()), column.size() * sizeof(double));
+			// Whole chunks only, so that a reader never sees a partial one.
+			output.flush();
+		}
+
+		void ColumnarWriter::writeIndex()
+		{
+			const uint64_t indexOffset = static_cast<uint64_t>(output.tellp());
+			output.write("INDX", 4);
+			writeRaw(output, static_cast<uint32_t>(index.size()));
+			for (const IndexEntry &entry : index)
+			{
+				writeRaw(output, entry.offset);
+				writeRaw(output, entry.firstTime);
+				writeRaw(output, entry.lastTime);
+				writeRaw(output, entry.rowCount);
+				writeRaw(output, static_cast<uint32_t>(0));
+			}
+			writeRaw(output, indexOffset);
+			output.write("MMSTIDX1", 8);
+		}
+
+		void ColumnarWriter::close()
+		{
+			if (!opened) return;
+			submitCurrentChunk();
+			{ // scope
+				std::lock_guard<std::mutex> lock(queueMutex);
+				stopping = true;
+			}
+			queueChanged.notify_all();
+			writer.join();
+
+			writeIndex();
+			output.close();
+			opened = false;
+		}
+
+		void ColumnarWriter::serialize(SnapshotWriter &writer)
+		{
+			// The open chunk is closed early; readers do not depend on the chunk boundaries.
+			submitCurrentChunk();
+			waitForPendingChunks();
+
+			writer.write(static_cast<uint64_t>(columnCount));
+			writer.write(static_cast<uint64_t>(output.tellp()));
+			writer.write(index);
+		}
+
+		bool ColumnarWriter::resume(const std::string &filename, size_t columnCount, size_t maxRowsPerChunk, SnapshotReader &reader)
+		{
+			assert(!opened);
+			const uint64_t writtenColumnCount = reader.read<uint64_t>();
+			const uint64_t size = reader.read<uint64_t>();
+			std::vector<IndexEntry> writtenIndex;
+			reader.read(writtenIndex);
+			if (!reader.good() || writtenColumnCount != columnCount) return false;
+			if (!filesystem::exists(filesystem::path(filename)) || filesystem::file_size(filesystem::path(filename)) < size) return false;
+
+			// Drops rows (and the index) that were written after the checkpoint.
+			filesystem::resize_file(filesystem::path(filename), size);
+			output.open(filename, std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+			if (!output.good()) return false;
+			output.seekp(0, std::ios_base::end);
+
+			this->maxRowsPerChunk = std::max(size_t(1), maxRowsPerChunk);
+			this->columnCount = columnCount;
+			index = std::move(writtenIndex);
+
+			stopping = false;
+			writer = std::thread(&ColumnarWriter::runWriter, this);
+			opened = true;
+			return true;
+		}
+	};
+};
\ No newline at end of file
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+namespace MM {
+
+	namespace io
+	{
+		class SnapshotWriter;
+		class SnapshotReader;
+
+		/*
+			Writes rows of doubles into a column-chunked binary file.
+			Rows are buffered per column; a chunk is closed at every day boundary (or when it reaches maxRowsPerChunk)
+			and written by a background thread. On close() an index of all chunks is appended.
+
+			Layout (little endian):
+				header:  "MMSTAT01" | uint32 columnCount | uint32 schemaLength | schema (contents of the .info file)
+				chunk:   "CHNK" | uint32 rowCount | int64 firstTime | int64 lastTime | int64 time[rowCount] | double column[columnCount][rowCount]
+				index:   "INDX" | uint32 chunkCount | { uint64 offset | int64 firstTime | int64 lastTime | uint32 rowCount | uint32 reserved }[chunkCount]
+				trailer: uint64 indexOffset | "MMSTIDX1"
+			A file without trailer (e.g. after a crash) can still be read chunk by chunk.
+		*/
+		class ColumnarWriter
+		{
+		public:
+			ColumnarWriter();
+			~ColumnarWriter();
+
+			bool open(const std::string &filename, const std::string &schema, size_t columnCount, size_t maxRowsPerChunk = 24 * 60 * 60);
+			void appendRow(int64_t time, const double *values);
+			// Writes all pending chunks and the index. Blocks until the writer thread has finished.
+			void close();
+			bool isOpen() const { return opened; }
+
+			// Waits until all rows so far are written and stores the position in the file (see VirtualMarket).
+			void serialize(SnapshotWriter &writer);
+			// Continues a file after the stored position. Everything written after the checkpoint is discarded.
+			bool resume(const std::string &filename, size_t columnCount, size_t maxRowsPerChunk, SnapshotReader &reader);
+
+		private:
+			struct Chunk
+			{
+				std::vector<int64_t> times;
+				// One buffer per column. They keep their capacity when the chunk is reused.
+				std::vector<std::vector<double>> columns;
+			};
+
+			struct IndexEntry
+			{
+				uint64_t offset;
+				int64_t firstTime;
+				int64_t lastTime;
+				uint32_t rowCount;
+			};
+
+			std::unique_ptr<Chunk> acquireChunk();
+			void submitCurrentChunk();
+			// Blocks until the writer thread has written all submitted chunks.
+			void waitForPendingChunks();
+			void runWriter();
+			void writeChunk(const Chunk &chunk);
+			void writeIndex();
+
+			bool opened;
+			size_t columnCount;
+			size_t maxRowsPerChunk;
+			std::ofstream output;
+
+			std::unique_ptr<Chunk> currentChunk;
+			int64_t currentDay;
+
+			std::thread writer;
+			std::mutex queueMutex;
+			std::condition_variable queueChanged;
+			std::deque<std::unique_ptr<Chunk>> pendingChunks;
+			// Written chunks are handed back so that the buffers are reused.
+			std::vector<std::unique_ptr<Chunk>> freeChunks;
+			bool stopping;
+			// Whether the writer thread currently writes a chunk it already took from the queue.
+			bool writing;
+
+			// Only touched by the writer thread.
+			std::vector<IndexEntry> index;
+		};
+	};
+};
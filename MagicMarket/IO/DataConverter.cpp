@@ -33,7 +33,7 @@ namespace MM
 			tick.ask = static_cast<QuantLib::Decimal> (ask);
 
 			TradingDay *day = getTradingDay(stock, tick.getDate());
-			day->ticks.push_back(tick);
+			day->getMutableTicks().push_back(tick);
 		}
 
 
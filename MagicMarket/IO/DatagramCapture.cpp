@@ -0,0 +1,93 @@
+#include "DatagramCapture.h"
+
+#include <iostream>
+
+#include <filesystem>
+namespace filesystem = std::tr2::sys;
+
+namespace MM
+{
+	namespace io
+	{
+		namespace
+		{
+			const char MAGIC[8] = { 'M', 'M', 'C', 'A', 'P', '0', '0', '1' };
+
+			template<typename T> void append(std::string &buffer, const T &value)
+			{
+				buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+			}
+		};
+
+		DatagramCapture::DatagramCapture()
+		{
+		}
+
+		DatagramCapture::~DatagramCapture()
+		{
+			close();
+		}
+
+		bool DatagramCapture::open(const std::string &filename)
+		{
+			close();
+
+			const filesystem::path path = filesystem::path(filename).parent_path();
+			if (!path.empty())
+				filesystem::create_directories(path);
+
+			output.open(filename, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+			if (!output.good())
+			{
+				std::cout << "WARNING: Could not open capture file '" << filename << "'." << std::endl;
+				return false;
+			}
+
+			startTime = lastFlushTime = Clock::now();
+			const int64_t wallClock = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+			buffer.reserve(2 * BLOCK_SIZE);
+			buffer.append(MAGIC, sizeof(MAGIC));
+			append(buffer, wallClock);
+			flush();
+			return true;
+		}
+
+		void DatagramCapture::close()
+		{
+			if (!output.is_open()) return;
+			flush();
+			output.close();
+		}
+
+		void DatagramCapture::record(Clock::time_point receivedAt, const char *data, uint32_t length)
+		{
+			if (!output.is_open()) return;
+
+			const int64_t offset = std::chrono::duration_cast<std::chrono::nanoseconds>(receivedAt - startTime).count();
+			append(buffer, offset);
+			append(buffer, length);
+			buffer.append(data, length);
+
+			if (buffer.size() >= BLOCK_SIZE)
+				flush();
+			else
+				flushIfDue(receivedAt);
+		}
+
+		void DatagramCapture::flushIfDue(Clock::time_point now)
+		{
+			if (now - lastFlushTime >= std::chrono::milliseconds(FLUSH_INTERVAL_MS))
+				flush();
+		}
+
+		void DatagramCapture::flush()
+		{
+			if (!output.is_open()) return;
+			lastFlushTime = Clock::now();
+			if (buffer.empty()) return;
+			output.write(buffer.data(), buffer.size());
+			output.flush();
+			buffer.clear();
+		}
+	};
+};
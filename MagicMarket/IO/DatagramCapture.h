@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <fstream>
+#include <chrono>
+#include <stdint.h>
+
+namespace MM {
+
+	namespace io
+	{
+		/*
+			Records raw datagrams with their receive time, e.g. the MetaTrader bridge traffic, so that a session can be replayed later
+			(see tools/mt_capture_replay.py).
+			Records are collected in memory and written in blocks. Writers call flushIfDue while idle as well, so that at most
+			FLUSH_INTERVAL of traffic is lost if the process is killed.
+
+			Layout (little endian):
+				header: "MMCAP001" | int64 wall clock time of the start (ns since the epoch)
+				record: int64 receive time (ns since the start, monotonic) | uint32 length | data
+		*/
+		class DatagramCapture
+		{
+		public:
+			typedef std::chrono::steady_clock Clock;
+
+			DatagramCapture();
+			~DatagramCapture();
+
+			// Starts a new file; an existing one is replaced.
+			bool open(const std::string &filename);
+			void close();
+			bool isOpen() const { return output.is_open(); }
+
+			void record(Clock::time_point receivedAt, const char *data, uint32_t length);
+			void flush();
+			// Flushes if the last flush is older than FLUSH_INTERVAL.
+			void flushIfDue(Clock::time_point now);
+
+		private:
+			static const size_t BLOCK_SIZE = 1 << 16;
+			static const int FLUSH_INTERVAL_MS = 1000;
+
+			std::ofstream output;
+			std::string buffer;
+			Clock::time_point startTime;
+			Clock::time_point lastFlushTime;
+		};
+	};
+};
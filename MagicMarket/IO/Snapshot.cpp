@@ -0,0 +1,111 @@
+#include "Snapshot.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace MM {
+
+	namespace io
+	{
+		namespace
+		{
+			const char MAGIC[8] = { 'M', 'M', 'S', 'N', 'A', 'P', '0', '1' };
+		};
+
+		void SnapshotWriter::write(const std::string &value)
+		{
+			write(static_cast<uint32_t>(value.size()));
+			data.append(value);
+		}
+
+		void SnapshotWriter::beginSection(const std::string &name)
+		{
+			write(name);
+			openSections.push_back(data.size());
+			write(static_cast<uint64_t>(0));
+		}
+
+		void SnapshotWriter::endSection()
+		{
+			const size_t lengthPosition = openSections.back();
+			openSections.pop_back();
+			const uint64_t length = data.size() - lengthPosition - sizeof(uint64_t);
+			std::memcpy(&data[lengthPosition], &length, sizeof(length));
+		}
+
+		bool SnapshotWriter::save(const std::string &filename) const
+		{
+			const std::string temporaryFilename = filename + ".tmp";
+			{ // scope
+				std::ofstream output(temporaryFilename, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+				if (!output.good()) return false;
+				output.write(MAGIC, sizeof(MAGIC));
+				const uint32_t version = VERSION;
+				output.write(reinterpret_cast<const char*>(&version), sizeof(version));
+				output.write(data.data(), data.size());
+				if (!output.good()) return false;
+			}
+			std::remove(filename.c_str());
+			return std::rename(temporaryFilename.c_str(), filename.c_str()) == 0;
+		}
+
+		SnapshotReader::SnapshotReader() : position(0), version(0), failed(false)
+		{
+		}
+
+		bool SnapshotReader::load(const std::string &filename)
+		{
+			std::ifstream input(filename, std::ios_base::in | std::ios_base::binary);
+			if (!input.good()) return false;
+			data.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+			position = 0;
+			failed = false;
+
+			if (!available(sizeof(MAGIC)) || std::memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0)
+			{
+				failed = true;
+				return false;
+			}
+			position += sizeof(MAGIC);
+			read(version);
+			return good() && version <= SnapshotWriter::VERSION;
+		}
+
+		void SnapshotReader::read(std::string &value)
+		{
+			uint32_t size = 0;
+			read(size);
+			if (!available(size)) return;
+			value.assign(data.data() + position, size);
+			position += size;
+		}
+
+		bool SnapshotReader::nextSection(std::string &name, SnapshotReader &contents)
+		{
+			if (failed || position >= data.size()) return false;
+			read(name);
+			uint64_t length = 0;
+			read(length);
+			if (!available(static_cast<size_t>(length))) return false;
+
+			contents.data.assign(data.data() + position, static_cast<size_t>(length));
+			contents.position = 0;
+			contents.version = version;
+			contents.failed = false;
+			position += static_cast<size_t>(length);
+			return true;
+		}
+
+		bool SnapshotReader::available(size_t size)
+		{
+			if (failed || position + size > data.size())
+			{
+				failed = true;
+				return false;
+			}
+			return true;
+		}
+	};
+};
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <type_traits>
+#include <stdint.h>
+
+namespace MM {
+
+	namespace io
+	{
+		/*
+			Binary checkpoint of the simulation state.
+			Plain values are stored raw (little endian), strings and vectors with a uint32 length prefix.
+			State of single components is grouped into named sections; readers skip sections they do not know,
+			so that checkpoints survive added or removed experts.
+
+			Layout:
+				header:  "MMSNAP01" | uint32 version
+				section: uint32 nameLength | name | uint64 length | contents
+		*/
+		class SnapshotWriter
+		{
+		public:
+			static const uint32_t VERSION = 2;
+
+			template<typename T> void write(const T &value)
+			{
+				static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be written directly.");
+				data.append(reinterpret_cast<const char*>(&value), sizeof(T));
+			}
+			void write(const std::string &value);
+			template<typename T> void write(const std::vector<T> &values)
+			{
+				write(static_cast<uint32_t>(values.size()));
+				for (const T &value : values)
+					write(value);
+			}
+
+			void beginSection(const std::string &name);
+			void endSection();
+
+			// Writes to a temporary file first, so that an interruption never leaves a broken checkpoint behind.
+			bool save(const std::string &filename) const;
+
+		private:
+			std::string data;
+			// Positions of the length fields of the open sections.
+			std::vector<size_t> openSections;
+		};
+
+		class SnapshotReader
+		{
+		public:
+			SnapshotReader();
+
+			bool load(const std::string &filename);
+			// False after reading past the end of the data or the current section.
+			bool good() const { return !failed; }
+			uint32_t getVersion() const { return version; }
+
+			template<typename T> void read(T &value)
+			{
+				static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be read directly.");
+				if (!available(sizeof(T))) return;
+				std::memcpy(&value, data.data() + position, sizeof(T));
+				position += sizeof(T);
+			}
+			void read(std::string &value);
+			template<typename T> void read(std::vector<T> &values)
+			{
+				uint32_t size = 0;
+				read(size);
+				values.clear();
+				for (uint32_t i = 0; i < size && good(); ++i)
+				{
+					T value;
+					read(value);
+					values.push_back(value);
+				}
+			}
+			template<typename T> T read()
+			{
+				T value = T();
+				read(value);
+				return value;
+			}
+
+			// Reads the next section into a separate reader. Returns false at the end of the data.
+			bool nextSection(std::string &name, SnapshotReader &contents);
+
+		private:
+			bool available(size_t size);
+
+			std::string data;
+			size_t position;
+			uint32_t version;
+			bool failed;
+		};
+	};
+};
@@ -0,0 +1,316 @@
+#include "TradeJournal.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+#include <filesystem>
+namespace filesystem = std::tr2::sys;
+
+#include <Windows.h>
+
+namespace MM
+{
+	namespace io
+	{
+		namespace
+		{
+			const char MAGIC[8] = { 'M', 'M', 'T', 'J', 'R', 'N', '0', '1' };
+
+			// FNV-1a.
+			uint32_t checksum(const char *data, size_t length)
+			{
+				uint32_t hash = 2166136261u;
+				for (size_t i = 0; i < length; ++i)
+				{
+					hash ^= static_cast<uint8_t>(data[i]);
+					hash *= 16777619u;
+				}
+				return hash;
+			}
+
+			template<typename T> char *put(char *buffer, const T &value)
+			{
+				std::memcpy(buffer, &value, sizeof(T));
+				return buffer + sizeof(T);
+			}
+
+			template<typename T> const char *get(const char *buffer, T &value)
+			{
+				std::memcpy(&value, buffer, sizeof(T));
+				return buffer + sizeof(T);
+			}
+
+			bool hasValidHeader(const std::string &filename)
+			{
+				char header[sizeof(MAGIC)];
+				std::ifstream input(filename, std::ios_base::in | std::ios_base::binary);
+				if (!input.read(header, sizeof(header))) return false;
+				return std::memcmp(header, MAGIC, sizeof(MAGIC)) == 0;
+			}
+
+			// Atomic on the same volume; the target is either the old or the new file, even after a crash.
+			bool replaceFile(const std::string &source, const std::string &target)
+			{
+				return MoveFileExA(source.c_str(), target.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+			}
+		};
+
+		TradeJournal::TradeJournal() : compactionThreshold(0), recordCount(0)
+		{
+		}
+
+		TradeJournal::~TradeJournal()
+		{
+			close();
+		}
+
+		bool TradeJournal::open(const std::string &filename, size_t compactionThreshold)
+		{
+			close();
+			this->filename = filename;
+			this->compactionThreshold = compactionThreshold;
+			openTrades.clear();
+			recordCount = 0;
+
+			const uint64_t validSize = recover();
+			if (validSize == 0)
+			{
+				output.open(filename, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+				if (!output.good()) return false;
+				output.write(MAGIC, sizeof(MAGIC));
+				output.flush();
+			}
+			else
+			{
+				output.open(filename, std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+				if (!output.good()) return false;
+				output.seekp(0, std::ios_base::end);
+			}
+
+			if (needsCompaction())
+				compact();
+			return output.good();
+		}
+
+		void TradeJournal::close()
+		{
+			if (output.is_open())
+				output.close();
+		}
+
+		uint64_t TradeJournal::recover()
+		{
+			// A compaction that was interrupted before the replacement left the journal intact, so its temporary file is stale.
+			const std::string temporaryFilename = filename + ".tmp";
+			if (filesystem::exists(filesystem::path(temporaryFilename)))
+			{
+				if (hasValidHeader(filename) || !hasValidHeader(temporaryFilename))
+					std::remove(temporaryFilename.c_str());
+				else
+				{
+					std::cout << "WARNING: Trade journal '" << filename << "' is missing or damaged; using the compacted journal '" << temporaryFilename << "'." << std::endl;
+					if (filesystem::exists(filesystem::path(filename)))
+					{
+						const std::string damagedFilename = filename + ".damaged";
+						std::remove(damagedFilename.c_str());
+						std::rename(filename.c_str(), damagedFilename.c_str());
+					}
+					if (!replaceFile(temporaryFilename, filename))
+						std::cout << "WARNING: Could not restore trade journal '" << filename << "'." << std::endl;
+				}
+			}
+
+			const filesystem::path path(filename);
+			if (!filesystem::exists(path)) return 0;
+
+			std::string data;
+			{ // scope
+				std::ifstream input(filename, std::ios_base::in | std::ios_base::binary);
+				data.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+			}
+
+			if (data.size() < sizeof(MAGIC) || std::memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0)
+			{
+				if (!data.empty())
+				{
+					std::cout << "WARNING: Trade journal '" << filename << "' is damaged and was moved aside." << std::endl;
+					const std::string damagedFilename = filename + ".damaged";
+					std::remove(damagedFilename.c_str());
+					std::rename(filename.c_str(), damagedFilename.c_str());
+				}
+				return 0;
+			}
+
+			size_t position = sizeof(MAGIC);
+			for (; position + RECORD_SIZE <= data.size(); position += RECORD_SIZE)
+			{
+				const char *record = data.data() + position;
+				uint32_t storedChecksum;
+				get(record + RECORD_SIZE - sizeof(uint32_t), storedChecksum);
+				if (storedChecksum != checksum(record, RECORD_SIZE - sizeof(uint32_t))) break;
+
+				uint8_t type;
+				int32_t ticketID;
+				int64_t time;
+				double stopLossPrice, takeProfitPrice;
+				record = get(record, type);
+				record = get(record, ticketID);
+				record = get(record, time);
+				record = get(record, stopLossPrice);
+				record = get(record, takeProfitPrice);
+				apply(static_cast<RecordType>(type), ticketID, static_cast<std::time_t>(time), stopLossPrice, takeProfitPrice);
+				recordCount += 1;
+			}
+
+			if (position != data.size())
+			{
+				std::cout << "WARNING: Trade journal '" << filename << "' ends with an incomplete record; " << (data.size() - position) << " bytes dropped." << std::endl;
+				filesystem::resize_file(path, position);
+			}
+			return position;
+		}
+
+		void TradeJournal::apply(RecordType type, int32_t ticketID, std::time_t time, double stopLossPrice, double takeProfitPrice)
+		{
+			switch (type)
+			{
+			case R_OPEN:
+			case R_LIMITS:
+				{
+					auto inserted = openTrades.emplace(ticketID, Entry());
+					Entry &entry = inserted.first->second;
+					if (inserted.second || type == R_OPEN)
+						entry.openingTime = time;
+					entry.lastUpdateTime = time;
+					entry.stopLossPrice = stopLossPrice;
+					entry.takeProfitPrice = takeProfitPrice;
+				}
+				break;
+			case R_CLOSE:
+				openTrades.erase(ticketID);
+				break;
+			}
+		}
+
+		void TradeJournal::append(RecordType type, int32_t ticketID, std::time_t time, double stopLossPrice, double takeProfitPrice)
+		{
+			apply(type, ticketID, time, stopLossPrice, takeProfitPrice);
+			if (!output.is_open()) return;
+
+			write(output, type, ticketID, time, stopLossPrice, takeProfitPrice);
+			// Every record has to survive a crash.
+			output.flush();
+			recordCount += 1;
+
+			if (needsCompaction())
+				compact();
+		}
+
+		void TradeJournal::write(std::ostream &stream, RecordType type, int32_t ticketID, std::time_t time, double stopLossPrice, double takeProfitPrice)
+		{
+			char record[RECORD_SIZE];
+			char *position = record;
+			position = put(position, static_cast<uint8_t>(type));
+			position = put(position, ticketID);
+			position = put(position, static_cast<int64_t>(time));
+			position = put(position, stopLossPrice);
+			position = put(position, takeProfitPrice);
+			put(position, checksum(record, RECORD_SIZE - sizeof(uint32_t)));
+			stream.write(record, RECORD_SIZE);
+		}
+
+		bool TradeJournal::needsCompaction() const
+		{
+			// A compacted journal holds up to two records per open trade; with more open trades than the threshold, compacting would not shrink it.
+			return compactionThreshold > 0 && recordCount > compactionThreshold && recordCount > 2 * openTrades.size();
+		}
+
+		void TradeJournal::recordOpen(int32_t ticketID, std::time_t time, double stopLossPrice, double takeProfitPrice)
+		{
+			if (openTrades.count(ticketID)) return;
+			append(R_OPEN, ticketID, time, stopLossPrice, takeProfitPrice);
+		}
+
+		void TradeJournal::recordLimits(int32_t ticketID, std::time_t time, double stopLossPrice, double takeProfitPrice)
+		{
+			const Entry *entry = find(ticketID);
+			if (entry != nullptr && entry->stopLossPrice == stopLossPrice && entry->takeProfitPrice == takeProfitPrice) return;
+			append(R_LIMITS, ticketID, time, stopLossPrice, takeProfitPrice);
+		}
+
+		void TradeJournal::recordClose(int32_t ticketID, std::time_t time)
+		{
+			if (!openTrades.count(ticketID)) return;
+			append(R_CLOSE, ticketID, time, 0.0, 0.0);
+		}
+
+		const TradeJournal::Entry *TradeJournal::find(int32_t ticketID) const
+		{
+			auto found = openTrades.find(ticketID);
+			if (found == openTrades.end()) return nullptr;
+			return &found->second;
+		}
+
+		std::vector<int32_t> TradeJournal::getOpenTickets() const
+		{
+			std::vector<int32_t> tickets;
+			tickets.reserve(openTrades.size());
+			for (const auto &openTrade : openTrades)
+				tickets.push_back(openTrade.first);
+			return tickets;
+		}
+
+		void TradeJournal::compact()
+		{
+			if (!output.is_open()) return;
+			output.close();
+
+			// The open trades are condensed into an opening record with the current limits, plus a limits record with the time of the last update.
+			const std::string temporaryFilename = filename + ".tmp";
+			size_t compactedRecords = 0;
+			bool written = false;
+			{ // scope
+				std::ofstream temporary(temporaryFilename, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+				temporary.write(MAGIC, sizeof(MAGIC));
+				for (const auto &trade : openTrades)
+				{
+					const Entry &entry = trade.second;
+					write(temporary, R_OPEN, trade.first, entry.openingTime, entry.stopLossPrice, entry.takeProfitPrice);
+					compactedRecords += 1;
+					if (entry.lastUpdateTime == entry.openingTime) continue;
+					write(temporary, R_LIMITS, trade.first, entry.lastUpdateTime, entry.stopLossPrice, entry.takeProfitPrice);
+					compactedRecords += 1;
+				}
+				temporary.flush();
+				written = temporary.good();
+			}
+
+			if (written)
+			{
+				// Keep the full trail: the records so far go to the history.
+				// Should the process die before the replacement, the next compaction adds them a second time.
+				std::ifstream input(filename, std::ios_base::in | std::ios_base::binary);
+				input.seekg(sizeof(MAGIC), std::ios_base::beg);
+				std::ofstream history(filename + ".history", std::ios_base::out | std::ios_base::binary | std::ios_base::app);
+				if (history.tellp() == std::streampos(0))
+					history.write(MAGIC, sizeof(MAGIC));
+				history << input.rdbuf();
+			}
+
+			if (written && replaceFile(temporaryFilename, filename))
+				recordCount = compactedRecords;
+			else
+			{
+				// Retrying with every record would only grow the history.
+				std::cout << "WARNING: Could not compact trade journal '" << filename << "'; compaction is disabled." << std::endl;
+				std::remove(temporaryFilename.c_str());
+				compactionThreshold = 0;
+			}
+			output.open(filename, std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+			output.seekp(0, std::ios_base::end);
+		}
+	};
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <string>
+#include <fstream>
+#include <unordered_map>
+#include <vector>
+#include <ctime>
+#include <stdint.h>
+
+namespace MM {
+
+	namespace io
+	{
+		/*
+			Append-only log of the live trades: openings, changes of the stop loss and take profit and closings, each with a timestamp.
+			The current state of all open trades is kept in memory, so lookups never touch the file.
+			Records have a fixed size and a checksum; a torn last record (e.g. after a crash) is cut off when the journal is opened.
+			When the journal grows too large, it is compacted to the open trades and the previous contents are moved to "<filename>.history".
+			The compacted journal is written to "<filename>.tmp" first and then replaces the journal in one step; if the journal is missing or
+			damaged on opening, a left over temporary file is used instead.
+
+			Layout (little endian):
+				header: "MMTJRN01"
+				record: uint8 type | int32 ticketID | int64 time | double stopLoss | double takeProfit | uint32 checksum
+		*/
+		class TradeJournal
+		{
+		public:
+			struct Entry
+			{
+				std::time_t openingTime;
+				std::time_t lastUpdateTime;
+				double stopLossPrice;
+				double takeProfitPrice;
+			};
+
+			TradeJournal();
+			~TradeJournal();
+
+			// A threshold of 0 disables the compaction.
+			bool open(const std::string &filename, size_t compactionThreshold);
+			void close();
+			bool isOpen() const { return output.is_open(); }
+
+			// Ignored for known tickets.
+			void recordOpen(int32_t ticketID, std::time_t time, double stopLossPrice, double takeProfitPrice);
+			// Only written if the limits changed.
+			void recordLimits(int32_t ticketID, std::time_t time, double stopLossPrice, double takeProfitPrice);
+			void recordClose(int32_t ticketID, std::time_t time);
+
+			// nullptr for unknown and closed tickets.
+			const Entry *find(int32_t ticketID) const;
+			std::vector<int32_t> getOpenTickets() const;
+
+			void compact();
+
+		private:
+			enum RecordType : uint8_t
+			{
+				R_OPEN = 1,
+				R_LIMITS = 2,
+				R_CLOSE = 3
+			};
+			static const size_t RECORD_SIZE = 1 + 4 + 8 + 8 + 8 + 4;
+
+			std::string filename;
+			std::fstream output;
+			size_t compactionThreshold;
+			// Records in the journal file, including the ones of closed trades.
+			size_t recordCount;
+
+			std::unordered_map<int32_t, Entry> openTrades;
+
+			void append(RecordType type, int32_t ticketID, std::time_t time, double stopLossPrice, double takeProfitPrice);
+			static void write(std::ostream &stream, RecordType type, int32_t ticketID, std::time_t time, double stopLossPrice, double takeProfitPrice);
+			bool needsCompaction() const;
+			// Returns the size of the valid part of the file.
+			uint64_t recover();
+			void apply(RecordType type, int32_t ticketID, std::time_t time, double stopLossPrice, double takeProfitPrice);
+		};
+	};
+};
@@ -7,6 +7,7 @@
 
 #include "Moves.h"
 #include "ATR.h"
+#include "IO/Snapshot.h"
 
 namespace MM
 {
@@ -57,5 +58,27 @@ namespace MM
 
 			adx = 100.0 * std::abs(pDIMA - mDIMA) / (pDI + mDI);
 		}
+
+		void ADX::serialize(io::SnapshotWriter &writer) const
+		{
+			Base::serialize(writer);
+			writer.write(pDIMA);
+			writer.write(mDIMA);
+			writer.write(pDIMA_pushed);
+			writer.write(mDIMA_pushed);
+			writer.write(adx);
+			writer.write(lastPushedMA);
+		}
+
+		void ADX::deserialize(io::SnapshotReader &reader)
+		{
+			Base::deserialize(reader);
+			reader.read(pDIMA);
+			reader.read(mDIMA);
+			reader.read(pDIMA_pushed);
+			reader.read(mDIMA_pushed);
+			reader.read(adx);
+			reader.read(lastPushedMA);
+		}
 	};
 };
\ No newline at end of file
@@ -33,6 +33,9 @@ namespace MM
 			double getmDIMA() const { return mDIMA; }
 			double getADX() const { return adx; }
 
+			virtual void serialize(io::SnapshotWriter &writer) const override;
+			virtual void deserialize(io::SnapshotReader &reader) override;
+
 		private:
 			std::string currencyPair;
 			int history;
@@ -2,6 +2,7 @@
 #include "Market.h"
 #include "Stock.h"
 #include "TimePeriod.h"
+#include "IO/Snapshot.h"
 
 namespace MM
 {
@@ -10,7 +11,8 @@ namespace MM
 
 		void ATR::reset()
 		{
-			value = std::numeric_limits<double>::quiet_NaN();
+			value = valueCompleted = lastClose = std::numeric_limits<double>::quiet_NaN();
+			subscription = BarStream::Subscription();
 		}
 
 		ATR::ATR(std::string currencyPair, int history, int seconds) :
@@ -18,6 +20,8 @@ namespace MM
 			history(history),
 			seconds(seconds)
 		{
+			bars = Indicators::get<BarStream>(currencyPair, seconds);
+			bars->requireHistory(history + 1);
 		}
 
 
@@ -30,39 +34,38 @@ namespace MM
 			exportVariable("ATR", std::bind(&ATR::getATRMA, this), "period " + std::to_string(seconds) + ", memory " + std::to_string(history));
 		}
 
-		double ATR::getTrueRange(MM::Stock *stock, const std::time_t &time, const int &duration)
+		double ATR::getTrueRange(const BarStream::Bar &bar, double previousClose)
 		{
-			MM::TimePeriod period = stock->getTimePeriod(time - duration, time);
-			const MM::PossibleDecimal high = period.getHigh();
-			const MM::PossibleDecimal low  = period.getLow();
-			if (!high.get() || !low.get()) return std::numeric_limits<double>::quiet_NaN();
-
-			// in theory, we need to adjust this by the last period's close;
-			// this should not be necessary, though, because we don't have overnight gaps etc..
-			return *high.get() - *low.get();
+			if (std::isnan(previousClose)) return bar.high - bar.low;
+			return std::max(bar.high, previousClose) - std::min(bar.low, previousClose);
 		}
 
-
 		void ATR::update(const std::time_t &secondsSinceStart, const std::time_t &time)
 		{
-			Stock *stock = market.getStock(currencyPair);
-			if (stock == nullptr) return;
+			if (!bars->advanceTo(time)) return;
+			if (!bars->synchronize(subscription))
+				valueCompleted = lastClose = std::numeric_limits<double>::quiet_NaN();
 
-			// need to initialize the value?
-			if (std::isnan(value))
+			while (const BarStream::Bar *bar = bars->next(subscription))
 			{
-				value = 0.0f;
-				for (int p = 0; p < history; ++p)
-				{
-					value += getTrueRange(stock, time - seconds * p, seconds);
-				}
-				value /= static_cast<float>(history);
-				return;
+				valueCompleted = Math::MA(valueCompleted, getTrueRange(*bar, lastClose), history);
+				lastClose = bar->close;
 			}
+			value = Math::MA(valueCompleted, getTrueRange(bars->getPartialBar(), lastClose), history);
+		}
 
-			const double trueRange = getTrueRange(stock, time, seconds);
-			const double historyDouble = static_cast<double>(history);
-			value = (value * (historyDouble - 1.0) + trueRange) / historyDouble;
+		void ATR::serialize(io::SnapshotWriter &writer) const
+		{
+			Base::serialize(writer);
+			writer.write(value);
+		}
+
+		void ATR::deserialize(io::SnapshotReader &reader)
+		{
+			Base::deserialize(reader);
+			reader.read(value);
+			// Everything else is rebuilt from the bar history on the next update.
+			subscription = BarStream::Subscription();
 		}
 	};
 };
\ No newline at end of file
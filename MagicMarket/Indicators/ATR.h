@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Base.h"
+#include "BarStream.h"
 #include <string>
 
 namespace MM
@@ -26,15 +27,24 @@ namespace MM
 				return (other->history == history) && (other->seconds == seconds) && (other->currencyPair == currencyPair);
 			}
 
-			static double getTrueRange(MM::Stock *stock, const std::time_t &time, const int &duration);
+			// Includes the gap to the previous close, if there is one.
+			static double getTrueRange(const BarStream::Bar &bar, double previousClose);
 
 			double getATRMA() const { return value; }
 
+			virtual void serialize(io::SnapshotWriter &writer) const override;
+			virtual void deserialize(io::SnapshotReader &reader) override;
+
 		private:
 			std::string currencyPair;
 			int history;
 			int seconds;
+			BarStream *bars;
+			BarStream::Subscription subscription;
+			// Average over the completed bars; the published value also contains the bar in progress.
 			double value;
+			double valueCompleted;
+			double lastClose;
 		};
 
 	};
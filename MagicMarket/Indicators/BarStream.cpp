@@ -0,0 +1,140 @@
+#include "BarStream.h"
+#include "Market.h"
+#include "Tick.h"
+#include "IO/Snapshot.h"
+
+#include <algorithm>
+
+namespace MM
+{
+	namespace Indicators
+	{
+		void BarStream::reset()
+		{
+			cursor.reset();
+			lastTime = 0;
+			barCount = 0;
+			hasPartial = false;
+			// The generation is never reset; the next advance starts a new one.
+		}
+
+		BarStream::BarStream(std::string currencyPair, int seconds) :
+			currencyPair(currencyPair),
+			seconds(std::max(seconds, 1)),
+			cursor(market().getStock(currencyPair, true)),
+			bars(1),
+			generation(0)
+		{
+			reset();
+		}
+
+		BarStream::~BarStream()
+		{
+		}
+
+		void BarStream::requireHistory(int count)
+		{
+			if (count <= static_cast<int>(bars.size())) return;
+			bars.resize(count);
+			reset();
+		}
+
+		void BarStream::completeBarsBefore(const std::time_t &time)
+		{
+			size_t emptyBars = 0;
+			while (partial.start + seconds <= time)
+			{
+				bars[barCount % bars.size()] = partial;
+				++barCount;
+
+				const double close = partial.close;
+				partial = { partial.start + seconds, close, close, close, close, 0 };
+
+				// Nobody can see more flat bars than the history holds, so long gaps are skipped.
+				if (++emptyBars > bars.size())
+					partial.start = std::max(partial.start, time - (time % seconds));
+			}
+		}
+
+		void BarStream::addTick(const std::time_t &time, double value)
+		{
+			if (!hasPartial)
+			{
+				partial = { time - (time % seconds), value, value, value, value, 1 };
+				hasPartial = true;
+				return;
+			}
+
+			completeBarsBefore(time);
+			if (partial.ticks == 0)
+			{
+				partial.open = partial.high = partial.low = value;
+			}
+			else
+			{
+				partial.high = std::max(partial.high, value);
+				partial.low = std::min(partial.low, value);
+			}
+			partial.close = value;
+			++partial.ticks;
+		}
+
+		bool BarStream::advanceTo(const std::time_t &time)
+		{
+			if (hasPartial && time == lastTime) return true;
+
+			bool restarted = false;
+			// After a restart, the ticks of the history are replayed.
+			const std::time_t historyStart = time - (time % seconds) - static_cast<std::time_t>(bars.size()) * seconds;
+			if (!cursor.seek(time, historyStart, restarted))
+			{
+				reset();
+				return false;
+			}
+			if (restarted)
+			{
+				barCount = 0;
+				hasPartial = false;
+				++generation;
+			}
+			lastTime = time;
+
+			while (const Tick *tick = cursor.next(time))
+				addTick(tick->getTime(), tick->getMid());
+
+			if (!hasPartial) return false;
+			// All ticks before 'time' are known, so bars that ended by then are complete.
+			completeBarsBefore(time);
+			return true;
+		}
+
+		bool BarStream::synchronize(Subscription &subscription) const
+		{
+			if (subscription.generation == generation) return true;
+			subscription.generation = generation;
+			subscription.nextBar = getFirstAvailableBar();
+			return false;
+		}
+
+		const BarStream::Bar *BarStream::next(Subscription &subscription) const
+		{
+			subscription.nextBar = std::max(subscription.nextBar, getFirstAvailableBar());
+			if (subscription.nextBar >= barCount) return nullptr;
+			const Bar &bar = bars[subscription.nextBar % bars.size()];
+			++subscription.nextBar;
+			return &bar;
+		}
+
+		void BarStream::serialize(io::SnapshotWriter &writer) const
+		{
+			Base::serialize(writer);
+		}
+
+		void BarStream::deserialize(io::SnapshotReader &reader)
+		{
+			Base::deserialize(reader);
+			// The bars are rebuilt from the tick data on the next advance.
+			reset();
+		}
+	};
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "Base.h"
+#include "TickCursor.h"
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace MM
+{
+	class Stock;
+
+	namespace Indicators
+	{
+		/*
+			Aggregates the ticks of one pair into OHLC bars of a fixed length, aligned to multiples of the length.
+			Every tick is visited once; indicators that work on bars share the stream through Indicators::get<BarStream>(pair, seconds)
+			and read the completed bars through a Subscription, plus the bar in progress between the boundaries.
+			Seconds without ticks produce flat bars at the last close.
+
+			The stream covers one trading day. When it (re)starts, e.g. on a new day or after a jump in time, it replays the ticks of
+			the last requireHistory() bars, so that the consumers can warm up right away.
+		*/
+		class BarStream : public Base
+		{
+		public:
+			struct Bar
+			{
+				std::time_t start;
+				double open, high, low, close;
+				int ticks;
+			};
+
+			// Position of one consumer in the stream.
+			struct Subscription
+			{
+				uint64_t generation = 0;
+				uint64_t nextBar = 0;
+			};
+
+			virtual void reset() override;
+			BarStream(std::string currencyPair, int seconds);
+			virtual ~BarStream();
+
+			virtual void declareExports() const override {};
+			virtual void update(const std::time_t &secondsSinceStart, const std::time_t &time) override { advanceTo(time); }
+			virtual bool operator== (const Base &otherBase) const
+			{
+				const BarStream* other = dynamic_cast<const BarStream*>(&otherBase);
+				if (other == nullptr) return false;
+				return (other->seconds == seconds) && (other->currencyPair == currencyPair);
+			}
+
+			// Keeps at least this many completed bars available.
+			void requireHistory(int bars);
+			// Consumes all ticks before 'time'. Cheap when called again for the same time, so every consumer can call it.
+			// Returns false while there is no bar yet.
+			bool advanceTo(const std::time_t &time);
+
+			// Returns false when the stream was rebuilt since the subscription's last call. The subscription then continues at the
+			// oldest bar that is still available and the consumer has to drop everything derived from earlier bars.
+			bool synchronize(Subscription &subscription) const;
+			// The next completed bar of the subscription or nullptr.
+			const Bar *next(Subscription &subscription) const;
+			// The bar in progress, from its start up to the last advance.
+			const Bar &getPartialBar() const { return partial; }
+
+			int getSeconds() const { return seconds; }
+
+			virtual void serialize(io::SnapshotWriter &writer) const override;
+			virtual void deserialize(io::SnapshotReader &reader) override;
+
+		private:
+			std::string currencyPair;
+			int seconds;
+			TickCursor cursor;
+			std::time_t lastTime;
+
+			// Ring buffer of the completed bars, indexed by bar number.
+			std::vector<Bar> bars;
+			uint64_t barCount;
+			uint64_t generation;
+			Bar partial;
+			bool hasPartial;
+
+			uint64_t getFirstAvailableBar() const { return (barCount > bars.size()) ? barCount - bars.size() : 0; }
+			void addTick(const std::time_t &time, double value);
+			void completeBarsBefore(const std::time_t &time);
+		};
+
+	};
+};
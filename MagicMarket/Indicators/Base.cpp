@@ -3,6 +3,7 @@
 #include "Market.h"
 #include <vector>
 #include <memory>
+#include <typeinfo>
 
 namespace MM
 {
@@ -10,7 +11,7 @@ namespace MM
 	{
 		std::vector<Base*> &getActiveIndicators()
 		{
-			return market.getIndicators();
+			return market().getIndicators();
 		}
 
 		Base::Base()
@@ -21,5 +22,16 @@ namespace MM
 		Base::~Base()
 		{
 		}
+
+		std::string Base::getTypeName() const
+		{
+			std::string name = typeid(*this).name();
+			for (const std::string prefix : { "class ", "MM::" })
+			{
+				if (name.compare(0, prefix.size(), prefix) == 0)
+					name.erase(0, prefix.size());
+			}
+			return name;
+		}
 	};
 };
\ No newline at end of file
@@ -17,6 +17,8 @@ namespace MM
 			virtual ~Base();
 
 			virtual std::string getName() const override { return "Indicator"; }
+			// The name of the concrete class: "class MM::Indicators::CCI" -> "Indicators::CCI"
+			std::string getTypeName() const;
 			virtual void execute(const std::time_t &secondsSinceStart, const std::time_t &time) override { update(secondsSinceStart, time); };
 			virtual void onNewTick(const std::string &currencyPair, const QuantLib::Date &date, const std::time_t &time) override {};
 			virtual bool operator== (const Base &other) const = 0;
@@ -0,0 +1,57 @@
+#include "Batch.h"
+
+#include <algorithm>
+
+namespace MM
+{
+	namespace Indicators
+	{
+		Batch::Batch() : lastTime(0), updated(false)
+		{
+		}
+
+		Batch::~Batch()
+		{
+		}
+
+		void Batch::reset()
+		{
+			updated = false;
+			for (size_t lane = 0; lane < stocks.size(); ++lane)
+				resetLane(lane);
+		}
+
+		void Batch::advanceTo(const std::time_t &secondsSinceStart, const std::time_t &time)
+		{
+			if (updated && time == lastTime) return;
+			updated = true;
+			lastTime = time;
+			updateLanes(secondsSinceStart, time);
+		}
+
+		size_t Batch::addLane(Stock *stock)
+		{
+			auto released = std::find(stocks.begin(), stocks.end(), nullptr);
+			const size_t lane = static_cast<size_t>(released - stocks.begin());
+			if (released == stocks.end())
+			{
+				stocks.push_back(stock);
+				resizeLanes(stocks.size());
+			}
+			else
+				stocks[lane] = stock;
+			resetLane(lane);
+			return lane;
+		}
+
+		void Batch::releaseLane(size_t lane)
+		{
+			stocks[lane] = nullptr;
+			resetLane(lane);
+			// Indicators::get creates and deletes a candidate for every lookup, so this usually is the last lane.
+			while (!stocks.empty() && stocks.back() == nullptr)
+				stocks.pop_back();
+			resizeLanes(stocks.size());
+		}
+	};
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Base.h"
+#include <vector>
+
+namespace MM
+{
+	class Stock;
+
+	namespace Indicators
+	{
+		/*
+			Identically configured indicators of several pairs share one batch, which keeps their state as structure of arrays (one lane per pair)
+			and updates all lanes in one pass. The per-pair work that depends on the tick data is gathered lane by lane; the arithmetic runs
+			in branch-free loops over the lanes, which the compiler vectorizes.
+
+			The batch is shared through Indicators::get with its configuration, like BarStream. The per-pair indicators stay the public face for
+			the experts, the exports and the snapshots; they only hold their lane and call advanceTo from their update.
+		*/
+		class Batch : public Base
+		{
+		public:
+			Batch();
+			virtual ~Batch();
+
+			virtual void reset() override;
+			virtual void declareExports() const override {};
+			virtual void update(const std::time_t &secondsSinceStart, const std::time_t &time) override { advanceTo(secondsSinceStart, time); }
+
+			// Updates all lanes once per time; every lane calls this.
+			void advanceTo(const std::time_t &secondsSinceStart, const std::time_t &time);
+
+			// Lanes are never moved. A released lane is reused by the next pair.
+			size_t addLane(Stock *stock);
+			void releaseLane(size_t lane);
+			size_t getLaneCount() const { return stocks.size(); }
+
+		protected:
+			// Nullptr for released lanes.
+			std::vector<Stock*> stocks;
+
+			// Resizes all arrays, new lanes are reset afterwards.
+			virtual void resizeLanes(size_t count) = 0;
+			virtual void resetLane(size_t lane) = 0;
+			virtual void updateLanes(const std::time_t &secondsSinceStart, const std::time_t &time) = 0;
+
+		private:
+			std::time_t lastTime;
+			bool updated;
+		};
+	};
+};
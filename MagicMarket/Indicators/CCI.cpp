@@ -3,35 +3,105 @@
 #include "Market.h"
 #include "Stock.h"
 #include "TimePeriod.h"
+#include "IO/Snapshot.h"
 
 namespace MM
 {
 	namespace Indicators
 	{
-		void CCI::OnlineMeanAbsoluteDeviation::reset()
+		CCIBatch::CCIBatch(int history, int seconds) :
+			history(history),
+			seconds(seconds)
+		{
+		}
+
+		CCIBatch::~CCIBatch()
 		{
-			n = 0;
-			mean = 0.0;
-			M2 = 4.0;
-			MAD = 0.0;
 		}
 
-		void CCI::OnlineMeanAbsoluteDeviation::update(double newValue)
+		void CCIBatch::resizeLanes(size_t count)
 		{
-			n += 1;
-			const double delta = newValue - mean;
-			mean += delta / static_cast<double>(n);
-			double newDelta = newValue - mean;
-			M2 += std::sqrt(std::abs(delta * newDelta));
-			MAD = M2 / static_cast<double>(n);
+			while (windows.size() > count) windows.pop_back();
+			while (windows.size() < count) windows.emplace_back(stocks[windows.size()], seconds);
+			for (std::vector<double> *values : { &high, &low, &close, &valid, &cci, &typicalPriceMA, &lastUpdateTime, &n, &mean, &M2, &MAD })
+				values->resize(count);
+		}
+
+		void CCIBatch::resetLane(size_t lane)
+		{
+			windows[lane] = TickWindow(stocks[lane], seconds);
+			valid[lane] = 0.0;
+			cci[lane] = std::numeric_limits<double>::quiet_NaN();
+			typicalPriceMA[lane] = std::numeric_limits<double>::quiet_NaN();
+			lastUpdateTime[lane] = 0.0;
+			n[lane] = 0.0;
+			mean[lane] = 0.0;
+			M2[lane] = 4.0;
+			MAD[lane] = 0.0;
+		}
+
+		void CCIBatch::updateLanes(const std::time_t &secondsSinceStart, const std::time_t &time)
+		{
+			if (secondsSinceStart < seconds) return;
+
+			const size_t count = getLaneCount();
+			for (size_t i = 0; i < count; ++i)
+			{
+				TickWindow &window = windows[i];
+				const bool available = window.advanceTo(time) && !std::isnan(window.getHigh()) && !std::isnan(window.getLow());
+				valid[i] = available ? 1.0 : 0.0;
+				high[i]  = available ? window.getHigh()  : 0.0;
+				low[i]   = available ? window.getLow()   : 0.0;
+				close[i] = available ? window.getClose() : 0.0;
+			}
+
+			const double now = static_cast<double>(time);
+			const double period = static_cast<double>(seconds);
+			const double historyDouble = static_cast<double>(history);
+			for (size_t i = 0; i < count; ++i)
+			{
+				const double typicalPrice = (high[i] + low[i] + close[i]) / 3.0;
+				const bool available = valid[i] != 0.0;
+				const bool doUpdate = available && ((lastUpdateTime[i] == 0.0) || (now > lastUpdateTime[i] + period));
+
+				// One step of the online mean absolute deviation.
+				const double nextN = n[i] + 1.0;
+				const double delta = typicalPrice - mean[i];
+				const double nextMean = mean[i] + delta / nextN;
+				const double nextM2 = M2[i] + std::sqrt(std::abs(delta * (typicalPrice - nextMean)));
+				// Math::MA(typicalPriceMA, typicalPrice, history)
+				const double nextMA = (typicalPriceMA[i] != typicalPriceMA[i]) ? typicalPrice : ((historyDouble - 1.0) * typicalPriceMA[i] + typicalPrice) / historyDouble;
+
+				lastUpdateTime[i] = doUpdate ? now : lastUpdateTime[i];
+				n[i] = doUpdate ? nextN : n[i];
+				mean[i] = doUpdate ? nextMean : mean[i];
+				M2[i] = doUpdate ? nextM2 : M2[i];
+				MAD[i] = doUpdate ? nextM2 / nextN : MAD[i];
+				typicalPriceMA[i] = doUpdate ? nextMA : typicalPriceMA[i];
+
+				const double value = (1.0 / 0.002) * (typicalPrice - typicalPriceMA[i]) / MAD[i];
+				cci[i] = available ? value : cci[i];
+			}
+
+			for (size_t i = 0; i < count; ++i)
+			{
+				if (valid[i] == 0.0) continue;
+				assert(std::isnormal(cci[i]) || cci[i] == 0.0);
+				assert(cci[i] >= -10000.0 && cci[i] <= +10000.0);
+			}
+		}
+
+		void CCIBatch::deserialize(io::SnapshotReader &reader)
+		{
+			Batch::deserialize(reader);
+			// The windows are rebuilt from the tick data on the next update; the values belong to the CCIs' snapshots.
+			for (size_t lane = 0; lane < windows.size(); ++lane)
+				windows[lane].reset();
 		}
 
 		void CCI::reset()
 		{
-			cci = std::numeric_limits<double>::quiet_NaN();
-			typicalPriceMA = std::numeric_limits<double>::quiet_NaN();
-			lastUpdateTime = 0;
-			OnlineMAD.reset();
+			batch->resetLane(lane);
 		}
 
 		CCI::CCI(std::string currencyPair, int history, int seconds) :
@@ -39,11 +109,15 @@ namespace MM
 			history(history),
 			seconds(seconds)
 		{
+			stock = market().getStock(currencyPair, true);
+			batch = Indicators::get<CCIBatch>(history, seconds);
+			lane = batch->addLane(stock);
 		}
 
 
 		CCI::~CCI()
 		{
+			batch->releaseLane(lane);
 		}
 
 		void CCI::declareExports() const
@@ -53,30 +127,37 @@ namespace MM
 
 		void CCI::update(const std::time_t &secondsSinceStart, const std::time_t &time)
 		{
-			if (secondsSinceStart < seconds) return;
-			Stock *stock = market.getStock(currencyPair);
-			if (stock == nullptr) return;
-
-			MM::TimePeriod now = stock->getTimePeriod(time - seconds, time);
-			const MM::PossibleDecimal high = now.getHigh();
-			const MM::PossibleDecimal low = now.getLow();
-			const MM::PossibleDecimal close = now.getClose();
+			batch->advanceTo(secondsSinceStart, time);
+		}
 
-			if (!high.get() || !low.get()) return;
+		void CCI::serialize(io::SnapshotWriter &writer) const
+		{
+			Base::serialize(writer);
+			writer.write(batch->cci[lane]);
+			writer.write(batch->typicalPriceMA[lane]);
+			writer.write(static_cast<std::time_t>(batch->lastUpdateTime[lane]));
 
-			const QuantLib::Decimal typicalPrice = (*high + *low + *close) / 3.0;
-			const bool doUpdate = (lastUpdateTime == 0) || (time > lastUpdateTime + seconds);
+			OnlineMeanAbsoluteDeviation OnlineMAD;
+			OnlineMAD.n = static_cast<int>(batch->n[lane]);
+			OnlineMAD.mean = batch->mean[lane];
+			OnlineMAD.M2 = batch->M2[lane];
+			OnlineMAD.MAD = batch->MAD[lane];
+			writer.write(OnlineMAD);
+		}
 
-			if (doUpdate)
-			{
-				lastUpdateTime = time;
-				OnlineMAD.update(typicalPrice);
-				typicalPriceMA = Math::MA(typicalPriceMA, typicalPrice, history);
-			}
+		void CCI::deserialize(io::SnapshotReader &reader)
+		{
+			Base::deserialize(reader);
+			reader.read(batch->cci[lane]);
+			reader.read(batch->typicalPriceMA[lane]);
+			batch->lastUpdateTime[lane] = static_cast<double>(reader.read<std::time_t>());
 
-			cci = (1.0 / 0.002) * (typicalPrice - typicalPriceMA) / OnlineMAD.MAD;
-			assert(std::isnormal(cci) || cci == 0.0);
-			assert(cci >= -10000.0 && cci <= +10000.0);
+			OnlineMeanAbsoluteDeviation OnlineMAD;
+			reader.read(OnlineMAD);
+			batch->n[lane] = static_cast<double>(OnlineMAD.n);
+			batch->mean[lane] = OnlineMAD.mean;
+			batch->M2[lane] = OnlineMAD.M2;
+			batch->MAD[lane] = OnlineMAD.MAD;
 		}
 	};
-};
\ No newline at end of file
+};
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Base.h"
+#include "Batch.h"
+#include "TickWindow.h"
 #include <string>
 
 namespace MM
@@ -11,6 +13,43 @@ namespace MM
 	{
 		class Moves;
 
+		// The CCIs of all pairs with the same configuration.
+		class CCIBatch : public Batch
+		{
+		public:
+			CCIBatch(int history, int seconds);
+			virtual ~CCIBatch();
+
+			virtual bool operator== (const Base &otherBase) const
+			{
+				const CCIBatch* other = dynamic_cast<const CCIBatch*>(&otherBase);
+				if (other == nullptr) return false;
+				return (other->history == history) && (other->seconds == seconds);
+			}
+
+			virtual void deserialize(io::SnapshotReader &reader) override;
+
+		private:
+			int history;
+			int seconds;
+
+			std::vector<TickWindow> windows;
+			// Structure of arrays, one entry per lane.
+			std::vector<double> high, low, close, valid;
+			std::vector<double> cci;
+			std::vector<double> typicalPriceMA;
+			// Exactly representable, so that it fits into the vectorized loop.
+			std::vector<double> lastUpdateTime;
+			// The online mean absolute deviation.
+			std::vector<double> n, mean, M2, MAD;
+
+			virtual void resizeLanes(size_t count) override;
+			virtual void resetLane(size_t lane) override;
+			virtual void updateLanes(const std::time_t &secondsSinceStart, const std::time_t &time) override;
+
+			friend class CCI;
+		};
+
 		// https://en.wikipedia.org/wiki/Commodity_channel_index
 		class CCI : public Base
 		{
@@ -28,30 +67,28 @@ namespace MM
 				return (other->history == history) && (other->seconds == seconds) && (other->currencyPair == currencyPair);
 			}
 
-			double getCCI() const { return cci; }
+			double getCCI() const { return batch->cci[lane]; }
+
+			virtual void serialize(io::SnapshotWriter &writer) const override;
+			virtual void deserialize(io::SnapshotReader &reader) override;
 
 		private:
 			std::string currencyPair;
+			Stock *stock;
 			int history;
 			int seconds;
-			double cci;
-
-			double typicalPriceMA;
-			std::time_t lastUpdateTime;
+			CCIBatch *batch;
+			size_t lane;
 
-			// For the online mean absolute deviation.
+			// Layout of the online mean absolute deviation in the snapshots.
 			struct OnlineMeanAbsoluteDeviation
 			{
 				int n = 0;
 				double mean = 0.0;
 				double M2 = 0.0;
 				double MAD = 0.0;
-
-				void reset();
-				void update(double newValue);
-
-			} OnlineMAD;
+			};
 		};
 
 	};
-};
\ No newline at end of file
+};
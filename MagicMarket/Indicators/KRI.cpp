@@ -3,6 +3,7 @@
 #include "Market.h"
 #include "Stock.h"
 #include "TimePeriod.h"
+#include "IO/Snapshot.h"
 
 namespace MM
 {
@@ -18,6 +19,7 @@ namespace MM
 			history(history),
 			seconds(seconds)
 		{
+			stock = market().getStock(currencyPair, true);
 			sma = Indicators::get<SMA>(currencyPair, history, seconds);
 		}
 
@@ -35,7 +37,6 @@ namespace MM
 			const double &smaValue = sma->getSMA();
 			if (std::isnan(smaValue)) return;
 
-			Stock *stock = market.getStock(currencyPair);
 			if (stock == nullptr) return;
 			MM::TimePeriod now = stock->getTimePeriod(time - seconds, time);
 			const PossibleDecimal price = now.getClose();
@@ -43,5 +44,17 @@ namespace MM
 
 			kri = 100.0 * (*price - smaValue) / smaValue;
 		}
+
+		void KRI::serialize(io::SnapshotWriter &writer) const
+		{
+			Base::serialize(writer);
+			writer.write(kri);
+		}
+
+		void KRI::deserialize(io::SnapshotReader &reader)
+		{
+			Base::deserialize(reader);
+			reader.read(kri);
+		}
 	};
 };
\ No newline at end of file
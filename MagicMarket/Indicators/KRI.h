@@ -30,8 +30,12 @@ namespace MM
 
 			double getKRI() const { return kri; }
 
+			virtual void serialize(io::SnapshotWriter &writer) const override;
+			virtual void deserialize(io::SnapshotReader &reader) override;
+
 		private:
 			std::string currencyPair;
+			Stock *stock;
 			int history;
 			int seconds;
 			double kri;
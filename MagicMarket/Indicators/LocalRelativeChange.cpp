@@ -3,8 +3,10 @@
 #include "Stock.h"
 #include "TimePeriod.h"
 #include "Statistics.h"
+#include "TradingDay.h"
 
 #include "Helpers.h"
+#include "IO/Snapshot.h"
 
 #include <algorithm>
 
@@ -12,6 +14,88 @@ namespace MM
 {
 	namespace Indicators
 	{
+		LocalRelativeChangeBatch::LocalRelativeChangeBatch(std::vector<int> lookbackDurations) :
+			lookbackDurations(lookbackDurations)
+		{
+			// Figure out first value of series as the basis for the relative data.
+			maxLookbackIndex = static_cast<size_t>(std::max_element(lookbackDurations.begin(), lookbackDurations.end()) - lookbackDurations.begin());
+			minLookbackIndex = static_cast<size_t>(std::min_element(lookbackDurations.begin(), lookbackDurations.end()) - lookbackDurations.begin());
+		}
+
+		LocalRelativeChangeBatch::~LocalRelativeChangeBatch()
+		{
+		}
+
+		void LocalRelativeChangeBatch::resizeLanes(size_t count)
+		{
+			indicators.resize(count, nullptr);
+			values.assign(lookbackDurations.size() * count, std::numeric_limits<double>::quiet_NaN());
+			for (std::vector<double> *laneValues : { &firstDataValue, &trendGradient, &estimatedStdDeviation })
+				laneValues->resize(count);
+		}
+
+		void LocalRelativeChangeBatch::resetLane(size_t lane)
+		{
+			const size_t count = getLaneCount();
+			for (size_t i = 0; i < lookbackDurations.size(); ++i)
+				values[i * count + lane] = std::numeric_limits<double>::quiet_NaN();
+		}
+
+		void LocalRelativeChangeBatch::updateLanes(const std::time_t &secondsSinceStart, const std::time_t &time)
+		{
+			const size_t count = getLaneCount();
+			const size_t lookbacks = lookbackDurations.size();
+			if (count == 0) return;
+
+			// The prices at the lookbacks, lookback-major.
+			for (size_t lane = 0; lane < count; ++lane)
+			{
+				LocalRelativeChange * const indicator = indicators[lane];
+				if (indicator != nullptr && indicator->sample(time, &values[lane], count, estimatedStdDeviation[lane])) continue;
+				resetLane(lane);
+				estimatedStdDeviation[lane] = 1.0;
+			}
+
+			// First, detrend it (assuming a linear trend during the lookback timeframe).
+			const double trendLength = static_cast<double>(lookbackDurations[maxLookbackIndex] - lookbackDurations[minLookbackIndex]);
+			assert(trendLength > 0.0);
+			const double * const firstValues = &values[maxLookbackIndex * count];
+			const double * const lastValues = &values[minLookbackIndex * count];
+			for (size_t lane = 0; lane < count; ++lane)
+			{
+				// A single missing price invalidates the whole lane.
+				double missing = 0.0;
+				for (size_t i = 0; i < lookbacks; ++i)
+					missing += 0.0 * values[i * count + lane];
+				firstDataValue[lane] = firstValues[lane] + missing;
+				trendGradient[lane] = (lastValues[lane] - firstValues[lane]) / trendLength + missing;
+			}
+
+			// Center it first, remove the linear trend and normalize it by the estimated stddev.
+			for (size_t i = 0; i < lookbacks; ++i)
+			{
+				const double offset = static_cast<double>(lookbackDurations[maxLookbackIndex] - lookbackDurations[i]);
+				double * const lookbackValues = &values[i * count];
+				for (size_t lane = 0; lane < count; ++lane)
+					lookbackValues[lane] = ((lookbackValues[lane] - firstDataValue[lane]) - offset * trendGradient[lane]) / estimatedStdDeviation[lane];
+			}
+
+			for (size_t lane = 0; lane < count; ++lane)
+			{
+				LocalRelativeChange * const indicator = indicators[lane];
+				if (indicator == nullptr) continue;
+				std::vector<double> &lookbackDerivatives = indicator->lookbackDerivatives;
+				for (size_t i = 0; i < lookbacks; ++i)
+				{
+					lookbackDerivatives[i] = values[i * count + lane];
+					assert(std::isnan(lookbackDerivatives[i]) || std::isnormal(lookbackDerivatives[i]) || lookbackDerivatives[i] == 0.0);
+				}
+				// Due to de-trending, we have some assertions.
+				assert(std::isnan(lookbackDerivatives[maxLookbackIndex]) || std::abs(lookbackDerivatives[maxLookbackIndex]) < 1.e-10);
+				assert(std::isnan(lookbackDerivatives[minLookbackIndex]) || std::abs(lookbackDerivatives[minLookbackIndex]) < 1.e-10);
+			}
+		}
+
 		void LocalRelativeChange::reset()
 		{
 			const double *lastValue = &lookbackDerivatives.back();
@@ -20,17 +104,46 @@ namespace MM
 				lookbackDerivatives.push_back(std::numeric_limits<double>::quiet_NaN());
 			// The memory location should not change.
 			assert(lastValue == &lookbackDerivatives.back());
+
+			resetStream();
+		}
+
+		void LocalRelativeChange::resetStream()
+		{
+			cursor.reset();
+			std::fill(prices.begin(), prices.end(), std::numeric_limits<double>::quiet_NaN());
+			pricesUntil = 0;
+			currentPrice = std::numeric_limits<double>::quiet_NaN();
+
+			std::fill(sampleChanges.begin(), sampleChanges.end(), 0.0);
+			sampleCount = 0;
+			lastSample = std::numeric_limits<double>::quiet_NaN();
+			sampleDeviation = 1.0;
 		}
 
 		LocalRelativeChange::LocalRelativeChange(std::string currencyPair, std::vector<int> lookbackDurations) :
 			currencyPair(currencyPair),
-			lookbackDurations(lookbackDurations)
+			lookbackDurations(lookbackDurations),
+			cursor(market().getStock(currencyPair, true))
 		{
+			stock = market().getStock(currencyPair, true);
+			normalize = market().getParameter("LocalRelativeChange.Normalize", 0.0) != 0.0;
 			lookbackDerivatives.resize(lookbackDurations.size());
+
+			const int maxLookbackDuration = *std::max_element(lookbackDurations.begin(), lookbackDurations.end());
+			prices.resize(maxLookbackDuration + 1);
+			sampleChanges.resize(NORMALIZATION_DURATION / NORMALIZATION_INTERVAL);
+			resetStream();
+
+			batch = Indicators::get<LocalRelativeChangeBatch>(lookbackDurations);
+			lane = batch->addLane(stock);
+			batch->indicators[lane] = this;
 		}
 
 		LocalRelativeChange::~LocalRelativeChange()
 		{
+			batch->indicators[lane] = nullptr;
+			batch->releaseLane(lane);
 		}
 
 		void LocalRelativeChange::declareExports() const
@@ -52,93 +165,102 @@ namespace MM
 				{
 					const std::string name = namePrefix + std::to_string(lookback) + "s";
 					const std::string desc = "Local relative change of " + currencyPair + " with lookback " + std::to_string(lookback) + " " + allLookbacks;
-					statistics.addVariable(Variable(name, &lookbackDerivatives[index], desc));
+					statistics().addVariable(Variable(name, &lookbackDerivatives[index], desc));
 				}
 				index += 1;
 			}
 		}
 
-		void LocalRelativeChange::update(const std::time_t &secondsSinceStart, const std::time_t &time)
+		void LocalRelativeChange::addSample(double price)
 		{
-			Stock *stock = market.getStock(currencyPair);
-			if (stock == nullptr) return;
+			const double change = price - lastSample;
+			lastSample = price;
+			if (std::isnan(change)) return;
 
-			int maxLookbackIndex = -1;
-			int minLookbackIndex = -1;
-			bool pricesMissing = false;
+			sampleChanges[sampleCount % sampleChanges.size()] = change;
+			++sampleCount;
 
-			for (size_t i = 0; i < lookbackDurations.size(); ++i)
-			{
-				const int &lookback = lookbackDurations[i];
-
-				// Figure out first value of series as the basis for the relative data.
-				if (maxLookbackIndex == -1 || lookback > lookbackDurations[maxLookbackIndex])
-					maxLookbackIndex = i;
-				if (minLookbackIndex == -1 || lookback < lookbackDurations[minLookbackIndex])
-					minLookbackIndex = i;
+			// Two passes over a handful of samples, once per interval.
+			const size_t count = std::min(sampleCount, sampleChanges.size());
+			sampleDeviation = 1.0;
+			if (count < 5) return;
+			const double n = static_cast<double>(count);
+			double mean = 0.0;
+			for (size_t i = 0; i < count; ++i)
+				mean += sampleChanges[i];
+			mean /= n;
+			double squareSum = 0.0;
+			for (size_t i = 0; i < count; ++i)
+				squareSum += (sampleChanges[i] - mean) * (sampleChanges[i] - mean);
+			const double deviation = std::sqrt(squareSum / (n - 1.0));
+			if (std::isnormal(deviation))
+				sampleDeviation = deviation;
+		}
 
-				double &value = lookbackDerivatives[i];
+		bool LocalRelativeChange::advanceTo(const std::time_t &time)
+		{
+			const std::time_t size = static_cast<std::time_t>(prices.size());
+			// What needs to be known after a restart: the longest lookback and the normalization samples.
+			const std::time_t span = normalize ? std::max<std::time_t>(size, NORMALIZATION_DURATION + NORMALIZATION_INTERVAL) : size;
 
-				MM::TimePeriod now = stock->getTimePeriod(time - lookback);
-				const PossibleDecimal price = now.getOpen();
-				if (!price.get())
-				{
-					value = std::numeric_limits<double>::quiet_NaN();
-					pricesMissing = true;
-					continue;
-				}
-				else value = *price;
+			bool restarted = false;
+			if (!cursor.seek(time, time - span, restarted))
+			{
+				resetStream();
+				return false;
 			}
-			assert(minLookbackIndex != -1);
-			assert(maxLookbackIndex != -1);
-			//assert(std::isnan(lookbackDerivatives[maxLookbackIndex]) || !std::isnan(lookbackDerivatives[minLookbackIndex]));
-
-			if (pricesMissing)
+			if (restarted)
 			{
-				for (auto & value : lookbackDerivatives)
-					value = std::numeric_limits<double>::quiet_NaN();
-				return;
+				std::fill(prices.begin(), prices.end(), std::numeric_limits<double>::quiet_NaN());
+				sampleCount = 0;
+				lastSample = std::numeric_limits<double>::quiet_NaN();
+				sampleDeviation = 1.0;
+				// Like TimePeriod::getOpen, the first tick of the day does not count.
+				const Tick *previous = cursor.getPrevious();
+				currentPrice = (previous != nullptr && cursor.getPosition() >= 2) ? previous->getMid() : std::numeric_limits<double>::quiet_NaN();
+				pricesUntil = time - span - 1;
 			}
-			// And normalize the data.
+			if (cursor.getTicks().size() < 3) return false;
 
-			// Figure out normalization factor to use.
-			double estimatedStdDeviation = 1.0;
-			MM::TimePeriod normalizationPeriod = stock->getTimePeriod(time - 2 * ONEHOUR);
-			std::vector<double> stdDevEstimationSamples = normalizationPeriod.toVector(10 * ONEMINUTE);
-			if (stdDevEstimationSamples.size() > 5)
+			// Usually one second per update; after longer pauses, only what is still needed.
+			for (std::time_t second = std::max(pricesUntil + 1, time - span); second <= time; ++second)
 			{
-				stdDevEstimationSamples = Math::derive(stdDevEstimationSamples);
-				assert(stdDevEstimationSamples.size() > 2);
-				estimatedStdDeviation = Math::stddev(stdDevEstimationSamples);
+				while (const Tick *tick = cursor.next(second))
+					currentPrice = (cursor.getPosition() >= 2) ? tick->getMid() : std::numeric_limits<double>::quiet_NaN();
+				prices[second % size] = currentPrice;
+				if (normalize && second % NORMALIZATION_INTERVAL == 0)
+					addSample(currentPrice);
 			}
+			pricesUntil = std::max(pricesUntil, time);
+			return true;
+		}
 
-			// First, detrend it (assuming a linear trend during the lookback timeframe).
-			const double trendLength = static_cast<double>(lookbackDurations[maxLookbackIndex] - lookbackDurations[minLookbackIndex]);
-			assert(trendLength > 0.0);
-			const double trendAbsolute = lookbackDerivatives[minLookbackIndex] - lookbackDerivatives[maxLookbackIndex];
-			const double trendGradient = trendAbsolute / trendLength;
-			assert(!std::isnan(trendGradient));
+		void LocalRelativeChange::update(const std::time_t &secondsSinceStart, const std::time_t &time)
+		{
+			batch->advanceTo(secondsSinceStart, time);
+		}
 
-			const double firstDataValue = (maxLookbackIndex == -1) ? std::numeric_limits<double>::quiet_NaN() : lookbackDerivatives[maxLookbackIndex];
-			// Center it first and remove linear trend.
-			for (size_t i = 0; i < lookbackDerivatives.size(); ++i)
-			{
-				double & value = lookbackDerivatives[i];
-				const int lookback = lookbackDurations[i];
-				const double offset = static_cast<double>(lookbackDurations[maxLookbackIndex] - lookback);
-				// Make it relative to the first observation.
-				value = (value - firstDataValue);
-				// Remove the constant linear trend.
-				value = (value - offset * trendGradient);
-				assert(std::isnormal(value) || value == 0.0);
-			}
-			assert(!std::isnan(estimatedStdDeviation));
-			// And then normalize it by estimated stddev.
-			for (double & value : lookbackDerivatives)
-				value /= estimatedStdDeviation;
-			// Due to de-trending, we have some assertions.
-			assert(std::isnan(lookbackDerivatives[maxLookbackIndex]) || std::abs(lookbackDerivatives[maxLookbackIndex]) < 1.e-10);
-			assert(std::isnan(lookbackDerivatives[minLookbackIndex]) || std::abs(lookbackDerivatives[minLookbackIndex]) < 1.e-10);
+		bool LocalRelativeChange::sample(const std::time_t &time, double *values, size_t stride, double &estimatedStdDeviation)
+		{
+			if (!advanceTo(time)) return false;
+			for (size_t i = 0; i < lookbackDurations.size(); ++i)
+				values[i * stride] = prices[(time - lookbackDurations[i]) % prices.size()];
+			estimatedStdDeviation = normalize ? getEstimatedStdDeviation() : 1.0;
+			return true;
+		}
+
+		void LocalRelativeChange::serialize(io::SnapshotWriter &writer) const
+		{
+			Base::serialize(writer);
+			writer.write(lookbackDerivatives);
+		}
+
+		void LocalRelativeChange::deserialize(io::SnapshotReader &reader)
+		{
+			Base::deserialize(reader);
+			reader.read(lookbackDerivatives);
+			// The price history is rebuilt from the tick data on the next update.
+			resetStream();
 		}
 	};
 };
\ No newline at end of file
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "Base.h"
+#include "Batch.h"
+#include "TickCursor.h"
+#include "Helpers.h"
 #include <string>
 
 namespace MM
@@ -9,6 +12,39 @@ namespace MM
 
 	namespace Indicators
 	{
+		class LocalRelativeChange;
+
+		// Detrends and normalizes the local relative changes of all pairs with the same lookbacks.
+		class LocalRelativeChangeBatch : public Batch
+		{
+		public:
+			LocalRelativeChangeBatch(std::vector<int> lookbackDurations);
+			virtual ~LocalRelativeChangeBatch();
+
+			virtual bool operator== (const Base &otherBase) const
+			{
+				const LocalRelativeChangeBatch* other = dynamic_cast<const LocalRelativeChangeBatch*>(&otherBase);
+				if (other == nullptr) return false;
+				return other->lookbackDurations == lookbackDurations;
+			}
+
+		private:
+			std::vector<int> lookbackDurations;
+			size_t maxLookbackIndex, minLookbackIndex;
+
+			// The price streams stay with the indicators; their exports point to lookbackDerivatives.
+			std::vector<LocalRelativeChange*> indicators;
+			// Structure of arrays: values[lookback * lanes + lane] and one entry per lane.
+			std::vector<double> values;
+			std::vector<double> firstDataValue, trendGradient, estimatedStdDeviation;
+
+			virtual void resizeLanes(size_t count) override;
+			virtual void resetLane(size_t lane) override;
+			virtual void updateLanes(const std::time_t &secondsSinceStart, const std::time_t &time) override;
+
+			friend class LocalRelativeChange;
+		};
+
 		class LocalRelativeChange : public Base
 		{
 		public:
@@ -25,10 +61,43 @@ namespace MM
 				return (other->currencyPair == currencyPair) && other->lookbackDurations == lookbackDurations;
 			}
 
+			virtual void serialize(io::SnapshotWriter &writer) const override;
+			virtual void deserialize(io::SnapshotReader &reader) override;
+
 		private:
 			std::string currencyPair;
+			Stock *stock;
 			std::vector<int> lookbackDurations;
 			std::vector<double> lookbackDerivatives;
+			LocalRelativeChangeBatch *batch;
+			size_t lane;
+			// Writes the prices at the lookbacks to values[i * stride].
+			bool sample(const std::time_t &time, double *values, size_t stride, double &estimatedStdDeviation);
+
+			// The prices are streamed from the ticks, so that an update does not have to query the tick data for every lookback.
+			TickCursor cursor;
+			// Price at every second of the longest lookback (ring buffer, indexed by time); NaN where TimePeriod::getOpen has none.
+			std::vector<double> prices;
+			std::time_t pricesUntil;
+			double currentPrice;
+			bool advanceTo(const std::time_t &time);
+
+			// Optional normalization by the standard deviation of the changes between 10-minute samples over the last two hours.
+			// Off by default (the values were never normalized before); see the LocalRelativeChange.Normalize parameter.
+			bool normalize;
+			static const int NORMALIZATION_INTERVAL = 10 * ONEMINUTE;
+			static const int NORMALIZATION_DURATION = 2 * ONEHOUR;
+			std::vector<double> sampleChanges;
+			size_t sampleCount;
+			double lastSample;
+			// Recomputed from the ring with every sample; running sums would cancel out over a long replay.
+			double sampleDeviation;
+			void addSample(double price);
+			double getEstimatedStdDeviation() const { return sampleDeviation; }
+
+			void resetStream();
+
+			friend class LocalRelativeChangeBatch;
 		};
 
 	};
@@ -2,6 +2,7 @@
 #include "Market.h"
 #include "Stock.h"
 #include "TimePeriod.h"
+#include "IO/Snapshot.h"
 
 namespace MM
 {
@@ -17,7 +18,8 @@ namespace MM
 			momentumMA = momentumMA_pushed = std::numeric_limits<double>::quiet_NaN();
 			momentumAbsMA = momentumAbsMA_pushed = std::numeric_limits<double>::quiet_NaN();
 
-			lastMAPush = 0;
+			hasLastBar = false;
+			subscription = BarStream::Subscription();
 		}
 
 		Moves::Moves(std::string currencyPair, int history, int seconds) :
@@ -25,7 +27,8 @@ namespace MM
 			history(history),
 			seconds(seconds)
 		{
-		
+			bars = Indicators::get<BarStream>(currencyPair, seconds);
+			bars->requireHistory(history + 2);
 		}
 
 		Moves::~Moves()
@@ -44,79 +47,116 @@ namespace MM
 			exportVariable("momentumMAAbs", std::bind(&Moves::getAbsoluteMomentumMA, this), "period " + std::to_string(seconds) + ", memory " + std::to_string(history));
 		}
 
-		void Moves::update(const std::time_t &secondsSinceStart, const std::time_t &time)
+		Moves::Changes Moves::getChanges(const BarStream::Bar &then, const BarStream::Bar &now)
 		{
-			Stock *stock = market.getStock(currencyPair);
-			if (stock == nullptr) return;
-
-			MM::TimePeriod now = stock->getTimePeriod(time - seconds, time);
-			const MM::PossibleDecimal high = now.getHigh();
-			const MM::PossibleDecimal low = now.getLow();
-			const MM::PossibleDecimal close = now.getClose();
-
-			MM::TimePeriod then = stock->getTimePeriod(time - 2 * seconds, time - seconds);
-			const MM::PossibleDecimal oldHigh = then.getHigh();
-			const MM::PossibleDecimal oldLow = then.getLow();
-			const MM::PossibleDecimal oldClose = then.getClose();
-
-			if (!high.get() || !low.get() || !oldHigh.get() || !oldLow.get()) return;
-
-			bool refreshMovingAverages = false;
-			if (time >= (lastMAPush + seconds))
-			{
-				refreshMovingAverages = true;
-				lastMAPush = time;
-			}
+			Changes changes;
 
 			/* Up and Down changes for the ADX */
-			const double upMove   = *high - *oldHigh;
-			const double downMove = *low  - *oldLow;
+			const double upMove   = now.high - then.high;
+			const double downMove = now.low  - then.low;
 
-			double plusDM = 0.0, minusDM = 0.0;
-			if (upMove > downMove && upMove > 0.0) plusDM = upMove;
+			changes.plusDM = changes.minusDM = 0.0;
+			if (upMove > downMove && upMove > 0.0) changes.plusDM = upMove;
 			else 
-			if (downMove > upMove && downMove > 0.0) minusDM = downMove;
+			if (downMove > upMove && downMove > 0.0) changes.minusDM = downMove;
+
+			/* Simple Up and Down moves for the RSI */
+			changes.move = now.close - then.close;
+			changes.up = changes.down = 0.0;
+			if (changes.move > 0.0) changes.up = changes.move;
+			else if (changes.move < 0.0) changes.down = -changes.move;
+			return changes;
+		}
 
-			const double historyDouble = static_cast<double>(history);
+		void Moves::push(const Changes &changes)
+		{
+			plusDMMA_pushed  = Math::MA(plusDMMA_pushed, changes.plusDM, history);
+			minusDMMA_pushed = Math::MA(minusDMMA_pushed, changes.minusDM, history);
 
-			plusDMMA = Math::MA(plusDMMA_pushed, plusDM, history);
-			minusDMMA = Math::MA(minusDMMA_pushed, minusDM, history);
+			upMA_pushed   = Math::MA(upMA_pushed, changes.up, history);
+			downMA_pushed = Math::MA(downMA_pushed, changes.down, history);
 
-			if (refreshMovingAverages)
-			{
-				plusDMMA_pushed = plusDMMA;
-				minusDMMA_pushed = minusDMMA;
-			}
+			momentumMA_pushed    = Math::MA2(momentumMA_pushed, changes.move, history);
+			momentumAbsMA_pushed = Math::MA2(momentumAbsMA_pushed, std::abs(changes.move), history);
+		}
+
+		void Moves::publish(const Changes &changes)
+		{
+			plusDMMA  = Math::MA(plusDMMA_pushed, changes.plusDM, history);
+			minusDMMA = Math::MA(minusDMMA_pushed, changes.minusDM, history);
 
 			assert(std::isnormal(plusDMMA) || plusDMMA == 0.0);
 			assert(std::isnormal(minusDMMA) || minusDMMA == 0.0);
 			assert(plusDMMA >= -2.0 && plusDMMA <= +2.0);
 			assert(minusDMMA >= -2.0 && minusDMMA <= +2.0);
-			/* Simple Up and Down moves for the RSI */
-			if (!close.get() || !oldClose.get()) return;
-			const double move = *close - *oldClose;
-			double U(0.0), D(0.0);
-			if (move > 0.0) U = move;
-			else if (move < 0.0) D = -move;
 
-			upMA   = Math::MA(upMA_pushed, U, history);
-			downMA = Math::MA(downMA_pushed, D, history);
+			upMA   = Math::MA(upMA_pushed, changes.up, history);
+			downMA = Math::MA(downMA_pushed, changes.down, history);
+
+			/* smoothed momentum for TSI */
+			momentumMA    = Math::MA2(momentumMA_pushed, changes.move, history);
+			momentumAbsMA = Math::MA2(momentumAbsMA_pushed, std::abs(changes.move), history);
+		}
 
-			if (refreshMovingAverages)
+		void Moves::update(const std::time_t &secondsSinceStart, const std::time_t &time)
+		{
+			if (!bars->advanceTo(time)) return;
+			if (!bars->synchronize(subscription))
 			{
-				upMA_pushed = upMA;
-				downMA_pushed = downMA;
+				plusDMMA_pushed = minusDMMA_pushed = std::numeric_limits<double>::quiet_NaN();
+				upMA_pushed = downMA_pushed = std::numeric_limits<double>::quiet_NaN();
+				momentumMA_pushed = momentumAbsMA_pushed = std::numeric_limits<double>::quiet_NaN();
+				hasLastBar = false;
 			}
 
-			/* smoothed momentum for TSI */
-			momentumMA    = Math::MA2(momentumMA_pushed, move, history);
-			momentumAbsMA = Math::MA2(momentumAbsMA_pushed, std::abs(move), history);
-
-			if (refreshMovingAverages)
+			// Every completed bar is consumed exactly once.
+			while (const BarStream::Bar *bar = bars->next(subscription))
 			{
-				momentumMA_pushed = momentumMA;
-				momentumAbsMA_pushed = momentumAbsMA;
+				if (hasLastBar)
+					push(getChanges(lastBar, *bar));
+				lastBar = *bar;
+				hasLastBar = true;
 			}
+			if (!hasLastBar) return;
+
+			publish(getChanges(lastBar, bars->getPartialBar()));
+		}
+
+		void Moves::serialize(io::SnapshotWriter &writer) const
+		{
+			Base::serialize(writer);
+			writer.write(plusDMMA);
+			writer.write(minusDMMA);
+			writer.write(plusDMMA_pushed);
+			writer.write(minusDMMA_pushed);
+			writer.write(upMA);
+			writer.write(downMA);
+			writer.write(upMA_pushed);
+			writer.write(downMA_pushed);
+			writer.write(momentumMA);
+			writer.write(momentumAbsMA);
+			writer.write(momentumMA_pushed);
+			writer.write(momentumAbsMA_pushed);
+		}
+
+		void Moves::deserialize(io::SnapshotReader &reader)
+		{
+			Base::deserialize(reader);
+			reader.read(plusDMMA);
+			reader.read(minusDMMA);
+			reader.read(plusDMMA_pushed);
+			reader.read(minusDMMA_pushed);
+			reader.read(upMA);
+			reader.read(downMA);
+			reader.read(upMA_pushed);
+			reader.read(downMA_pushed);
+			reader.read(momentumMA);
+			reader.read(momentumAbsMA);
+			reader.read(momentumMA_pushed);
+			reader.read(momentumAbsMA_pushed);
+			// The bars are rebuilt from the stream's history on the next update.
+			hasLastBar = false;
+			subscription = BarStream::Subscription();
 		}
 	};
 };
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Base.h"
+#include "BarStream.h"
 #include <string>
 
 namespace MM
@@ -35,10 +36,30 @@ namespace MM
 			// for TSI
 			double getMomentumMA() const { return momentumMA; }
 			double getAbsoluteMomentumMA() const { return momentumAbsMA; }
+
+			virtual void serialize(io::SnapshotWriter &writer) const override;
+			virtual void deserialize(io::SnapshotReader &reader) override;
+
 		private:
 			std::string currencyPair;
 			int seconds;
 			int history;
+			BarStream *bars;
+			BarStream::Subscription subscription;
+			// The moves are measured against the last completed bar.
+			BarStream::Bar lastBar;
+			bool hasLastBar;
+
+			struct Changes
+			{
+				double plusDM, minusDM;
+				double up, down;
+				double move;
+			};
+			static Changes getChanges(const BarStream::Bar &then, const BarStream::Bar &now);
+			// The _pushed averages contain the completed bars; the published ones also the bar in progress.
+			void push(const Changes &changes);
+			void publish(const Changes &changes);
 
 			double plusDMMA;
 			double minusDMMA;
@@ -54,9 +75,6 @@ namespace MM
 			double momentumAbsMA;
 			double momentumMA_pushed;
 			double momentumAbsMA_pushed;
-
-			// Refresh the moving averages only when the time for one period is passed.
-			std::time_t lastMAPush;
 		};
 
 	};
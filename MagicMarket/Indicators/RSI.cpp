@@ -3,6 +3,7 @@
 #include "Market.h"
 #include "Stock.h"
 #include "TimePeriod.h"
+#include "IO/Snapshot.h"
 
 namespace MM
 {
@@ -52,5 +53,17 @@ namespace MM
 			assert(rsi <= 101.0);
 			rsi = Math::clamp(rsi, 0.0, 100.0);
 		}
+
+		void RSI::serialize(io::SnapshotWriter &writer) const
+		{
+			Base::serialize(writer);
+			writer.write(rsi);
+		}
+
+		void RSI::deserialize(io::SnapshotReader &reader)
+		{
+			Base::deserialize(reader);
+			reader.read(rsi);
+		}
 	};
 };
\ No newline at end of file
@@ -30,6 +30,9 @@ namespace MM
 
 			double getRSI() const { return rsi; }
 
+			virtual void serialize(io::SnapshotWriter &writer) const override;
+			virtual void deserialize(io::SnapshotReader &reader) override;
+
 		private:
 			std::string currencyPair;
 			int history;
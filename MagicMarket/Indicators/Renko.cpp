@@ -1,7 +1,7 @@
 #include "Renko.h"
 #include "Market.h"
 #include "Stock.h"
-#include "TimePeriod.h"
+#include "IO/Snapshot.h"
 
 namespace MM
 {
@@ -11,6 +11,7 @@ namespace MM
 		{
 			lastBarAt = std::numeric_limits<double>::quiet_NaN();
 			currentBarIndex = 0;
+			window.reset();
 
 			bars.clear();
 			for (int i = 0; i < history; ++i)
@@ -19,8 +20,10 @@ namespace MM
 
 		Renko::Renko(std::string currencyPair, int history, double minimumChange) :
 			currencyPair(currencyPair),
+			stock(market().getStock(currencyPair, true)),
 			history(history),
-			minimumChange(minimumChange)
+			minimumChange(minimumChange),
+			window(stock, 0)
 		{
 		}
 
@@ -35,20 +38,18 @@ namespace MM
 
 		void Renko::update(const std::time_t &secondsSinceStart, const std::time_t &time)
 		{
-			Stock *stock = market.getStock(currencyPair);
 			if (stock == nullptr) return;
-			MM::TimePeriod now = stock->getTimePeriod(time);
-			const PossibleDecimal price = now.getClose();
-			if (!price.get()) return;
+			if (!window.advanceTo(time)) return;
+			const double price = window.getClose();
 
 			if (std::isnan(lastBarAt))
 			{
-				lastBarAt = *price;
+				lastBarAt = price;
 				return;
 			}
 
 			// Do we need a new bar?
-			const double change = *price - lastBarAt;
+			const double change = price - lastBarAt;
 			const double absChange = std::abs(change);
 			if (absChange < minimumChange) return;
 
@@ -60,7 +61,7 @@ namespace MM
 			bars[currentBarIndex] = direction;
 			currentBarIndex = (currentBarIndex + 1) % bars.size();
 
-			lastBarAt = *price;
+			lastBarAt = price;
 		}
 
 		int Renko::getOffsetIndex(int offset) const
@@ -91,5 +92,22 @@ namespace MM
 			}
 			return subbars;
 		}
+
+		void Renko::serialize(io::SnapshotWriter &writer) const
+		{
+			Base::serialize(writer);
+			writer.write(currentBarIndex);
+			writer.write(bars);
+			writer.write(lastBarAt);
+		}
+
+		void Renko::deserialize(io::SnapshotReader &reader)
+		{
+			Base::deserialize(reader);
+			reader.read(currentBarIndex);
+			reader.read(bars);
+			reader.read(lastBarAt);
+			window.reset();
+		}
 	};
 };
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Base.h"
+#include "TickWindow.h"
 #include <string>
 
 namespace MM
@@ -31,10 +32,16 @@ namespace MM
 
 			int getOffsetIndex(int offset) const;
 
+			virtual void serialize(io::SnapshotWriter &writer) const override;
+			virtual void deserialize(io::SnapshotReader &reader) override;
+
 		private:
 			std::string currencyPair;
+			Stock *stock;
 			int history;
 			double minimumChange;
+			// Only used for the close price.
+			TickWindow window;
 
 			int currentBarIndex;
 			std::vector<double> bars;
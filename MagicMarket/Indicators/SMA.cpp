@@ -2,6 +2,7 @@
 #include "Market.h"
 #include "Stock.h"
 #include "TimePeriod.h"
+#include "IO/Snapshot.h"
 
 namespace MM
 {
@@ -21,6 +22,7 @@ namespace MM
 			seconds(seconds),
 			valueProvider(valueProvider)
 		{
+			stock = currencyPair.empty() ? nullptr : market().getStock(currencyPair, true);
 		}
 
 
@@ -41,7 +43,6 @@ namespace MM
 			double value;
 			if (valueProvider == nullptr)
 			{
-				Stock *stock = market.getStock(currencyPair);
 				if (stock == nullptr) return;
 				MM::TimePeriod now = stock->getTimePeriod(time - seconds, time);
 				const PossibleDecimal price = now.getClose();
@@ -57,5 +58,21 @@ namespace MM
 			sma2    = Math::MA2(sma2, value, history);
 			sma2abs = Math::MA2(sma2abs, std::abs(value), history);
 		}
+
+		void SMA::serialize(io::SnapshotWriter &writer) const
+		{
+			Base::serialize(writer);
+			writer.write(sma);
+			writer.write(sma2);
+			writer.write(sma2abs);
+		}
+
+		void SMA::deserialize(io::SnapshotReader &reader)
+		{
+			Base::deserialize(reader);
+			reader.read(sma);
+			reader.read(sma2);
+			reader.read(sma2abs);
+		}
 	};
 };
\ No newline at end of file
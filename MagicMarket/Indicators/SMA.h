@@ -31,8 +31,13 @@ namespace MM
 			double getSMA2() const { return sma2; }
 			// MA of absolute value, faster falloff
 			double getSMA2Abs() const { return sma2abs; }
+
+			virtual void serialize(io::SnapshotWriter &writer) const override;
+			virtual void deserialize(io::SnapshotReader &reader) override;
+
 		private:
 			std::string currencyPair;
+			Stock *stock;
 			std::function<double()> valueProvider;
 			int history;
 			int seconds;
@@ -4,6 +4,7 @@
 #include "Market.h"
 #include "Stock.h"
 #include "TimePeriod.h"
+#include "IO/Snapshot.h"
 
 namespace MM
 {
@@ -57,5 +58,27 @@ namespace MM
 			assert(tsi <= 101.0);
 			tsi = Math::clamp(tsi, -100.0, 100.0);
 		}
+
+		void TSI::serialize(io::SnapshotWriter &writer) const
+		{
+			Base::serialize(writer);
+			writer.write(tsi);
+			writer.write(momentumDoubleMA);
+			writer.write(momentumDoubleMA_pushed);
+			writer.write(absMomentumDoubleMA);
+			writer.write(absMomentumDoubleMA_pushed);
+			writer.write(lastPushed);
+		}
+
+		void TSI::deserialize(io::SnapshotReader &reader)
+		{
+			Base::deserialize(reader);
+			reader.read(tsi);
+			reader.read(momentumDoubleMA);
+			reader.read(momentumDoubleMA_pushed);
+			reader.read(absMomentumDoubleMA);
+			reader.read(absMomentumDoubleMA_pushed);
+			reader.read(lastPushed);
+		}
 	};
 };
\ No newline at end of file
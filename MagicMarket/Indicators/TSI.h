@@ -30,6 +30,9 @@ namespace MM
 
 			double getTSI() const { return tsi; }
 
+			virtual void serialize(io::SnapshotWriter &writer) const override;
+			virtual void deserialize(io::SnapshotReader &reader) override;
+
 		private:
 			std::string currencyPair;
 			int history;
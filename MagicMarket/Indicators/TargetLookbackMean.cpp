@@ -5,6 +5,7 @@
 #include "Statistics.h"
 
 #include "Helpers.h"
+#include "IO/Snapshot.h"
 
 #include <algorithm>
 
@@ -23,7 +24,7 @@ namespace MM
 			currencyPair(currencyPair),
 			minutesLookback(minutesLookback)
 		{
-			
+			stock = market().getStock(currencyPair, true);
 		}
 
 		TargetLookbackMean::~TargetLookbackMean()
@@ -38,11 +39,15 @@ namespace MM
 		double TargetLookbackMean::calculateTarget(TimePeriod &period)
 		{
 			const std::vector<QuantLib::Decimal> price = period.toVector(ONEMINUTE);
+			return calculateTarget(price.data(), price.size());
+		}
 
+		double TargetLookbackMean::calculateTarget(const QuantLib::Decimal *price, size_t count)
+		{
 			QuantLib::Decimal min = 0.0;
 			QuantLib::Decimal max = 0.0;
 			int lastSign = 0;
-			for (size_t i = 1; i < price.size(); ++i)
+			for (size_t i = 1; i < count; ++i)
 			{
 				QuantLib::Decimal currentChange = price[i] - price[0];
 
@@ -64,7 +69,6 @@ namespace MM
 
 		void TargetLookbackMean::update(const std::time_t &secondsSinceStart, const std::time_t &time)
 		{
-			Stock *stock = market.getStock(currencyPair);
 			if (stock == nullptr) return;
 			TimePeriod period = stock->getTimePeriod(time - 60 * minutesLookback, time);
 
@@ -84,5 +88,21 @@ namespace MM
 				currentMean = onlineMean.preview(target);
 			}
 		}
+
+		void TargetLookbackMean::serialize(io::SnapshotWriter &writer) const
+		{
+			Base::serialize(writer);
+			writer.write(onlineMean);
+			writer.write(currentMean);
+			writer.write(lastPushed);
+		}
+
+		void TargetLookbackMean::deserialize(io::SnapshotReader &reader)
+		{
+			Base::deserialize(reader);
+			reader.read(onlineMean);
+			reader.read(currentMean);
+			reader.read(lastPushed);
+		}
 	};
 };
\ No newline at end of file
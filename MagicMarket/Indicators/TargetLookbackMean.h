@@ -28,9 +28,16 @@ namespace MM
 				return (other->currencyPair == currencyPair) && other->minutesLookback == minutesLookback;
 			}
 			static double TargetLookbackMean::calculateTarget(TimePeriod &period);
+			// Same, for prices that are already sampled once per minute.
+			static double calculateTarget(const QuantLib::Decimal *price, size_t count);
 			double getTargetMean() const { return currentMean; }
+
+			virtual void serialize(io::SnapshotWriter &writer) const override;
+			virtual void deserialize(io::SnapshotReader &reader) override;
+
 		private:
 			std::string currencyPair;
+			Stock *stock;
 			int minutesLookback;
 			::MM::Math::OnlineMean onlineMean;
 			double currentMean;
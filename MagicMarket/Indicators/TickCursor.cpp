@@ -0,0 +1,71 @@
+#include "TickCursor.h"
+
+#include "Stock.h"
+#include "TradingDay.h"
+
+#include <algorithm>
+
+namespace MM
+{
+	namespace Indicators
+	{
+		TickCursor::TickCursor(Stock *stock) : stock(stock)
+		{
+			reset();
+		}
+
+		void TickCursor::reset()
+		{
+			day = nullptr;
+			date = QuantLib::Date();
+			position = 0;
+			lastTime = 0;
+		}
+
+		bool TickCursor::seek(const std::time_t &time, const std::time_t &restartAt, bool &restarted)
+		{
+			restarted = false;
+			if (stock == nullptr) return false;
+
+			TradingDay *current = stock->getTradingDay(dateFromTime(time));
+			if (current == nullptr)
+			{
+				reset();
+				return false;
+			}
+
+			// Trading days are recycled by the virtual market, so the pointer alone does not identify the data.
+			if (current != day || current->getDate() != date || time < lastTime || position > current->getTicks().size())
+			{
+				day = current;
+				date = current->getDate();
+				const TickRange ticks = day->getTicks();
+				auto first = std::lower_bound(ticks.begin(), ticks.end(), restartAt, [](const Tick &tick, const std::time_t &time) { return tick.getTime() < time; });
+				position = static_cast<size_t>(first - ticks.begin());
+				restarted = true;
+			}
+			lastTime = time;
+			return true;
+		}
+
+		const Tick *TickCursor::next(const std::time_t &time)
+		{
+			if (day == nullptr) return nullptr;
+			const TickRange ticks = day->getTicks();
+			if (position >= ticks.size() || ticks[position].getTime() >= time) return nullptr;
+			return &ticks[position++];
+		}
+
+		const Tick *TickCursor::getPrevious() const
+		{
+			if (day == nullptr || position == 0) return nullptr;
+			return &day->getTicks()[position - 1];
+		}
+
+		TickRange TickCursor::getTicks() const
+		{
+			if (day == nullptr) return TickRange(nullptr, nullptr);
+			return day->getTicks();
+		}
+	};
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <ctime>
+#include <vector>
+
+#include <ql/time/date.hpp>
+
+namespace MM
+{
+	class Stock;
+	class Tick;
+	class TickRange;
+	class TradingDay;
+
+	namespace Indicators
+	{
+		/*
+			Walks forward through the ticks of a stock's trading day, so that streaming indicators visit every tick only once.
+			Like TimePeriod, it never spans more than one trading day.
+		*/
+		class TickCursor
+		{
+		public:
+			TickCursor(Stock *stock);
+
+			void reset();
+			// Moves to the trading day of 'time'. Returns false when there is no data for that day.
+			// When the cursor has to start over (another or a recycled day, a jump back in time), it continues at the first tick
+			// at or after 'restartAt' and 'restarted' is set.
+			bool seek(const std::time_t &time, const std::time_t &restartAt, bool &restarted);
+			// The next tick before 'time' that was not visited yet, or nullptr.
+			const Tick *next(const std::time_t &time);
+
+			// The last tick before the cursor, or nullptr.
+			const Tick *getPrevious() const;
+			// Number of ticks of the day before the cursor.
+			size_t getPosition() const { return position; }
+			// All ticks of the current day.
+			TickRange getTicks() const;
+
+		private:
+			Stock *stock;
+			TradingDay *day;
+			QuantLib::Date date;
+			size_t position;
+			std::time_t lastTime;
+		};
+	};
+};
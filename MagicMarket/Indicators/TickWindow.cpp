@@ -0,0 +1,86 @@
+#include "TickWindow.h"
+
+#include "Tick.h"
+#include "TradingDay.h"
+
+#include <cmath>
+#include <limits>
+
+namespace MM
+{
+	namespace Indicators
+	{
+		TickWindow::TickWindow(Stock *stock, std::time_t length) :
+			cursor(stock),
+			length(length)
+		{
+			reset();
+		}
+
+		void TickWindow::reset()
+		{
+			cursor.reset();
+			close = std::numeric_limits<double>::quiet_NaN();
+			maxima.clear();
+			minima.clear();
+		}
+
+		double TickWindow::getHigh() const
+		{
+			if (maxima.empty()) return std::numeric_limits<double>::quiet_NaN();
+			return maxima.front().value;
+		}
+
+		double TickWindow::getLow() const
+		{
+			if (minima.empty()) return std::numeric_limits<double>::quiet_NaN();
+			return minima.front().value;
+		}
+
+		void TickWindow::push(const std::time_t &time, double value)
+		{
+			// Older entries that can never be the extreme again are dropped.
+			while (!maxima.empty() && maxima.back().value <= value) maxima.pop_back();
+			maxima.push_back({ time, value });
+			while (!minima.empty() && minima.back().value >= value) minima.pop_back();
+			minima.push_back({ time, value });
+		}
+
+		void TickWindow::expire(const std::time_t &start)
+		{
+			while (!maxima.empty() && maxima.front().time < start) maxima.pop_front();
+			while (!minima.empty() && minima.front().time < start) minima.pop_front();
+		}
+
+		bool TickWindow::advanceTo(const std::time_t &time)
+		{
+			bool restarted = false;
+			// Everything older than the window would expire right away.
+			if (!cursor.seek(time, time - length, restarted))
+			{
+				reset();
+				return false;
+			}
+
+			if (restarted)
+			{
+				maxima.clear();
+				minima.clear();
+				const Tick *previous = cursor.getPrevious();
+				close = (previous != nullptr) ? previous->getMid() : std::numeric_limits<double>::quiet_NaN();
+			}
+
+			while (const Tick *tick = cursor.next(time))
+			{
+				close = tick->getMid();
+				push(tick->getTime(), close);
+			}
+			expire(time - length);
+
+			// Same requirements as TimePeriod: some data and a tick from before the window.
+			const TickRange ticks = cursor.getTicks();
+			if (ticks.size() < 3 || ticks.front().getTime() >= time - length) return false;
+			return !std::isnan(close);
+		}
+	};
+};
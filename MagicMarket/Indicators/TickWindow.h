@@ -0,0 +1,58 @@
+#pragma once
+
+#include <ctime>
+#include <deque>
+
+#include "TickCursor.h"
+
+namespace MM
+{
+	class Stock;
+
+	namespace Indicators
+	{
+		/*
+			Sliding window over the mid prices of a stock's ticks with the same bounds as stock->getTimePeriod(time - length, time):
+			the window contains the ticks in [time - length, time), the close is the last tick before time.
+			The window only moves forward; every tick is pushed and expired once, and high and low are kept in monotonic deques,
+			so advancing by one second costs O(1) amortized instead of a scan over the whole window.
+			Like TimePeriod, the window never spans more than one trading day. Jumping backwards in time or to another day rebuilds it.
+
+			Indicators that need a channel of the recent prices own one and advance it in their update.
+		*/
+		class TickWindow
+		{
+		public:
+			TickWindow(Stock *stock, std::time_t length);
+
+			void reset();
+			// Moves the window to end at 'time'. Returns false when the close is not available, e.g. because no tick of the day is older than the window.
+			bool advanceTo(const std::time_t &time);
+
+			// NaN when not available.
+			double getClose() const { return close; }
+			double getHigh() const;
+			double getLow() const;
+
+			std::time_t getLength() const { return length; }
+
+		private:
+			struct Entry
+			{
+				std::time_t time;
+				double value;
+			};
+
+			TickCursor cursor;
+			std::time_t length;
+
+			double close;
+			// Decreasing values for the high, increasing values for the low; the front is the extreme of the window.
+			std::deque<Entry> maxima;
+			std::deque<Entry> minima;
+
+			void push(const std::time_t &time, double value);
+			void expire(const std::time_t &start);
+		};
+	};
+};
@@ -1,29 +1,38 @@
 #include "MTInterface.h"
 #include "UDP.h"
 
+#include "EnvironmentVariables.h"
 #include "Market.h"
+#include "SymbolTable.h"
 #include "VirtualMarket.h"
+#include "Statistics.h"
+#include "LatencyMonitor.h"
 #include "Trade.h"
+#include "IO/DatagramCapture.h"
 
+#include <algorithm>
+#include <cctype>
+#include <cstring>
 #include <iostream>
 #include <WinSock2.h>
 #include <SimpleIni.h>
 #include <cassert>
-
-Interface::MetaTrader::MTInterface metatrader;
+#include <system_error>
 
 namespace Interface
 {
 	namespace MetaTrader
 	{
-		MTInterface::MTInterface()
+		MTInterface::MTInterface() : useIngressThread(false), ingressRunning(false),
+			receivedCount(0), droppedCount(0), malformedCount(0), maxQueueDepth(0),
+			symbolLimitReported(false)
 		{
 
 		}
 
 		MTInterface::~MTInterface()
 		{
-
+			stopIngress();
 		}
 
 		void MTInterface::init(void *_ini)
@@ -35,8 +44,27 @@ namespace Interface
 			if (virtualMarketEnabled) return;
 
 			this->port = ini.GetLongValue("Metatrader Interface", "Port", 5005);
+			this->useIngressThread = ini.GetBoolValue("Metatrader Interface", "IngressThread", true);
+
+			const std::string captureFilename = environmentVariables().replace(ini.GetValue("Metatrader Interface", "CaptureFilename", ""));
+			if (!captureFilename.empty())
+			{
+				capture = std::make_unique<::MM::io::DatagramCapture>();
+				if (capture->open(captureFilename))
+					std::cout << "Capturing MetaTrader datagrams to '" << captureFilename << "'." << std::endl;
+				else
+					capture.reset();
+			}
 
 			setup();
+
+			if (useIngressThread)
+			{
+				statistics().addVariable(MM::Variable("ingress_queue_depth", [this]() { return static_cast<double>(ingressQueue->size()); },
+					"Number of datagrams waiting in the MetaTrader ingress queue."));
+				statistics().addVariable(MM::Variable("ingress_dropped", [this]() { return static_cast<double>(droppedCount.load()); },
+					"Total number of datagrams dropped because the ingress queue was full."));
+			}
 		}
 
 		void MTInterface::setup()
@@ -44,102 +72,249 @@ namespace Interface
 			session = std::make_unique<::Interface::Internet::WSASession>();
 			socket = std::make_unique<::Interface::Internet::UDPSocket>();
 			socket->bind(this->port);
+
+			if (useIngressThread)
+			{
+				ingressQueue = std::make_unique<IngressQueue>();
+				ingressRunning = true;
+				ingressThread = std::thread(&MTInterface::runIngress, this);
+			}
 		}
 
-		void MTInterface::checkIncomingMessages()
+		void MTInterface::stopIngress()
 		{
-			do
+			if (!ingressThread.joinable()) return;
+			ingressRunning = false;
+			ingressThread.join();
+		}
+
+		IngressStatistics MTInterface::getIngressStatistics() const
+		{
+			IngressStatistics stats;
+			stats.received = receivedCount.load();
+			stats.dropped = droppedCount.load();
+			stats.malformed = malformedCount.load();
+			stats.queueDepth = ingressQueue ? ingressQueue->size() : 0;
+			stats.maxQueueDepth = maxQueueDepth.load();
+			return stats;
+		}
+
+		bool MTInterface::isWellFormed(const char *data, int length)
+		{
+			if (length < 1) return false;
+			const size_t contentLength = static_cast<size_t>(length) - 1;
+			switch (static_cast<int8_t>(data[0]))
 			{
-				const std::tuple<SOCKADDR_IN*, std::string*> message = this->socket->recv();
-				const std::string &data = *std::get<1>(message);
-				if (data.size() == 0) break;
-				
-				char * const dataPointer = const_cast<char*>((&data[0]));
-				const int8_t &type = *reinterpret_cast<int8_t*>(dataPointer);
-				void * const messageContentsPointer = dataPointer + sizeof(type);
-				assert(data.size() > 8 || (type == MetaTrader::Message::Type::bridgeOrders));
-				switch (type)
+			case MetaTrader::Message::Type::bridgeTick:
+				return contentLength >= sizeof(MetaTrader::Message::Tick);
+			case MetaTrader::Message::Type::bridgeAccountInfo:
+				return contentLength >= sizeof(MetaTrader::Message::AccountInfo);
+			case MetaTrader::Message::Type::bridgeUp:
+				return contentLength >= sizeof(MetaTrader::Message::BridgeUp);
+			case MetaTrader::Message::Type::bridgeDown:
+				return contentLength >= sizeof(MetaTrader::Message::BridgeDown);
+			case MetaTrader::Message::Type::bridgeError:
+				return contentLength >= sizeof(int32_t);
+			case MetaTrader::Message::Type::bridgeOrders:
+				// Any number of orders, followed by one trailing byte (see handleMessage).
+				return contentLength >= 1 && (contentLength - 1) % sizeof(MetaTrader::Message::Order) == 0;
+			default:
+				return false;
+			}
+		}
+
+		void MTInterface::runIngress()
+		{
+			while (ingressRunning)
+			{
+				try
 				{
-				case MetaTrader::Message::Type::bridgeTick:
+					// The timeout only bounds how long shutting down can take.
+					if (!socket->waitForData(100))
 					{
-						MetaTrader::Message::Tick &msg = *reinterpret_cast<MetaTrader::Message::Tick*>(messageContentsPointer);
-						market.onNewTickMessageReceived(msg.pair, msg.bid, msg.ask, msg.timestamp);
+						if (capture) capture->flushIfDue(std::chrono::steady_clock::now());
+						continue;
 					}
-					break;
-				case MetaTrader::Message::Type::bridgeAccountInfo:
-					{
-						MetaTrader::Message::AccountInfo &msg = *reinterpret_cast<MetaTrader::Message::AccountInfo*>(messageContentsPointer);
-						market.account.update(msg.leverage, msg.balance, msg.margin, msg.freeMargin);
 
-						marketExecutioner = std::move(this->socket->getReplyChannel());
-					}
-					break;
-				case MetaTrader::Message::Type::bridgeOrders:
+					// Drain everything that is available now, stamping each datagram as it comes off the socket.
+					while (true)
 					{
-						const size_t oneOrderLength = 7 * sizeof(char) + 2 * sizeof(int32_t) + 3 * sizeof(double) + 2 * sizeof(int32_t) + 2 * sizeof(double);
-						assert(oneOrderLength == 63);
-						const size_t messageLength = data.size() - sizeof(type) - 1;
-						if (messageLength % oneOrderLength != 0)
+						ReceivedDatagram *slot = ingressQueue->beginPush();
+						ReceivedDatagram &datagram = (slot != nullptr) ? *slot : overflowDatagram;
+						datagram.length = ReceivedDatagram::MAX_SIZE;
+						if (!socket->recv(&datagram.sender, datagram.data, datagram.length)) break;
+						datagram.receivedAt = std::chrono::steady_clock::now();
+						++receivedCount;
+						// Before any filtering, so that a replay reproduces the exact traffic.
+						if (capture) capture->record(datagram.receivedAt, datagram.data, static_cast<uint32_t>(datagram.length));
+
+						if (slot == nullptr)
 						{
-							assert(false);
-							break;
+							++droppedCount;
+							continue;
 						}
-						const int numOrders = messageLength / oneOrderLength;
-						MetaTrader::Message::Order *order = reinterpret_cast<MetaTrader::Message::Order*> (messageContentsPointer);
-
-						market.saveAndClearTrades();
-						for (int i = 0; i < numOrders; ++i)
+						if (!isWellFormed(datagram.data, datagram.length))
 						{
-							::MM::Trade *trade = new ::MM::Trade();
-							trade->currencyPair = order->pair;
-							trade->lotSize = order->lots;
-							trade->orderPrice = order->openPrice;
-							trade->setStopLossPrice(order->stopLoss);
-							trade->setTakeProfitPrice(order->takeProfit);
-							trade->ticketID = order->tickedID;
+							++malformedCount;
+							continue;
+						}
+						ingressQueue->commitPush();
+
+						const size_t depth = ingressQueue->size();
+						if (depth > maxQueueDepth.load(std::memory_order_relaxed))
+							maxQueueDepth.store(depth, std::memory_order_relaxed);
+					}
+				}
+				catch (const std::system_error &e)
+				{
+					std::cerr << "MetaTrader ingress: " << e.what() << std::endl;
+				}
+			}
+		}
 
-							if (order->type == 0) trade->type = ::MM::Trade::T_BUY;
-							else trade->type = ::MM::Trade::T_SELL;
+		void MTInterface::checkIncomingMessages()
+		{
+			if (useIngressThread)
+			{
+				while (ReceivedDatagram *datagram = ingressQueue->front())
+				{
+					currentArrivalTime = datagram->receivedAt;
+					handleMessage(datagram->data, datagram->length, datagram->sender);
+					ingressQueue->pop();
+				}
+				return;
+			}
 
-							market.onNewTradeMessageReceived(trade);
+			do
+			{
+				const std::tuple<SOCKADDR_IN*, std::string*> message = this->socket->recv();
+				const std::string &data = *std::get<1>(message);
+				if (data.size() == 0) break;
 
-							order += 1;
-						}
-					}
-					break;
-				case MetaTrader::Message::Type::bridgeUp:
+				currentArrivalTime = std::chrono::steady_clock::now();
+				if (capture) capture->record(currentArrivalTime, &data[0], static_cast<uint32_t>(data.size()));
+				if (!isWellFormed(&data[0], static_cast<int>(data.size())))
+				{
+					++malformedCount;
+					continue;
+				}
+				handleMessage(&data[0], static_cast<int>(data.size()), *std::get<0>(message));
+			} while (true);
+			// Nothing to read right now.
+			if (capture) capture->flushIfDue(std::chrono::steady_clock::now());
+		}
+
+		::MM::SymbolID MTInterface::resolveSymbol(const char *pair, size_t maxLength)
+		{
+			const ::MM::SymbolID known = symbolTable().find(pair, maxLength);
+			if (known != ::MM::INVALID_SYMBOL) return known;
+
+			const size_t length = strnlen(pair, maxLength);
+			if (length == 0 || !std::all_of(pair, pair + length, [](char c) { return std::isalnum(static_cast<unsigned char>(c)) != 0; }))
+				return ::MM::INVALID_SYMBOL;
+			if (symbolTable().size() >= MAX_SYMBOLS)
+			{
+				if (!symbolLimitReported)
+					std::cout << "WARNING: More than " << MAX_SYMBOLS << " currency pairs, ignoring ticks of new ones like " << std::string(pair, length) << "." << std::endl;
+				symbolLimitReported = true;
+				return ::MM::INVALID_SYMBOL;
+			}
+			return symbolTable().intern(pair, maxLength);
+		}
+
+		void MTInterface::handleMessage(const char *data, int length, const struct sockaddr_in &sender)
+		{
+			const int8_t &type = *reinterpret_cast<const int8_t*>(data);
+			const char * const messageContentsPointer = data + sizeof(type);
+			assert(length > 8 || (type == MetaTrader::Message::Type::bridgeOrders));
+			switch (type)
+			{
+			case MetaTrader::Message::Type::bridgeTick:
+				{
+					const MetaTrader::Message::Tick &msg = *reinterpret_cast<const MetaTrader::Message::Tick*>(messageContentsPointer);
+					const ::MM::SymbolID symbol = resolveSymbol(msg.pair, sizeof(msg.pair));
+					if (symbol == ::MM::INVALID_SYMBOL)
 					{
-						MetaTrader::Message::BridgeUp &msg = *reinterpret_cast<MetaTrader::Message::BridgeUp*>(messageContentsPointer);
-						std::cout << "Bridge connected for " << msg.pair << " @ timestamp " << msg.timestamp << std::endl;
+						++malformedCount;
+						break;
 					}
-					break;
-				case MetaTrader::Message::Type::bridgeDown:
+					market().onNewTickMessageReceived(symbol, msg.bid, msg.ask, msg.timestamp, QuantLib::Date::todaysDate());
+				}
+				break;
+			case MetaTrader::Message::Type::bridgeAccountInfo:
+				{
+					const MetaTrader::Message::AccountInfo &msg = *reinterpret_cast<const MetaTrader::Message::AccountInfo*>(messageContentsPointer);
+					market().account.update(msg.leverage, msg.balance, msg.margin, msg.freeMargin);
+
+					marketExecutioner = ::Interface::Internet::UDPSocketReplyChannel(*this->socket, sender);
+				}
+				break;
+			case MetaTrader::Message::Type::bridgeOrders:
+				{
+					const size_t oneOrderLength = 7 * sizeof(char) + 2 * sizeof(int32_t) + 3 * sizeof(double) + 2 * sizeof(int32_t) + 2 * sizeof(double);
+					assert(oneOrderLength == 63);
+					const size_t messageLength = length - sizeof(type) - 1;
+					if (messageLength % oneOrderLength != 0)
 					{
-						MetaTrader::Message::BridgeDown &msg = *reinterpret_cast<MetaTrader::Message::BridgeDown*>(messageContentsPointer);
-						std::cout << "Bridge disconnected for " << msg.pair << " @ timestamp " << msg.timestamp << std::endl;
+						assert(false);
+						break;
 					}
-					break;
-				case MetaTrader::Message::Type::bridgeError:
+					const int numOrders = messageLength / oneOrderLength;
+					const MetaTrader::Message::Order *order = reinterpret_cast<const MetaTrader::Message::Order*> (messageContentsPointer);
+
+					market().beginOpenTradesUpdate();
+					::MM::Trade trade;
+					for (int i = 0; i < numOrders; ++i)
 					{
-						char *message = reinterpret_cast<char*>(messageContentsPointer) + sizeof(int32_t);
-						std::cout << "Bridge error: " << message << std::endl;
-					}
-					break;
-				default:
-					assert(false);
-					break;
-				};
+						trade.currencyPair = order->pair;
+						trade.lotSize = order->lots;
+						trade.orderPrice = order->openPrice;
+						trade.setStopLossPrice(order->stopLoss);
+						trade.setTakeProfitPrice(order->takeProfit);
+						trade.ticketID = order->tickedID;
 
-			} while (true);
+						if (order->type == 0) trade.type = ::MM::Trade::T_BUY;
+						else trade.type = ::MM::Trade::T_SELL;
+
+						market().onOpenTradeReceived(trade);
+
+						order += 1;
+					}
+					market().endOpenTradesUpdate();
+				}
+				break;
+			case MetaTrader::Message::Type::bridgeUp:
+				{
+					const MetaTrader::Message::BridgeUp &msg = *reinterpret_cast<const MetaTrader::Message::BridgeUp*>(messageContentsPointer);
+					std::cout << "Bridge connected for " << msg.pair << " @ timestamp " << msg.timestamp << std::endl;
+				}
+				break;
+			case MetaTrader::Message::Type::bridgeDown:
+				{
+					const MetaTrader::Message::BridgeDown &msg = *reinterpret_cast<const MetaTrader::Message::BridgeDown*>(messageContentsPointer);
+					std::cout << "Bridge disconnected for " << msg.pair << " @ timestamp " << msg.timestamp << std::endl;
+				}
+				break;
+			case MetaTrader::Message::Type::bridgeError:
+				{
+					const char *message = messageContentsPointer + sizeof(int32_t);
+					std::cout << "Bridge error: " << message << std::endl;
+				}
+				break;
+			default:
+				assert(false);
+				break;
+			};
 		}
 
 		template<typename T> void MTInterface::send(const T &data)
 		{
-			if (market.isVirtual())
+			if (market().isVirtual())
 			{
-				if (virtualMarket->isSilent) return;
+				if (virtualMarket()->isSilent) return;
 			}
 			marketExecutioner.send(reinterpret_cast<const char*>(&data), sizeof(data));
+			latencyMonitor.onOrderSent();
 		}
 
 		template void MTInterface::send<Message::NewOrder>(const Message::NewOrder &data);
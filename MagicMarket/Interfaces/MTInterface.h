@@ -1,9 +1,22 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <memory>
 #include <string>
+#include <thread>
 
 #include "Interfaces/UDP.h"
+#include "SPSCRing.h"
+#include "SymbolTable.h"
+
+namespace MM
+{
+	namespace io
+	{
+		class DatagramCapture;
+	};
+};
 
 namespace Interface
 {
@@ -92,6 +105,26 @@ namespace Interface
 			};
 #pragma pack(pop)
 		};
+
+		// A datagram as it was taken off the socket by the ingress thread.
+		struct ReceivedDatagram
+		{
+			static const int MAX_SIZE = 2048;
+
+			std::chrono::steady_clock::time_point receivedAt;
+			struct sockaddr_in sender;
+			int length;
+			char data[MAX_SIZE];
+		};
+
+		struct IngressStatistics
+		{
+			size_t received;
+			size_t dropped;
+			size_t malformed;
+			size_t queueDepth;
+			size_t maxQueueDepth;
+		};
 		
 		class MTInterface
 		{
@@ -103,16 +136,46 @@ namespace Interface
 			void checkIncomingMessages();
 
 			template<typename T> void send(const T &data);
+
+			bool hasIngressThread() const { return ingressThread.joinable(); }
+			IngressStatistics getIngressStatistics() const;
+			// Time at which the message that is currently being dispatched arrived at the socket.
+			std::chrono::steady_clock::time_point getCurrentArrivalTime() const { return currentArrivalTime; }
 		private:
+			typedef ::MM::SPSCRing<ReceivedDatagram, 1024> IngressQueue;
+
 			void setup();
+			void stopIngress();
+			// Runs on the ingress thread: drains the socket into the ingress queue.
+			void runIngress();
+			static bool isWellFormed(const char *data, int length);
+			// Pairs sent by the bridge are only registered while the symbol table is below MAX_SYMBOLS.
+			// Returns INVALID_SYMBOL for pairs that are not plain alphanumeric names or do not fit anymore.
+			static const size_t MAX_SYMBOLS = 256;
+			::MM::SymbolID resolveSymbol(const char *pair, size_t maxLength);
+			void handleMessage(const char *data, int length, const struct sockaddr_in &sender);
 
 			std::unique_ptr<::Interface::Internet::WSASession> session;
 			std::unique_ptr<::Interface::Internet::UDPSocket> socket;
 			int port;
 
 			::Interface::Internet::UDPSocketReplyChannel marketExecutioner;
+
+			bool useIngressThread;
+			std::thread ingressThread;
+			std::atomic<bool> ingressRunning;
+			std::unique_ptr<IngressQueue> ingressQueue;
+			// Used when the queue is full; the datagram still needs to be read off the socket.
+			ReceivedDatagram overflowDatagram;
+			std::atomic<size_t> receivedCount, droppedCount, malformedCount, maxQueueDepth;
+			std::chrono::steady_clock::time_point currentArrivalTime;
+			bool symbolLimitReported;
+
+			// Records all incoming datagrams if a capture file is configured. Only used by the thread that reads the socket.
+			std::unique_ptr<::MM::io::DatagramCapture> capture;
 		};
 	};
 };
 
-extern Interface::MetaTrader::MTInterface metatrader;
+// Of the simulation bound to the calling thread, see SimulationContext.
+Interface::MetaTrader::MTInterface &metatrader();
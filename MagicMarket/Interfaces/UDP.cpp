@@ -93,6 +93,22 @@ namespace Interface
 			return true;
 		}
 
+		bool UDPSocket::waitForData(int timeoutMilliseconds)
+		{
+			fd_set readable;
+			FD_ZERO(&readable);
+			FD_SET(this->socket, &readable);
+
+			timeval timeout;
+			timeout.tv_sec = timeoutMilliseconds / 1000;
+			timeout.tv_usec = (timeoutMilliseconds % 1000) * 1000;
+
+			const int ret = select(static_cast<int>(this->socket) + 1, &readable, nullptr, nullptr, &timeout);
+			if (ret == SOCKET_ERROR)
+				throw std::system_error(WSAGetLastError(), std::system_category(), "select failed");
+			return ret > 0;
+		}
+
 		void UDPSocket::bind(unsigned short port)
 		{
 			sockaddr_in add;
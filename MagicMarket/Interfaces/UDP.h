@@ -34,6 +34,8 @@ namespace Interface
 			void send(sockaddr_in& address, const char* buffer, int len, int flags = 0);
 			std::tuple<struct sockaddr_in*, std::string*> recv();
 			bool recv(struct sockaddr_in *sender, char* buffer, int &len, int flags = 0);
+			// Blocks until a datagram is available or the timeout expires.
+			bool waitForData(int timeoutMilliseconds);
 
 			UDPSocketReplyChannel getReplyChannel();
 		private:
@@ -49,6 +51,7 @@ namespace Interface
 		public:
 			UDPSocketReplyChannel() : socket(nullptr) {}
 			UDPSocketReplyChannel(UDPSocket &source) : socket(&source), sourceAddress(*source.lastSender.get()) {}
+			UDPSocketReplyChannel(UDPSocket &source, const struct sockaddr_in &address) : socket(&source), sourceAddress(address) {}
 			void send(const char* buffer, int len, int flags = 0)
 			{
 				if (this->socket == nullptr) return;
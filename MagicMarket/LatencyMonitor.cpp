@@ -0,0 +1,211 @@
+#include "LatencyMonitor.h"
+
+#include <filesystem>
+namespace filesystem = std::tr2::sys;
+
+#include "EnvironmentVariables.h"
+#include "Market.h"
+#include "ExpertAdvisor.h"
+#include <SimpleIni.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+MM::LatencyMonitor latencyMonitor;
+
+namespace MM
+{
+	LatencyHistogram::LatencyHistogram() : buckets(new std::atomic<uint64_t>[BUCKET_COUNT]), count(0), max(0)
+	{
+		for (size_t i = 0; i < BUCKET_COUNT; ++i)
+			buckets[i] = 0;
+	}
+
+	size_t LatencyHistogram::getBucketIndex(uint64_t value)
+	{
+		if (value < 2 * SUB_BUCKET_COUNT) return static_cast<size_t>(value);
+
+		unsigned long magnitude;
+#ifdef _MSC_VER
+		_BitScanReverse64(&magnitude, value);
+#else
+		magnitude = 63 - __builtin_clzll(value);
+#endif
+		if (magnitude > MAX_MAGNITUDE)
+		{
+			magnitude = MAX_MAGNITUDE;
+			value = (uint64_t(1) << (MAX_MAGNITUDE + 1)) - 1;
+		}
+		const int shift = magnitude - SUB_BUCKET_BITS;
+		return 2 * SUB_BUCKET_COUNT + (shift - 1) * SUB_BUCKET_COUNT + static_cast<size_t>((value >> shift) - SUB_BUCKET_COUNT);
+	}
+
+	int64_t LatencyHistogram::getBucketUpperValue(size_t index)
+	{
+		if (index < 2 * SUB_BUCKET_COUNT) return static_cast<int64_t>(index);
+		const size_t offset = index - 2 * SUB_BUCKET_COUNT;
+		const int shift = static_cast<int>(offset / SUB_BUCKET_COUNT) + 1;
+		const int64_t subBucket = static_cast<int64_t>(offset % SUB_BUCKET_COUNT);
+		return ((SUB_BUCKET_COUNT + subBucket + 1) << shift) - 1;
+	}
+
+	void LatencyHistogram::record(int64_t nanoseconds)
+	{
+		if (nanoseconds < 0) nanoseconds = 0;
+		buckets[getBucketIndex(static_cast<uint64_t>(nanoseconds))].fetch_add(1, std::memory_order_relaxed);
+		count.fetch_add(1, std::memory_order_relaxed);
+
+		int64_t currentMax = max.load(std::memory_order_relaxed);
+		while (nanoseconds > currentMax && !max.compare_exchange_weak(currentMax, nanoseconds, std::memory_order_relaxed));
+	}
+
+	int64_t LatencyHistogram::getPercentile(double quantile) const
+	{
+		const uint64_t total = getCount();
+		if (total == 0) return 0;
+		const uint64_t target = std::max(uint64_t(1), static_cast<uint64_t>(std::ceil(quantile * static_cast<double>(total))));
+
+		uint64_t seen = 0;
+		for (size_t i = 0; i < BUCKET_COUNT; ++i)
+		{
+			seen += buckets[i].load(std::memory_order_relaxed);
+			if (seen >= target)
+				return std::min(getBucketUpperValue(i), getMax());
+		}
+		return getMax();
+	}
+
+	LatencyMonitor::LatencyMonitor() : enabled(false), dumpInterval(60), dumperRunning(false)
+	{
+	}
+
+	LatencyMonitor::~LatencyMonitor()
+	{
+		if (dumper.joinable())
+		{
+			{ // scope
+				std::lock_guard<std::mutex> lock(dumperMutex);
+				dumperRunning = false;
+			}
+			dumperWakeup.notify_all();
+			dumper.join();
+		}
+		if (enabled)
+			dump();
+	}
+
+	void LatencyMonitor::init(void *_ini)
+	{
+		const CSimpleIniA &ini = *(CSimpleIniA*)_ini;
+		enabled = ini.GetBoolValue("Latency Monitor", "Enabled", false);
+		if (!enabled) return;
+
+		outputFilename = environmentVariables().replace(ini.GetValue("Latency Monitor", "OutputFilename", "saves/latency.txt"));
+		dumpInterval = std::chrono::seconds(ini.GetLongValue("Latency Monitor", "DumpInterval", 60));
+
+		// The set of experts is fixed from here on, so the dumper thread can read the per-expert histograms without locking.
+		for (const ExpertAdvisor *expert : market().getExperts())
+			expertNames.push_back(expert->getName());
+		expertTick.reset(new LatencyHistogram[expertNames.size()]);
+		expertExecute.reset(new LatencyHistogram[expertNames.size()]);
+
+		const filesystem::path outputPath = filesystem::path(outputFilename).parent_path();
+		if (!outputPath.empty())
+			filesystem::create_directories(outputPath);
+
+		if (dumpInterval.count() > 0)
+		{
+			dumperRunning = true;
+			dumper = std::thread(&LatencyMonitor::runDumper, this);
+		}
+	}
+
+	void LatencyMonitor::recordExpertTick(size_t expertIndex, Clock::duration duration)
+	{
+		if (expertIndex < expertNames.size())
+			expertTick[expertIndex].record(toNanoseconds(duration));
+	}
+
+	void LatencyMonitor::recordExpertExecute(size_t expertIndex, Clock::duration duration)
+	{
+		if (expertIndex < expertNames.size())
+			expertExecute[expertIndex].record(toNanoseconds(duration));
+	}
+
+	void LatencyMonitor::onTickDispatched(Clock::time_point receivedAt, Clock::time_point dispatchedAt)
+	{
+		if (receivedAt == Clock::time_point())
+		{
+			lastTickReceivedAt = dispatchedAt;
+			return;
+		}
+		lastTickReceivedAt = receivedAt;
+		record(RECEIVE_TO_DISPATCH, dispatchedAt - receivedAt);
+	}
+
+	void LatencyMonitor::onOrderSent()
+	{
+		if (!enabled || lastTickReceivedAt == Clock::time_point()) return;
+		record(TICK_TO_ORDER, Clock::now() - lastTickReceivedAt);
+	}
+
+	std::string LatencyMonitor::getReport() const
+	{
+		static const char * const stageNames[STAGE_COUNT] = { "receive_to_dispatch", "dispatch", "indicators", "experts", "tick_to_order" };
+
+		std::ostringstream os;
+		os << std::fixed << std::setprecision(1);
+		os << "stage\tcount\tp50_us\tp99_us\tp999_us\tmax_us" << std::endl;
+
+		auto printRow = [&](const std::string &name, const LatencyHistogram &histogram)
+		{
+			os << name << "\t" << histogram.getCount()
+				<< "\t" << (histogram.getPercentile(0.5) / 1000.0)
+				<< "\t" << (histogram.getPercentile(0.99) / 1000.0)
+				<< "\t" << (histogram.getPercentile(0.999) / 1000.0)
+				<< "\t" << (histogram.getMax() / 1000.0) << std::endl;
+		};
+
+		for (int stage = 0; stage < STAGE_COUNT; ++stage)
+			printRow(stageNames[stage], stages[stage]);
+		for (size_t i = 0; i < expertNames.size(); ++i)
+		{
+			printRow("tick:" + expertNames[i], expertTick[i]);
+			printRow("execute:" + expertNames[i], expertExecute[i]);
+		}
+		return os.str();
+	}
+
+	void LatencyMonitor::dump() const
+	{
+		const std::string report = getReport();
+		// Write to a temporary file first so that readers never see a half-written report.
+		const std::string temporaryFilename = outputFilename + ".tmp";
+		{ // scope
+			std::ofstream outputStream(temporaryFilename, std::ios_base::out | std::ios_base::trunc);
+			if (!outputStream.good()) return;
+			outputStream << report;
+		}
+		std::remove(outputFilename.c_str());
+		std::rename(temporaryFilename.c_str(), outputFilename.c_str());
+	}
+
+	void LatencyMonitor::runDumper()
+	{
+		std::unique_lock<std::mutex> lock(dumperMutex);
+		while (dumperRunning)
+		{
+			if (dumperWakeup.wait_for(lock, dumpInterval, [this] { return !dumperRunning; }))
+				break;
+			dump();
+		}
+	}
+};
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+namespace MM
+{
+	/*
+		Log-linear histogram in the spirit of HdrHistogram.
+		Values are nanoseconds; every power of two is split into 32 sub-buckets which bounds the relative error to ~3%.
+		Recording is a single relaxed atomic increment so that the histogram can be read from another thread at any time.
+	*/
+	class LatencyHistogram
+	{
+	public:
+		LatencyHistogram();
+
+		void record(int64_t nanoseconds);
+
+		uint64_t getCount() const { return count.load(std::memory_order_relaxed); }
+		int64_t getMax() const { return max.load(std::memory_order_relaxed); }
+		// Upper bound of the bucket that contains the given quantile (0 < quantile <= 1).
+		int64_t getPercentile(double quantile) const;
+
+	private:
+		static const int SUB_BUCKET_BITS = 5;
+		static const int SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+		// Values above 2^41 ns (~36 minutes) are clamped.
+		static const int MAX_MAGNITUDE = 40;
+		static const size_t BUCKET_COUNT = 2 * SUB_BUCKET_COUNT + (MAX_MAGNITUDE - SUB_BUCKET_BITS) * SUB_BUCKET_COUNT;
+
+		static size_t getBucketIndex(uint64_t value);
+		static int64_t getBucketUpperValue(size_t index);
+
+		std::unique_ptr<std::atomic<uint64_t>[]> buckets;
+		std::atomic<uint64_t> count;
+		std::atomic<int64_t> max;
+	};
+
+	/*
+		Tracks where time goes between a tick arriving at the MetaTrader socket and an order leaving it.
+		All recording happens on the market thread; a background thread periodically writes the report to a file.
+	*/
+	class LatencyMonitor
+	{
+	public:
+		typedef std::chrono::steady_clock Clock;
+
+		enum Stage
+		{
+			// Datagram received -> event handed to the experts.
+			RECEIVE_TO_DISPATCH,
+			// All experts' onNewTick for one event.
+			DISPATCH,
+			// All indicators' execute.
+			INDICATORS,
+			// All experts' execute.
+			EXPERTS,
+			// Tick received -> order sent to MetaTrader.
+			TICK_TO_ORDER,
+			STAGE_COUNT
+		};
+
+		LatencyMonitor();
+		~LatencyMonitor();
+
+		// Needs to be called after the market has created its experts.
+		void init(void *ini);
+		bool isEnabled() const { return enabled; }
+
+		void record(Stage stage, Clock::duration duration) { stages[stage].record(toNanoseconds(duration)); }
+		void recordExpertTick(size_t expertIndex, Clock::duration duration);
+		void recordExpertExecute(size_t expertIndex, Clock::duration duration);
+		// receivedAt may be a default constructed time point if the arrival time is not known (e.g. in the virtual market).
+		void onTickDispatched(Clock::time_point receivedAt, Clock::time_point dispatchedAt);
+		void onOrderSent();
+
+		// Human readable summary of all histograms. Safe to call from any thread.
+		std::string getReport() const;
+		// Writes the report to the configured file.
+		void dump() const;
+
+	private:
+		static int64_t toNanoseconds(Clock::duration duration) { return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(); }
+		void runDumper();
+
+		bool enabled;
+		std::string outputFilename;
+		std::chrono::seconds dumpInterval;
+
+		LatencyHistogram stages[STAGE_COUNT];
+		std::vector<std::string> expertNames;
+		std::unique_ptr<LatencyHistogram[]> expertTick;
+		std::unique_ptr<LatencyHistogram[]> expertExecute;
+
+		// Arrival time of the newest tick that has been dispatched; the reference point for TICK_TO_ORDER.
+		Clock::time_point lastTickReceivedAt;
+
+		std::thread dumper;
+		std::mutex dumperMutex;
+		std::condition_variable dumperWakeup;
+		bool dumperRunning;
+	};
+};
+
+extern MM::LatencyMonitor latencyMonitor;
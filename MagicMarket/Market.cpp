@@ -1,5 +1,6 @@
 #include "Market.h"
 
+#include <algorithm>
 #include <sstream>
 #include <iostream>
 #include <ctime>
@@ -11,9 +12,14 @@ namespace filesystem = std::tr2::sys;
 
 #include <SimpleIni.h>
 
+#include "EnvironmentVariables.h"
 #include "Interfaces/MTInterface.h"
 #include "VirtualMarket.h"
 #include "Statistics.h"
+#include "LatencyMonitor.h"
+#include "VM/Profiler.h"
+#include "IO/Snapshot.h"
+#include "IO/TradeJournal.h"
 
 #include "Stock.h"
 #include "Trade.h"
@@ -42,14 +48,13 @@ namespace filesystem = std::tr2::sys;
 
 #include "DeepLearningTest.h"
 
-MM::Market market;
-
 namespace MM
 {
 
 	Market::Market()
 	{
 		isVirtualModeEnabled = false;
+		areExternalAgentsEnabled = true;
 		lastTickTime = 0;
 		lastTickDate = QuantLib::Date();
 	}
@@ -57,9 +62,10 @@ namespace MM
 
 	Market::~Market()
 	{
-		for (Indicators::Base *&indicator : indicators)
+		// Indicators can depend on indicators that were created before them (e.g. on a shared batch), so they go first.
+		for (auto indicator = indicators.rbegin(); indicator != indicators.rend(); ++indicator)
 		{
-			delete indicator;
+			delete *indicator;
 		}
 		indicators.clear();
 
@@ -68,6 +74,11 @@ namespace MM
 			delete expert;
 		}
 		experts.clear();
+
+		for (Trade *trade : trades)
+			delete trade;
+		for (Trade *trade : tradePool)
+			delete trade;
 	}
 
 	void Market::addEvent(const Event &e)
@@ -94,14 +105,25 @@ namespace MM
 		sleepDuration = std::chrono::milliseconds(sleepDurationMs);
 		std::cout << "..loaded config" << std::endl;
 
-		tradingConfiguration.initialStopLoss = ini.GetDoubleValue("Market", "InitialStopLoss", 0.0);
+		// Values set by a parameter sweep take precedence.
+		{ // scope
+			CSimpleIniA::TNamesDepend keys;
+			ini.GetAllKeys("Parameters", keys);
+			for (const CSimpleIniA::Entry &key : keys)
+				parameters.emplace(key.pItem, ini.GetDoubleValue("Parameters", key.pItem, 0.0));
+		}
+
+		tradingConfiguration.initialStopLoss = getParameter("Market.InitialStopLoss", ini.GetDoubleValue("Market", "InitialStopLoss", 0.0));
+		saveFolderName = environmentVariables().replace(ini.GetValue("Market", "DataFolder", "saves"));
+		tradesFolderName = environmentVariables().replace(ini.GetValue("Market", "TradesFolder", "saves/trades"));
+		tradeJournalCompaction = static_cast<size_t>(std::max(0L, ini.GetLongValue("Market", "TradeJournalCompaction", static_cast<long>(tradeJournalCompaction))));
 
 		experts.push_back(static_cast<ExpertAdvisor*>(new ExpertAdvisorRSI()));
 		experts.push_back(static_cast<ExpertAdvisor*>(new ExpertAdvisorCCI()));
 		experts.push_back(static_cast<ExpertAdvisor*>(new ExpertAdvisorTSI()));
 		experts.push_back(static_cast<ExpertAdvisor*>(new ExpertAdvisorStochasticOscillator()));
-		experts.push_back(static_cast<ExpertAdvisor*>(new ExpertAdvisorRenko(5.0)));
-		experts.push_back(static_cast<ExpertAdvisor*>(new ExpertAdvisorRenko(20.0)));
+		experts.push_back(static_cast<ExpertAdvisor*>(new ExpertAdvisorRenko(getParameter("Renko.FastSensitivity", 5.0))));
+		experts.push_back(static_cast<ExpertAdvisor*>(new ExpertAdvisorRenko(getParameter("Renko.SlowSensitivity", 20.0))));
 		experts.push_back(static_cast<ExpertAdvisor*>(new ExpertAdvisorDumbo()));
 		experts.push_back(static_cast<ExpertAdvisor*>(new ExpertAdvisorMultiCurrency()));
 		//experts.push_back(static_cast<ExpertAdvisor*>(new ExpertAdvisorMAAnalyser()));
@@ -140,6 +162,11 @@ namespace MM
 			const std::string configName = std::string("External Agent ") + std::to_string(i + 1);
 			std::string endpoint = ini.GetValue(configName.c_str(), "Endpoint", "");
 			if (endpoint.empty()) break;
+			if (!areExternalAgentsEnabled)
+			{
+				std::cout << "WARNING: External agents are not supported in this mode; '" << configName << "' is ignored." << std::endl;
+				continue;
+			}
 
 			auto externalAgent = new ExpertAdvisorExternal();
 			bool connected = externalAgent->connect(endpoint);
@@ -257,6 +284,7 @@ namespace MM
 		{
 			expert->declareExports();
 		}
+		statistics().compile();
 		for (ExpertAdvisor * const & expert : experts)
 		{
 			expert->afterExportsDeclared();
@@ -273,18 +301,108 @@ namespace MM
 			expertInformation << expert->getName() << (expert == experts.back()) ? "" : ", ";
 	}
 
-	void Market::run()
+	double Market::getParameter(const std::string &name, double defaultValue) const
+	{
+		const auto iter = parameters.find(name);
+		if (iter == parameters.end()) return defaultValue;
+		return iter->second;
+	}
+
+	namespace
+	{
+		// Sections are keyed by name and the number of earlier components with the same name,
+		// so that adding or removing a component does not shift the keys of the others.
+		template<typename T> std::vector<std::string> getSnapshotSectionNames(const std::string &kind, const std::vector<T*> &components, std::string (T::*getName)() const)
+		{
+			std::vector<std::string> names;
+			std::map<std::string, int> occurrences;
+			for (const T *component : components)
+			{
+				const std::string name = (component->*getName)();
+				std::ostringstream os;
+				os << kind << ":" << name << ":" << occurrences[name]++;
+				names.push_back(os.str());
+			}
+			return names;
+		}
+	};
+
+	void Market::serialize(io::SnapshotWriter &writer) const
 	{
-		// for the experts' execute() callback
-		std::time_t startTime = (0), lastExecutionTime(0);
+		writer.write(lastTickTime);
+		writer.write(static_cast<int64_t>(lastTickDate.serialNumber()));
+		writer.write(executionClock);
+		writer.write(account.leverage);
+		writer.write(account.balance);
+		writer.write(account.margin);
+		writer.write(account.marginFree);
+
+		// All indicators share their getName(), so they are told apart by type.
+		const std::vector<std::string> indicatorSections = getSnapshotSectionNames("indicator", indicators, &Indicators::Base::getTypeName);
+		for (size_t i = 0; i < indicators.size(); ++i)
+		{
+			writer.beginSection(indicatorSections[i]);
+			indicators[i]->serialize(writer);
+			writer.endSection();
+		}
+		const std::vector<std::string> expertSections = getSnapshotSectionNames("expert", experts, &ExpertAdvisor::getName);
+		for (size_t i = 0; i < experts.size(); ++i)
+		{
+			writer.beginSection(expertSections[i]);
+			experts[i]->serialize(writer);
+			writer.endSection();
+		}
+	}
+
+	void Market::deserialize(io::SnapshotReader &reader)
+	{
+		reader.read(lastTickTime);
+		const int64_t lastTickDateSerial = reader.read<int64_t>();
+		lastTickDate = (lastTickDateSerial != 0) ? QuantLib::Date(static_cast<QuantLib::BigInteger>(lastTickDateSerial)) : QuantLib::Date();
+		reader.read(executionClock);
+		reader.read(account.leverage);
+		reader.read(account.balance);
+		reader.read(account.margin);
+		reader.read(account.marginFree);
+
+		// Sections are matched by name, so changed setups only lose the state of the changed parts.
+		std::map<std::string, ExpertAdvisor*> sections;
+		const std::vector<std::string> indicatorSections = getSnapshotSectionNames("indicator", indicators, &Indicators::Base::getTypeName);
+		for (size_t i = 0; i < indicators.size(); ++i)
+			sections[indicatorSections[i]] = indicators[i];
+		const std::vector<std::string> expertSections = getSnapshotSectionNames("expert", experts, &ExpertAdvisor::getName);
+		for (size_t i = 0; i < experts.size(); ++i)
+			sections[expertSections[i]] = experts[i];
+
+		std::string name;
+		io::SnapshotReader contents;
+		while (reader.nextSection(name, contents))
+		{
+			auto found = sections.find(name);
+			if (found == sections.end())
+			{
+				std::cout << "WARNING: Checkpoint contains unknown state '" << name << "', ignored." << std::endl;
+				continue;
+			}
+			found->second->deserialize(contents);
+			if (!contents.good())
+				std::cout << "WARNING: Incomplete checkpoint state of '" << name << "'." << std::endl;
+			sections.erase(found);
+		}
+
+		for (const auto &missing : sections)
+			std::cout << "WARNING: No checkpoint state for '" << missing.first << "', starting fresh." << std::endl;
+	}
 
+	void Market::run()
+	{
 		// for debugging & testing
 		bool onlyOnce = false;
-		
+
 		while (true)
 		{
 			if (!isVirtual())
-				metatrader.checkIncomingMessages();
+				metatrader().checkIncomingMessages();
 			
 			if (!onlyOnce)
 			{
@@ -297,75 +415,25 @@ namespace MM
 				*/
 			}
 
-			// if new things happened, notify the experts
-			for (Event &event : events)
-			{
-				lastTickTime = std::max(lastTickTime, event.time);
-				/*
-					Quickly reset experts when event for new day occurs.
-					This is mainly important for the virtual market but it should be done here;
-					this decreases the divergence between the virtual market execution and the real one.
-					Additionally it increases the probability of finding reset-related bugs early on.
-				*/
-				const QuantLib::Date &date = event.date;
-				if (date != lastTickDate)
-				{
-					lastTickDate = date;
-
-					for (ExpertAdvisor *&expert : experts)
-						expert->onNewDay();
-					for (Indicators::Base *&indicator : indicators)
-						indicator->onNewDay();
-				}
-
-				switch (event.type)
-				{
-				case Event::Type::NEW_TICK:
-					for (ExpertAdvisor *&expert : experts)
-					{
-						expert->onNewTick(event.currencyPair, event.date, event.time);
-					}
-
-					break;
-				case Event::Type::TIMER:
-					break;
-				default:
-					assert(false);
-					break;
-				}
-			}
-			events.clear();
-
-			// allow all experts to execute if they want to
-			if (startTime == 0) startTime = lastTickTime;
-			std::time_t timePassed = lastTickTime - startTime;
-			if ((timePassed != lastExecutionTime) && (lastTickTime != 0))
-			{
-				lastExecutionTime = timePassed;
+			step();
 
-				// update indicators first
-				for (Indicators::Base *&indicator : indicators)
-				{
-					indicator->execute(timePassed, lastTickTime);
-				}
-
-				for (ExpertAdvisor *&expert : experts)
-				{
-					expert->execute(timePassed, lastTickTime);
-				}
-
-				statistics.log();
-			}
 			if (isVirtual())
 			{
-				virtualMarket->execute();
-				if (!virtualMarket->isRunning()) return;
+				virtualMarket()->execute();
+				if (!virtualMarket()->isRunning()) return;
 			}
 			else
 			{
 				if (trades.empty())
 				{
-					std::cout << "\rNo open positions." << std::flush;
+					std::cout << "\rNo open positions.";
+					if (metatrader().hasIngressThread())
+					{
+						const Interface::MetaTrader::IngressStatistics ingress = metatrader().getIngressStatistics();
+						std::cout << "\tQUEUE: " << ingress.queueDepth << " (max " << ingress.maxQueueDepth << ")"
+							<< "\tDROPPED: " << ingress.dropped;
+					}
+					std::cout << std::flush;
 				}
 				else
 				{
@@ -376,7 +444,7 @@ namespace MM
 					const int numberOfTrades = trades.size();
 					for (Trade * trade : trades)
 					{
-						Stock *stock = market.getStock(trade->currencyPair);
+						Stock *stock = market().getStock(trade->currencyPair);
 						TimePeriod period = stock->getTimePeriod(lastTickTime);
 						const Tick *lastTick = period.getLastTick();
 						const QuantLib::Decimal currentProfit = (lastTick != nullptr) ? trade->getProfitAtTick(*lastTick) : std::numeric_limits<double>::quiet_NaN();
@@ -395,6 +463,141 @@ namespace MM
 		}
 	}
 
+	void Market::step()
+	{
+		const bool measureLatency = latencyMonitor.isEnabled();
+		updateProfilerZones();
+
+		// if new things happened, notify the experts
+		for (Event &event : events)
+		{
+			lastTickTime = std::max(lastTickTime, event.time);
+			/*
+				Quickly reset experts when event for new day occurs.
+				This is mainly important for the virtual market but it should be done here;
+				this decreases the divergence between the virtual market execution and the real one.
+				Additionally it increases the probability of finding reset-related bugs early on.
+			*/
+			const QuantLib::Date &date = event.date;
+			if (date != lastTickDate)
+			{
+				lastTickDate = date;
+
+				for (ExpertAdvisor *&expert : experts)
+					expert->onNewDay();
+				for (Indicators::Base *&indicator : indicators)
+					indicator->onNewDay();
+			}
+
+			switch (event.type)
+			{
+			case Event::Type::NEW_TICK:
+				{
+					LatencyMonitor::Clock::time_point dispatchedAt, lastCheckpoint;
+					if (measureLatency)
+					{
+						dispatchedAt = lastCheckpoint = LatencyMonitor::Clock::now();
+						latencyMonitor.onTickDispatched(event.receivedAt, dispatchedAt);
+					}
+
+					const std::string &currencyPair = symbolTable().getName(event.symbol);
+					for (size_t i = 0; i < experts.size(); ++i)
+					{
+						{ // scope
+							vm::ProfilerZone zone(profilerZones.expertTick[i]);
+							experts[i]->onNewTick(currencyPair, event.date, event.time);
+						}
+						if (measureLatency)
+						{
+							const LatencyMonitor::Clock::time_point now = LatencyMonitor::Clock::now();
+							latencyMonitor.recordExpertTick(i, now - lastCheckpoint);
+							lastCheckpoint = now;
+						}
+					}
+
+					if (measureLatency)
+						latencyMonitor.record(LatencyMonitor::DISPATCH, lastCheckpoint - dispatchedAt);
+				}
+				break;
+			case Event::Type::TIMER:
+				break;
+			default:
+				assert(false);
+				break;
+			}
+		}
+		events.clear();
+
+		// allow all experts to execute if they want to
+		if (executionClock.startTime == 0) executionClock.startTime = lastTickTime;
+		std::time_t timePassed = lastTickTime - executionClock.startTime;
+		if ((timePassed != executionClock.lastExecutionTime) && (lastTickTime != 0))
+		{
+			executionClock.lastExecutionTime = timePassed;
+			updateProfilerZones();
+			const LatencyMonitor::Clock::time_point executionStart = measureLatency ? LatencyMonitor::Clock::now() : LatencyMonitor::Clock::time_point();
+
+			// update indicators first
+			for (size_t i = 0; i < indicators.size(); ++i)
+			{
+				vm::ProfilerZone zone(profilerZones.indicatorUpdate[i]);
+				indicators[i]->execute(timePassed, lastTickTime);
+			}
+
+			LatencyMonitor::Clock::time_point indicatorsDone, lastCheckpoint;
+			if (measureLatency)
+			{
+				indicatorsDone = lastCheckpoint = LatencyMonitor::Clock::now();
+				latencyMonitor.record(LatencyMonitor::INDICATORS, indicatorsDone - executionStart);
+			}
+
+			for (size_t i = 0; i < experts.size(); ++i)
+			{
+				{ // scope
+					vm::ProfilerZone zone(profilerZones.expertExecute[i]);
+					experts[i]->execute(timePassed, lastTickTime);
+				}
+				if (measureLatency)
+				{
+					const LatencyMonitor::Clock::time_point now = LatencyMonitor::Clock::now();
+					latencyMonitor.recordExpertExecute(i, now - lastCheckpoint);
+					lastCheckpoint = now;
+				}
+			}
+
+			if (measureLatency)
+				latencyMonitor.record(LatencyMonitor::EXPERTS, lastCheckpoint - indicatorsDone);
+
+			// The indicators and experts changed their exports; experts read single values through Statistics::getValue.
+			statistics().invalidateSnapshot();
+			statistics().log();
+		}
+	}
+
+	void Market::updateProfilerZones()
+	{
+		// Registering does not require an active profiler; the IDs stay valid for the whole run.
+		while (profilerZones.expertTick.size() < experts.size())
+		{
+			const std::string name = experts[profilerZones.expertTick.size()]->getName();
+			profilerZones.expertTick.push_back(vm::Profiler::registerZone(name + "::onNewTick"));
+			profilerZones.expertExecute.push_back(vm::Profiler::registerZone(name + "::execute"));
+		}
+		while (profilerZones.indicatorUpdate.size() < indicators.size())
+		{
+			// All indicators share their getName(), so the zones are named by type; repeated types are numbered.
+			const size_t index = profilerZones.indicatorUpdate.size();
+			std::string name = indicators[index]->getTypeName();
+			size_t occurrence = 0;
+			for (size_t i = 0; i < index; ++i)
+			{
+				if (indicators[i]->getTypeName() == name) ++occurrence;
+			}
+			if (occurrence > 0) name += "[" + std::to_string(occurrence) + "]";
+			profilerZones.indicatorUpdate.push_back(vm::Profiler::registerZone(name + "::update"));
+		}
+	}
+
 	Trade *Market::newTrade(Trade trade)
 	{
 		Trade *accepted = new Trade(trade);
@@ -425,8 +628,8 @@ namespace MM
 		message.stopLossPrice = accepted->getStopLossPrice();
 		message.lotSize = accepted->lotSize;
 		
-		if (market.isVirtual()) virtualMarket->onReceive(message);
-		else metatrader.send(message);
+		if (market().isVirtual()) virtualMarket()->onReceive(message, accepted->currencyPair);
+		else metatrader().send(message);
 
 		assert(trades.size() < 10);
 		return nullptr;
@@ -442,8 +645,8 @@ namespace MM
 		message.takeProfitPrice = trade->getTakeProfitPrice();
 		message.stopLossPrice = trade->getStopLossPrice();
 		
-		if (market.isVirtual()) virtualMarket->onReceive(message);
-		else metatrader.send(message);
+		if (market().isVirtual()) virtualMarket()->onReceive(message);
+		else metatrader().send(message);
 	}
 
 	void Market::closeTrade(Trade *trade)
@@ -454,8 +657,8 @@ namespace MM
 
 		message.ticketID = trade->ticketID;
 
-		if (market.isVirtual()) virtualMarket->onReceive(message);
-		else metatrader.send(message);
+		if (market().isVirtual()) virtualMarket()->onReceive(message);
+		else metatrader().send(message);
 	}
 
 	void Market::chat(std::string name, std::string msg)
@@ -467,49 +670,113 @@ namespace MM
 		// send(os.str());
 	}
 
-	void Market::onNewTickMessageReceived(const std::string &pair, QuantLib::Decimal bid, QuantLib::Decimal ask, std::time_t time)
+	void Market::onNewTickMessageReceived(SymbolID symbol, QuantLib::Decimal bid, QuantLib::Decimal ask, std::time_t time, const QuantLib::Date &date)
 	{
 		Tick tick;
 		tick.bid = bid;
 		tick.ask = ask;
 		tick.time = time;
 
-		getStock(pair, true)->receiveFreshTick(tick);
+		Stock *stock = getStock(symbol);
+		if (stock == nullptr)
+			stock = getStock(symbolTable().getName(symbol), true);
+		stock->receiveFreshTick(tick);
 		// notify the experts asap
-		addEvent(Event(Event::Type::NEW_TICK, pair, QuantLib::Date::todaysDate(), tick.time));
+		Event event(Event::Type::NEW_TICK, symbol, date, tick.time);
+		if (!isVirtual())
+			event.receivedAt = metatrader().getCurrentArrivalTime();
+		addEvent(event);
 	}
 
-	void Market::onNewTradeMessageReceived(Trade *trade)
+	io::TradeJournal *Market::getTradeJournal()
 	{
-		trade->load();
-		trades.push_back(trade);
+		if (isVirtual()) return nullptr;
+		if (!tradeJournal)
+		{
+			filesystem::create_directories(filesystem::path(tradesFolderName));
+			tradeJournal = std::make_unique<io::TradeJournal>();
+			if (!tradeJournal->open(tradesFolderName + "/trades.journal", tradeJournalCompaction))
+				std::cout << "WARNING: Could not open the trade journal in '" << tradesFolderName << "'." << std::endl;
+		}
+		return tradeJournal->isOpen() ? tradeJournal.get() : nullptr;
 	}
 
 	// When updating the trades either trough the virtual market or by a new comprehensive update orders message.
-	void Market::saveAndClearTrades()
+	void Market::beginOpenTradesUpdate()
 	{
-		// remove all (non virtual) trades
+		assert(updatedTrades.empty());
+		for (Trade *trade : trades)
+			trade->save();
+	}
+
+	void Market::onOpenTradeReceived(const Trade &state)
+	{
+		Trade *trade = nullptr;
+		// Only a handful of trades is open at a time.
 		for (size_t i = 0; i < trades.size(); ++i)
 		{
-			Trade *& trade = trades[i];
-			// if (trade.isVirtual()) continue;
-			trade->save();
-			delete trade;
-			trades[i] = nullptr;
+			if (trades[i]->ticketID != state.ticketID) continue;
+			trade = trades[i];
+			trades[i] = trades.back();
+			trades.pop_back();
+			break;
 		}
-		trades.erase(std::remove(std::begin(trades), std::end(trades), nullptr), std::end(trades));
-		assert(trades.size() == 0); // for now
+		if (trade == nullptr)
+		{
+			if (!tradePool.empty())
+			{
+				trade = tradePool.back();
+				tradePool.pop_back();
+			}
+			else
+				trade = new Trade();
+		}
+
+		trade->updateFromBroker(state);
+		updatedTrades.push_back(trade);
+
+		io::TradeJournal *journal = getTradeJournal();
+		if (journal != nullptr)
+			journal->recordOpen(trade->ticketID, lastTickTime, trade->getStopLossPrice(), trade->getTakeProfitPrice());
+	}
+
+	void Market::endOpenTradesUpdate()
+	{
+		// The remaining trades have been closed.
+		io::TradeJournal *journal = getTradeJournal();
+		for (Trade *trade : trades)
+		{
+			if (journal != nullptr)
+				journal->recordClose(trade->ticketID, lastTickTime);
+			tradePool.push_back(trade);
+		}
+
+		// Trades that were closed while the market was not running are still open in the journal.
+		if (journal != nullptr && !tradeJournalReconciled)
+		{
+			tradeJournalReconciled = true;
+			for (const int32_t ticketID : journal->getOpenTickets())
+			{
+				auto isOpen = [ticketID](const Trade *trade) { return trade->ticketID == ticketID; };
+				if (std::none_of(updatedTrades.begin(), updatedTrades.end(), isOpen))
+					journal->recordClose(ticketID, lastTickTime);
+			}
+		}
+
+		trades.clear();
+		trades.swap(updatedTrades);
 	}
 
 	void Market::addStock(std::string pair)
 	{
-		if (stocks.count(pair)) return;
-		stocks[pair] = new Stock(pair);
+		getStock(pair, true);
 	}
 
-	Stock* Market::getStock(std::string pair, bool allowCreation)
+	Stock* Market::getStock(const std::string &pair, bool allowCreation)
 	{
-		if (stocks.count(pair)) return stocks[pair];
+		// Known pairs never allocate or touch the file system.
+		Stock *existing = getStock(symbolTable().find(pair));
+		if (existing != nullptr) return existing;
 
 		std::string pathString = Stock::getDirectoryName(pair);
 		filesystem::path path(pathString);
@@ -518,7 +785,10 @@ namespace MM
 
 		// create it, it will load its stuff lazily
 		Stock *stock = new Stock(pair);
-		stocks[pair] = stock;
+		const SymbolID symbol = stock->getSymbol();
+		if (static_cast<size_t>(symbol) >= stocks.size())
+			stocks.resize(symbol + 1, nullptr);
+		stocks[symbol] = stock;
 		return stock;
 	}
 
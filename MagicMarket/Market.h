@@ -5,6 +5,7 @@
 #include <string>
 #include <map>
 #include <list>
+#include <memory>
 #include <assert.h>
 #include <WinSock2.h>
 #include <zmq.h>
@@ -13,7 +14,9 @@
 
 #include "Account.h"
 #include "Event.h"
+#include "SymbolTable.h"
 #include "Indicators/Base.h"
+#include "VM/Profiler.h"
 
 class zmq_msg_buf
 {
@@ -44,6 +47,12 @@ namespace MM
 	class ExpertAdvisor;
 	class Trade;
 	class Stock;
+	namespace io
+	{
+		class SnapshotWriter;
+		class SnapshotReader;
+		class TradeJournal;
+	};
 
 	class Market
 	{
@@ -51,7 +60,9 @@ namespace MM
 		Market();
 		~Market();
 		
-		Stock *getStock(std::string, bool allowCreation = false);
+		Stock *getStock(const std::string &pair, bool allowCreation = false);
+		// Constant time lookup for the hot path. Returns nullptr if the stock has not been created yet.
+		Stock *getStock(SymbolID symbol) { return (symbol >= 0 && static_cast<size_t>(symbol) < stocks.size()) ? stocks[symbol] : nullptr; }
 		void addStock(std::string);
 
 		std::vector<Trade*> &getOpenTrades() { return trades; };
@@ -63,10 +74,27 @@ namespace MM
 
 		void init(void *ini);
 		void run();
+		// One iteration of run() without polling the interfaces: dispatches pending events and executes indicators and experts.
+		void step();
+
+		// Values that are swept by the parameter sweep. Also configurable in the [Parameters] section.
+		void setParameters(const std::map<std::string, double> &values) { parameters = values; }
+		double getParameter(const std::string &name, double defaultValue) const;
+
+		// Checkpointing of the market clock, the account and the state of all indicators and experts (see VirtualMarket).
+		// The open trades are not part of it; they are republished by the interface.
+		void serialize(io::SnapshotWriter &writer) const;
+		void deserialize(io::SnapshotReader &reader);
 
 		const Account& getAccount() { return account; }
 
-		std::string getSaveFolderName() { return "saves"; }
+		// The converted tick data of all pairs, see Stock::getDirectoryName.
+		const std::string &getSaveFolderName() { return saveFolderName; }
+		void setSaveFolderName(const std::string &folder) { saveFolderName = folder; }
+		// Open trades are persisted here. Has to differ between simulations that run in parallel.
+		const std::string &getTradesFolderName() { return tradesFolderName; }
+		// Locally changed limits of live trades, opened on first use. nullptr in virtual mode.
+		io::TradeJournal *getTradeJournal();
 
 		void addEvent(const Event &e);
 		std::vector<ExpertAdvisor*> &getExperts() { return experts; }
@@ -84,12 +112,36 @@ namespace MM
 		{
 			double initialStopLoss = 0.0;
 		} tradingConfiguration;
+		std::string saveFolderName = "saves";
+		std::string tradesFolderName = "saves/trades";
+		std::unique_ptr<io::TradeJournal> tradeJournal;
+		// Whether the journal has been checked against a complete update of the broker since startup.
+		bool tradeJournalReconciled = false;
+		// In records, see io::TradeJournal.
+		size_t tradeJournalCompaction = 10000;
+		std::map<std::string, double> parameters;
+
+		// For the experts' execute() callback.
+		struct ExecutionClock_
+		{
+			std::time_t startTime = 0;
+			std::time_t lastExecutionTime = 0;
+		} executionClock;
 
-		std::map<std::string, Stock*> stocks;
+		// Indexed by SymbolID.
+		std::vector<Stock*> stocks;
 		std::vector<Trade*> trades;
 		std::vector<ExpertAdvisor*> experts;
 		std::vector<Indicators::Base*> indicators;
 
+		// Indexed like experts and indicators.
+		struct ProfilerZones_
+		{
+			std::vector<vm::ZoneID> expertTick, expertExecute;
+			std::vector<vm::ZoneID> indicatorUpdate;
+		} profilerZones;
+		void updateProfilerZones();
+
 		friend class Stock;
 		friend class Interface::MetaTrader::MTInterface;
 
@@ -100,18 +152,34 @@ namespace MM
 
 		// Interface for the virtual market
 	private:
-		void onNewTickMessageReceived(const std::string &pair, QuantLib::Decimal bid, QuantLib::Decimal ask, std::time_t time);
-		void onNewTradeMessageReceived(Trade *trade);
-		void saveAndClearTrades();
+		// The date of the event is the day of reception, which the virtual market determines once per step.
+		void onNewTickMessageReceived(SymbolID symbol, QuantLib::Decimal bid, QuantLib::Decimal ask, std::time_t time, const QuantLib::Date &date);
+		/*
+			Complete updates of the open trades (by the virtual market or the MetaTrader bridge) are applied as a diff:
+			all trades are saved first, known tickets are then updated in place and trades that are not part of the update anymore are removed.
+			Trade objects are reused.
+		*/
+		void beginOpenTradesUpdate();
+		void onOpenTradeReceived(const Trade &state);
+		void endOpenTradesUpdate();
+		// Trades of the running update, in the order they were received.
+		std::vector<Trade*> updatedTrades;
+		std::vector<Trade*> tradePool;
 		friend class VirtualMarket;
+		friend class ParameterSweep;
+		friend class Benchmark;
 		std::chrono::milliseconds sleepDuration;
 		bool isVirtualModeEnabled;
+		// The agents are separate processes with their own state, which simulations running side by side would mix up.
+		bool areExternalAgentsEnabled;
 		
 		void setSleepDuration(int ms);
 		void setVirtual(bool state) { isVirtualModeEnabled = state; };
+		void setExternalAgentsEnabled(bool state) { areExternalAgentsEnabled = state; };
 	public:
 		bool isVirtual() { return isVirtualModeEnabled; }
 	};
 };
 
-extern MM::Market market;
\ No newline at end of file
+// Of the simulation bound to the calling thread, see SimulationContext.
+MM::Market &market();
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+
+namespace MM
+{
+	/*
+		Bounded lock-free queue for exactly one producer thread and one consumer thread.
+		Slots are pre-allocated and written in place, so neither side allocates after construction.
+		Producer: beginPush() -> fill slot -> commitPush(). Consumer: front() -> read slot -> pop().
+	*/
+	template<typename T, size_t Capacity> class SPSCRing
+	{
+		static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two.");
+	public:
+		SPSCRing() : buffer(new T[Capacity]), head(0), tail(0) {}
+
+		// Returns the next free slot or nullptr if the ring is full.
+		T *beginPush()
+		{
+			const size_t currentHead = head.load(std::memory_order_relaxed);
+			if (currentHead - tail.load(std::memory_order_acquire) >= Capacity) return nullptr;
+			return &buffer[currentHead & (Capacity - 1)];
+		}
+		// Publishes the slot returned by the last beginPush().
+		void commitPush()
+		{
+			head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		}
+
+		// Returns the oldest element or nullptr if the ring is empty.
+		T *front()
+		{
+			const size_t currentTail = tail.load(std::memory_order_relaxed);
+			if (currentTail == head.load(std::memory_order_acquire)) return nullptr;
+			return &buffer[currentTail & (Capacity - 1)];
+		}
+		// Releases the slot returned by front().
+		void pop()
+		{
+			tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		}
+
+		// Approximate when called concurrently.
+		size_t size() const
+		{
+			return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+		}
+		static size_t capacity() { return Capacity; }
+
+	private:
+		std::unique_ptr<T[]> buffer;
+		// Keep the indices on separate cache lines so that producer and consumer do not contend.
+		alignas(64) std::atomic<size_t> head;
+		alignas(64) std::atomic<size_t> tail;
+	};
+};
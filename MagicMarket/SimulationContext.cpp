@@ -0,0 +1,48 @@
+#include "SimulationContext.h"
+
+#include "VirtualMarket.h"
+
+namespace MM
+{
+	namespace
+	{
+		thread_local SimulationContext *boundContext = nullptr;
+	};
+
+	SimulationContext::SimulationContext() : configurationFilename("market.ini")
+	{
+	}
+
+	SimulationContext::~SimulationContext()
+	{
+	}
+
+	SimulationContext &SimulationContext::current()
+	{
+		if (boundContext != nullptr) return *boundContext;
+		return getDefault();
+	}
+
+	SimulationContext &SimulationContext::getDefault()
+	{
+		static SimulationContext defaultContext;
+		return defaultContext;
+	}
+
+	SimulationContextBinding::SimulationContextBinding(SimulationContext &context) : previous(boundContext)
+	{
+		boundContext = &context;
+	}
+
+	SimulationContextBinding::~SimulationContextBinding()
+	{
+		boundContext = previous;
+	}
+};
+
+MM::Market &market() { return MM::SimulationContext::current().market; }
+MM::Statistics &statistics() { return MM::SimulationContext::current().statistics; }
+MM::VirtualMarket *virtualMarket() { return MM::SimulationContext::current().virtualMarket.get(); }
+MM::EnvironmentVariables &environmentVariables() { return MM::SimulationContext::current().environmentVariables; }
+MM::SymbolTable &symbolTable() { return MM::SimulationContext::current().symbolTable; }
+Interface::MetaTrader::MTInterface &metatrader() { return MM::SimulationContext::current().metatrader; }
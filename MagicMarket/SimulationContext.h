@@ -0,0 +1,64 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "EnvironmentVariables.h"
+#include "SymbolTable.h"
+#include "Statistics.h"
+#include "Market.h"
+#include "Interfaces/MTInterface.h"
+
+namespace MM
+{
+	class VirtualMarket;
+
+	/*
+		Owns all state of one simulation (or of the live market).
+		The global accessors market(), statistics(), virtualMarket(), environmentVariables(), metatrader() and symbolTable()
+		resolve to the context that is bound to the calling thread, or to the default context if none is bound.
+		Several contexts can run in parallel threads; they only share the read-only tick store.
+	*/
+	class SimulationContext
+	{
+	public:
+		SimulationContext();
+		~SimulationContext();
+
+		SimulationContext(const SimulationContext &) = delete;
+		SimulationContext &operator=(const SimulationContext &) = delete;
+
+		// Declaration order is construction order.
+		EnvironmentVariables environmentVariables;
+		SymbolTable symbolTable;
+		Statistics statistics;
+		Market market;
+		Interface::MetaTrader::MTInterface metatrader;
+		std::unique_ptr<VirtualMarket> virtualMarket;
+
+		// The ini file the subsystems of this context are configured from.
+		const std::string &getConfigurationFilename() const { return configurationFilename; }
+		void setConfigurationFilename(const std::string &filename) { configurationFilename = filename; }
+
+		static SimulationContext &current();
+		static SimulationContext &getDefault();
+
+	private:
+		std::string configurationFilename;
+
+		friend class SimulationContextBinding;
+	};
+
+	// Binds a context to the calling thread for the lifetime of the object.
+	class SimulationContextBinding
+	{
+	public:
+		explicit SimulationContextBinding(SimulationContext &context);
+		~SimulationContextBinding();
+
+		SimulationContextBinding(const SimulationContextBinding &) = delete;
+		SimulationContextBinding &operator=(const SimulationContextBinding &) = delete;
+	private:
+		SimulationContext *previous;
+	};
+};
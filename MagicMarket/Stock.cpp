@@ -10,7 +10,7 @@ namespace filesystem = std::tr2::sys;
 namespace MM
 {
 
-	Stock::Stock(std::string pair) : currencyPair(pair)
+	Stock::Stock(std::string pair) : currencyPair(pair), symbol(symbolTable().intern(pair))
 	{
 		
 	}
@@ -48,16 +48,18 @@ namespace MM
 	}
 
 
-	std::string Stock::getDirectoryName()
+	const std::string &Stock::getDirectoryName()
 	{
-		return Stock::getDirectoryName(currencyPair);
+		if (directoryName.empty())
+			directoryName = Stock::getDirectoryName(currencyPair);
+		return directoryName;
 	}
 
 	std::string Stock::getDirectoryName(std::string currencyPair)
 	{
-		filesystem::path path(market.getSaveFolderName());
+		filesystem::path path(market().getSaveFolderName());
 		if (!filesystem::exists(path))
-			filesystem::create_directory(path);
+			filesystem::create_directories(path);
 		path /= currencyPair;
 		if (!filesystem::exists(path))
 			filesystem::create_directory(path);
@@ -78,7 +80,9 @@ namespace MM
 
 		// exists, so it can possibly contain stock data
 		tradingDays[date] = new TradingDay(date, this);
-		tradingDays[date]->loadFromFile();
+		// The ticks of the virtual market's days become visible as they are replayed.
+		if (tradingDays[date]->loadFromFile() && market().isVirtual())
+			tradingDays[date]->hideTicksAfter(market().getLastTickTime());
 
 		return tradingDays[date];
 	}
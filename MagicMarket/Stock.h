@@ -9,6 +9,7 @@
 
 #include "Tick.h"
 #include "TimePeriod.h"
+#include "SymbolTable.h"
 
 namespace MM
 {     
@@ -28,7 +29,8 @@ namespace MM
 
 		Trade *newTrade(Trade trade);
 
-		std::string getCurrencyPair() { return currencyPair; }
+		const std::string &getCurrencyPair() const { return currencyPair; }
+		SymbolID getSymbol() const { return symbol; }
 
 		void receiveFreshTick(Tick tick);
 
@@ -40,13 +42,16 @@ namespace MM
 		TimePeriod getTimePeriod(const std::time_t &time);
 
 		// saving and loading
-		std::string getDirectoryName();
+		const std::string &getDirectoryName();
 		static std::string getDirectoryName(std::string currencyPair);
 
 	private:
 		std::map<QuantLib::Date, TradingDay*> tradingDays;
 		decltype(Stock::tradingDays) &getAllTradingDays() { return tradingDays; }
 		std::string currencyPair;
+		SymbolID symbol;
+		// Resolved once, so that repeated lookups do not touch the file system.
+		std::string directoryName;
 
 		friend class io::DataConverter;
 		friend class io::DataReader;
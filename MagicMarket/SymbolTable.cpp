@@ -0,0 +1,69 @@
+#include "SymbolTable.h"
+
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace MM
+{
+	// Packing never results in a zero byte followed by a non-zero one, so this never matches a short name.
+	static const uint64_t LONG_NAME_KEY = static_cast<uint64_t>(1) << 56;
+
+	SymbolTable::SymbolTable()
+	{
+		keys.reserve(32);
+	}
+
+	SymbolTable::~SymbolTable()
+	{
+	}
+
+	uint64_t SymbolTable::pack(const char *name, size_t maxLength)
+	{
+		uint64_t key = 0;
+		for (size_t i = 0; i < maxLength && i < sizeof(key); ++i)
+		{
+			if (name[i] == '\0') break;
+			key |= static_cast<uint64_t>(static_cast<uint8_t>(name[i])) << (8 * i);
+		}
+		return key;
+	}
+
+	SymbolID SymbolTable::find(const char *name, size_t maxLength) const
+	{
+		const size_t length = strnlen(name, maxLength);
+		if (length > sizeof(uint64_t))
+		{
+			auto iter = longNames.find(std::string(name, length));
+			return (iter != longNames.end()) ? iter->second : INVALID_SYMBOL;
+		}
+
+		const uint64_t key = pack(name, maxLength);
+		for (size_t i = 0, ii = keys.size(); i < ii; ++i)
+		{
+			if (keys[i] == key) return static_cast<SymbolID>(i);
+		}
+		return INVALID_SYMBOL;
+	}
+
+	SymbolID SymbolTable::intern(const char *name, size_t maxLength)
+	{
+		const SymbolID existing = find(name, maxLength);
+		if (existing != INVALID_SYMBOL) return existing;
+
+		if (keys.size() >= static_cast<size_t>(std::numeric_limits<SymbolID>::max()))
+			throw std::length_error("Symbol table is full, cannot register " + std::string(name, strnlen(name, maxLength)));
+
+		const size_t length = strnlen(name, maxLength);
+		const SymbolID id = static_cast<SymbolID>(keys.size());
+		if (length > sizeof(uint64_t))
+		{
+			keys.push_back(LONG_NAME_KEY);
+			longNames[std::string(name, length)] = id;
+		}
+		else
+			keys.push_back(pack(name, maxLength));
+		names.emplace_back(name, length);
+		return id;
+	}
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+
+namespace MM
+{
+	// Small integer handle for a currency pair. Assigned once when a pair is first seen.
+	typedef int16_t SymbolID;
+	const SymbolID INVALID_SYMBOL = -1;
+
+	/*
+		Maps currency pair names to small integer IDs.
+		Names of up to eight characters (which covers all forex pairs) are packed into one integer,
+		so that lookups are a scan over a handful of integers and never allocate.
+		Longer names (e.g. broker suffixes like "EURUSD.pro") are kept in a map instead.
+		Only interning a so far unknown pair allocates; that normally happens during startup.
+	*/
+	class SymbolTable
+	{
+	public:
+		SymbolTable();
+		~SymbolTable();
+
+		// Returns the ID of the pair, registering it if it is not known yet. Throws std::length_error when the IDs run out.
+		SymbolID intern(const char *name, size_t maxLength);
+		SymbolID intern(const std::string &name) { return intern(name.c_str(), name.size()); }
+		// Returns INVALID_SYMBOL for unknown pairs.
+		SymbolID find(const char *name, size_t maxLength) const;
+		SymbolID find(const std::string &name) const { return find(name.c_str(), name.size()); }
+
+		const std::string &getName(SymbolID id) const { return names[id]; }
+		size_t size() const { return keys.size(); }
+
+	private:
+		static uint64_t pack(const char *name, size_t maxLength);
+
+		std::vector<uint64_t> keys;
+		std::map<std::string, SymbolID> longNames;
+		// deque to keep references returned by getName() stable.
+		std::deque<std::string> names;
+	};
+};
+
+// Of the simulation bound to the calling thread, see SimulationContext.
+MM::SymbolTable &symbolTable();
@@ -44,6 +44,7 @@ namespace MM
 		friend class Stock;
 		friend class TradingDay;
 		friend class io::DataReader;
+		friend class SyntheticTickGenerator;
 
 		friend std::ostream& operator<< (std::ostream &out, const MM::Tick &tick);
 		friend std::istream& operator>> (std::istream &in, const MM::Tick &tick);
@@ -0,0 +1,80 @@
+#include "TickStore.h"
+
+#include <fstream>
+
+MM::TickStore tickStore;
+
+namespace MM
+{
+	TickStore::TickStore() : bufferPool(std::make_shared<BufferPool>())
+	{
+	}
+
+	size_t TickStore::estimateTickCount(std::istream &file)
+	{
+		const std::istream::pos_type begin = file.tellg();
+		file.seekg(0, std::ios_base::end);
+		const std::istream::pos_type end = file.tellg();
+		file.seekg(begin);
+		if (begin < 0 || end < begin) return 0;
+		return static_cast<size_t>(end - begin) / Tick().getOutputBitSize() + 1;
+	}
+
+	TickStore::TickData TickStore::readFile(const std::string &filename)
+	{
+		std::fstream file(filename.c_str(), std::ios_base::in | std::ios_base::binary);
+		if (!file.good()) return nullptr;
+
+		std::unique_ptr<std::vector<Tick>> buffer;
+		{ // scope
+			std::lock_guard<std::mutex> lock(bufferPool->mutex);
+			if (!bufferPool->buffers.empty())
+			{
+				buffer = std::move(bufferPool->buffers.back());
+				bufferPool->buffers.pop_back();
+			}
+		}
+		if (!buffer)
+			buffer = std::make_unique<std::vector<Tick>>();
+		buffer->clear();
+		buffer->reserve(estimateTickCount(file));
+
+		// The buffer goes back to the pool when the last day that uses it is released.
+		std::shared_ptr<BufferPool> pool = bufferPool;
+		std::shared_ptr<std::vector<Tick>> ticks(buffer.release(), [pool](std::vector<Tick> *released)
+		{
+			std::lock_guard<std::mutex> lock(pool->mutex);
+			if (pool->buffers.size() < BufferPool::MAX_BUFFERS)
+				pool->buffers.emplace_back(released);
+			else
+				delete released;
+		});
+		while (file.good())
+		{
+			Tick newTick;
+			file >> newTick;
+			ticks->push_back(newTick);
+		}
+		return ticks;
+	}
+
+	TickStore::TickData TickStore::load(const std::string &filename)
+	{
+		{ // scope
+			std::lock_guard<std::mutex> lock(mutex);
+			TickData cached = files[filename].lock();
+			if (cached) return cached;
+		}
+
+		// Parse without holding the lock; if another thread was faster, use its copy.
+		TickData data = readFile(filename);
+		if (!data) return nullptr;
+
+		std::lock_guard<std::mutex> lock(mutex);
+		std::weak_ptr<const std::vector<Tick>> &entry = files[filename];
+		TickData cached = entry.lock();
+		if (cached) return cached;
+		entry = data;
+		return data;
+	}
+};
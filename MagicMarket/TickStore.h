@@ -0,0 +1,48 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Tick.h"
+
+namespace MM
+{
+	/*
+		Process-wide cache of parsed tick files, shared by all simulation contexts.
+		Entries stay alive as long as one trading day still references them, so parallel simulations
+		that walk through the same period parse every file only once.
+		Released tick buffers are kept for the next files, so that day rollovers neither allocate nor fault in new pages.
+	*/
+	class TickStore
+	{
+	public:
+		TickStore();
+
+		typedef std::shared_ptr<const std::vector<Tick>> TickData;
+
+		// Returns nullptr if the file does not exist.
+		TickData load(const std::string &filename);
+		// Number of ticks in a tick file from its size (plus one, as the reader also appends the tick that hits the end of the file).
+		static size_t estimateTickCount(std::istream &file);
+	private:
+		TickData readFile(const std::string &filename);
+
+		std::mutex mutex;
+		std::map<std::string, std::weak_ptr<const std::vector<Tick>>> files;
+
+		// Shared with the deleters of the handed out buffers, which may outlive the store.
+		struct BufferPool
+		{
+			std::mutex mutex;
+			std::vector<std::unique_ptr<std::vector<Tick>>> buffers;
+			// Parallel simulations hold a few days each; more buffers than that are not worth keeping.
+			static const size_t MAX_BUFFERS = 32;
+		};
+		std::shared_ptr<BufferPool> bufferPool;
+	};
+};
+
+extern MM::TickStore tickStore;
@@ -3,6 +3,7 @@
 #include "Stock.h"
 #include "TradingDay.h"
 #include "Market.h"
+#include "VM/Profiler.h"
 
 #include <assert.h>
 #include <algorithm>
@@ -43,21 +44,24 @@ namespace MM
 	{
 		if (!cacheDirty) return true;
 
+		static const vm::ZoneID profilerZone = vm::Profiler::registerZone("TimePeriod::checkInitCache");
+		vm::ProfilerZone zone(profilerZone);
+
 		// for now, assume we are always evaluating one single day
 		if (dateFromTime(startTime) != dateFromTime(endTime)) return false;
 		assert(dateFromTime(startTime) == dateFromTime(endTime));
 
-		ticksEnd = ticksOneBeforeBegin = std::vector<Tick>::iterator();
+		ticksEnd = ticksOneBeforeBegin = nullptr;
 
 		TradingDay *day = (this->tradingDay != nullptr) ? this->tradingDay : stock->getTradingDay(dateFromTime(endTime));
 		if (day == nullptr) return false;
-		std::vector<Tick> &ticks = day->getTicks();
+		const TickRange ticks = day->getTicks();
 		if (ticks.size() < 3) return false;
 
-		ticksTotalBegin = day->ticks.begin();
-		ticksTotalEnd = day->ticks.end();
-		ticksOneBeforeBegin = day->ticks.end();
-		ticksEnd   = day->ticks.end();
+		ticksTotalBegin = ticks.begin();
+		ticksTotalEnd = ticks.end();
+		ticksOneBeforeBegin = ticks.end();
+		ticksEnd   = ticks.end();
 
 		bool endSet(false);
 		
@@ -78,7 +82,7 @@ namespace MM
 
 			if (i == 0) break;
 		}
-		if (ticksOneBeforeBegin == day->ticks.end()) return false;
+		if (ticksOneBeforeBegin == ticks.end()) return false;
 
 		cacheDirty = false;
 		return true;
@@ -149,7 +153,7 @@ namespace MM
 	{
 		if (!checkInitCache()) return nullptr;
 
-		Tick *tick = nullptr;
+		const Tick *tick = nullptr;
 		if (ticksEnd != ticksTotalEnd)
 		{
 			tick = &*(ticksEnd - 1);
@@ -158,7 +162,7 @@ namespace MM
 		{
 			TradingDay *day = stock->getTradingDay(dateFromTime(endTime));
 			assert(day != nullptr);
-			tick = &day->ticks.back();
+			tick = &day->getTicks().back();
 		}
 		return tick;
 	}
@@ -170,7 +174,7 @@ namespace MM
 		QuantLib::Decimal sum = 0.0;
 		int count = 0;
 
-		for (Tick &tick : *this)
+		for (const Tick &tick : *this)
 		{
 			assert (tick.getTime() >= startTime);
 			assert (tick.getTime() < endTime);
@@ -188,7 +192,8 @@ namespace MM
 		TradingDay *day = stock->getTradingDay(dateFromTime(endTime));
 		if (day == nullptr) return -1;
 
-		std::vector<Tick> &ticks = day->getTicks();
+		const TickRange ticks = day->getTicks();
+		if (ticks.empty()) return -1;
 
 		// initialize max time by last/first tick margin to start/end time
 		const int startingGap = static_cast<int>(std::max(0ll, ticks[0].getTime() - startTime));
@@ -200,8 +205,8 @@ namespace MM
 
 		for (size_t i = 1, len = ticks.size(); i < len; ++i)		
 		{
-			Tick &current = ticks[i];
-			Tick &last = ticks[i - 1];
+			const Tick &current = ticks[i];
+			const Tick &last = ticks[i - 1];
 
 			if (current.getTime() < startTime || current.getTime() > endTime) continue;
 			if (last.getTime() < startTime || last.getTime() > endTime) continue;
@@ -235,8 +240,8 @@ namespace MM
 				++currentTick;
 			}
 			
-			Tick &tick = *lastTick;
-			assert(tick.getTime() < currentTime || market.isVirtual());
+			const Tick &tick = *lastTick;
+			assert(tick.getTime() < currentTime || market().isVirtual());
 			values.push_back((tick.*valueFunction)());
 			currentTime += secondsInterval;
 		}
@@ -286,7 +291,7 @@ namespace MM
 	{
 		cacheDirty = true;
 
-		Stock *s = market.getStock(currencyPair);
+		Stock *s = market().getStock(currencyPair);
 		if (s == nullptr) return false;
 		return setStock(s);
 	}
@@ -1,13 +1,10 @@
 #include "Trade.h"
 #include "Market.h"
 
-#include <fstream>
 #include <algorithm>
 
-#include <filesystem>
-namespace filesystem = std::tr2::sys;
-
 #include "Tick.h"
+#include "IO/TradeJournal.h"
 
 namespace MM
 {
@@ -45,52 +42,36 @@ namespace MM
 		return profit;
 	}
 
-	std::string Trade::getSaveFileName()
-	{
-		std::ostringstream os;
-		os << market.getSaveFolderName() << "/trades";
-		filesystem::path path(os.str());
-		if (!filesystem::exists(path))
-			filesystem::create_directory(path);
-		os << "/" << ticketID << ".trade";
-		return os.str();
-	}
-
-	void Trade::removeSaveFile()
-	{
-		std::string saveFileName = getSaveFileName();
-		filesystem::path path(saveFileName);
-		if (filesystem::exists(path))
-			filesystem::remove(path);
-	}
-
 	void Trade::save(bool enforce)
 	{
 		if (!enforce && !dirty) return;
 
-		std::fstream file(getSaveFileName().c_str(), std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
-		if (!file.good()) return;
+		savedLimits.valid = true;
+		savedLimits.stopLossPrice = stopLossPrice;
+		savedLimits.takeProfitPrice = takeProfitPrice;
 
-		int32_t version(1);
-		file.write((char*)&version, sizeof(version));
-		file.write((char*)&stopLossPrice, sizeof(stopLossPrice));
-		file.write((char*)&takeProfitPrice, sizeof(takeProfitPrice));
+		io::TradeJournal *journal = market().getTradeJournal();
+		if (journal != nullptr)
+			journal->recordLimits(ticketID, market().getLastTickTime(), stopLossPrice, takeProfitPrice);
 	}
 
 	void Trade::load()
 	{
-		std::fstream file(getSaveFileName().c_str(), std::ios_base::in | std::ios_base::binary);
-		if (!file.good()) return;
-
-		int32_t version(0);
-		file.read((char*)&version, sizeof(version));
-
 		QuantLib::Decimal sl(0.0), tp(0.0);
 
-		if (version == 1)
+		if (savedLimits.valid)
+		{
+			sl = savedLimits.stopLossPrice;
+			tp = savedLimits.takeProfitPrice;
+		}
+		else
 		{
-			file.read((char*)&sl, sizeof(sl));
-			file.read((char*)&tp, sizeof(tp));
+			// Only live trades can have been saved by an earlier run.
+			const io::TradeJournal *journal = market().getTradeJournal();
+			const io::TradeJournal::Entry *entry = (journal != nullptr) ? journal->find(ticketID) : nullptr;
+			if (entry == nullptr) return;
+			sl = entry->stopLossPrice;
+			tp = entry->takeProfitPrice;
 		}
 
 		if (sl == 0.0) sl = stopLossPrice;
@@ -115,4 +96,22 @@ namespace MM
 		
 		dirty = false;
 	}
+
+	void Trade::updateFromBroker(const Trade &state)
+	{
+		// A reused object must not merge the limits of its previous trade.
+		if (ticketID != state.ticketID)
+			savedLimits.valid = false;
+
+		currencyPair = state.currencyPair;
+		lotSize = state.lotSize;
+		orderPrice = state.orderPrice;
+		ticketID = state.ticketID;
+		type = state.type;
+		stopLossPrice = state.stopLossPrice;
+		takeProfitPrice = state.takeProfitPrice;
+		// Same as a freshly received trade.
+		dirty = true;
+		load();
+	}
 };
\ No newline at end of file
@@ -29,11 +29,11 @@ namespace MM
 
 		QuantLib::Decimal getProfitAtTick(const Tick& tick) const;
 
-		// completes the trade data with saved information
-		std::string getSaveFileName();
+		// completes the trade data with saved information (see Market::getTradeJournal)
 		void load();
 		void save(bool enforce = false);
-		void removeSaveFile();
+		// Applies the state of the trade as reported by the broker. Stricter limits that were set and saved locally are kept, see load().
+		void updateFromBroker(const Trade &state);
 
 		static Trade Buy(std::string currencyPair, QuantLib::Decimal lotSize)
 		{
@@ -53,6 +53,8 @@ namespace MM
 
 		QuantLib::Decimal &getTakeProfitPrice() { return takeProfitPrice; }
 		QuantLib::Decimal &getStopLossPrice()  { return stopLossPrice; }
+		QuantLib::Decimal getTakeProfitPrice() const { return takeProfitPrice; }
+		QuantLib::Decimal getStopLossPrice() const { return stopLossPrice; }
 
 		void setTakeProfitPrice(QuantLib::Decimal to);
 		void setStopLossPrice(QuantLib::Decimal to);
@@ -61,6 +63,14 @@ namespace MM
 		bool dirty; // save on next opportunity
 		QuantLib::Decimal takeProfitPrice;
 		QuantLib::Decimal stopLossPrice;
+
+		// The limits as of the last save(). Virtual runs only keep them here, live runs also write them to the trade journal.
+		struct SavedLimits_
+		{
+			bool valid = false;
+			QuantLib::Decimal takeProfitPrice = 0.0;
+			QuantLib::Decimal stopLossPrice = 0.0;
+		} savedLimits;
 	};
 
 };
\ No newline at end of file
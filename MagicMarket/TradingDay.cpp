@@ -2,6 +2,10 @@
 
 #include "Stock.h"
 #include "Market.h"
+#include "TickStore.h"
+#include "VM/Profiler.h"
+
+#include <algorithm>
 
 namespace MM
 {
@@ -10,6 +14,7 @@ namespace MM
 	TradingDay::TradingDay(QuantLib::Date date, Stock *stock) : date(date), stock(stock)
 	{
 		saveFile = nullptr;
+		sharedTickCount = 0;
 	}
 
 
@@ -23,7 +28,22 @@ namespace MM
 		}
 	}
 
-	std::string TradingDay::getCurrencyPair()
+	void TradingDay::reset(QuantLib::Date date, Stock *stock)
+	{
+		if (saveFile)
+		{
+			saveFile->close();
+			delete saveFile;
+			saveFile = nullptr;
+		}
+		this->date = date;
+		this->stock = stock;
+		ticks.clear();
+		sharedTicks.reset();
+		sharedTickCount = 0;
+	}
+
+	const std::string &TradingDay::getCurrencyPair()
 	{
 		assert(stock);
 		return stock->getCurrencyPair();
@@ -44,8 +64,36 @@ namespace MM
 		getSaveFile() << tick << std::flush;
 	}
 
+	std::vector<Tick> &TradingDay::getMutableTicks()
+	{
+		if (sharedTicks)
+		{
+			ticks.assign(sharedTicks->begin(), sharedTicks->begin() + sharedTickCount);
+			sharedTicks.reset();
+			sharedTickCount = 0;
+		}
+		return ticks;
+	}
+
+	void TradingDay::hideTicksAfter(const std::time_t &time)
+	{
+		if (!sharedTicks) return;
+		const auto last = std::upper_bound(sharedTicks->begin(), sharedTicks->end(), time, [](const std::time_t &time, const Tick &tick) { return time < tick.getTime(); });
+		sharedTickCount = static_cast<size_t>(last - sharedTicks->begin());
+	}
+
 	void TradingDay::receiveFreshTick(const Tick &tick)
 	{
+		// The tick is part of the shared data already, so only the view moves on.
+		if (sharedTicks)
+		{
+			const std::vector<Tick> &shared = *sharedTicks;
+			while (sharedTickCount < shared.size() && shared[sharedTickCount].getTime() <= tick.getTime())
+				++sharedTickCount;
+			return;
+		}
+
+		std::vector<Tick> &ticks = getMutableTicks();
 		// check last tick if time is equal
 		if (ticks.size())
 		{
@@ -53,7 +101,7 @@ namespace MM
 			{
 				ticks.back() = tick;
 				// overwrite the old tick in the savefile..
-				if (!market.isVirtual())
+				if (!market().isVirtual())
 				{
 					getSaveFile().seekp(-tick.getOutputBitSize(), std::ios_base::cur);
 					getSaveFile() << tick << std::flush;
@@ -64,7 +112,7 @@ namespace MM
 
 		ticks.push_back(tick);
 		// save the tick!
-		if (!market.isVirtual())
+		if (!market().isVirtual())
 			serializeTick(tick);
 	}
 
@@ -94,7 +142,7 @@ namespace MM
 
 	std::ostream &TradingDay::getSaveFile()
 	{
-		assert(!market.isVirtual());
+		assert(!market().isVirtual());
 		if (saveFile) return *saveFile;
 
 		std::string filename = getSavePath();
@@ -105,11 +153,25 @@ namespace MM
 
 	bool TradingDay::loadFromFile()
 	{
+		static const vm::ZoneID profilerZone = vm::Profiler::registerZone("TradingDay::loadFromFile");
+		vm::ProfilerZone zone(profilerZone);
+
 		std::string filename = getSavePath();
+
+		// The virtual market never modifies past days, so the parsed data can be shared between simulations.
+		if (market().isVirtual())
+		{
+			sharedTicks = tickStore.load(filename);
+			sharedTickCount = sharedTicks ? sharedTicks->size() : 0;
+			return sharedTicks != nullptr;
+		}
+
 		std::fstream file(filename.c_str(), std::ios_base::in | std::ios_base::binary);
 
 		if (!file.good()) return false;
 
+		std::vector<Tick> &ticks = getMutableTicks();
+		ticks.reserve(ticks.size() + TickStore::estimateTickCount(file));
 		while (file.good())
 		{
 			Tick newTick;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -18,19 +19,51 @@ namespace MM
 		class DataReader;
 	};
 
+	namespace Indicators
+	{
+		class TickCursor;
+	};
+
+	/*
+		Read-only view of consecutive ticks of a trading day.
+	*/
+	class TickRange
+	{
+	public:
+		TickRange(const Tick *first, const Tick *last) : first(first), last(last) {}
+
+		const Tick *begin() const { return first; }
+		const Tick *end() const { return last; }
+		const Tick *data() const { return first; }
+		size_t size() const { return static_cast<size_t>(last - first); }
+		bool empty() const { return first == last; }
+		const Tick &operator[](size_t index) const { return first[index]; }
+		const Tick &front() const { return *first; }
+		const Tick &back() const { return *(last - 1); }
+	private:
+		const Tick *first;
+		const Tick *last;
+	};
+
 	class TradingDay
 	{
 	public:
 		TradingDay(QuantLib::Date date, Stock *stock);
 		~TradingDay();
+		// Reuses the object for another day. The tick buffer keeps its capacity.
+		void reset(QuantLib::Date date, Stock *stock);
 
-		std::string getCurrencyPair();
+		const std::string &getCurrencyPair();
+		Stock *getStock() { return stock; }
 		TradingDay *getPreviousDay();
 		TradingDay *getNextDay();
 
 		QuantLib::Date getDate() { return date; }
 		
 		void receiveFreshTick(const Tick &tick);
+		// Hides the shared ticks after 'time' until they are received. The virtual market replays the same data into the
+		// days of its stocks, so these stay views of the tick store instead of collecting copies.
+		void hideTicksAfter(const std::time_t &time);
 
 		// saving & loading
 		std::ostream& getSaveFile();
@@ -41,17 +74,29 @@ namespace MM
 		static std::string getSaveFileName(QuantLib::Date forDate);
 	private:
 		QuantLib::Date date;
-		Tick &getTickByIndex(size_t index) { return ticks[index]; }
 		std::vector<Tick> ticks;
+		// The parsed day in the tick store, read in place as long as the day is not changed (virtual market only).
+		std::shared_ptr<const std::vector<Tick>> sharedTicks;
+		// Number of shared ticks that are visible.
+		size_t sharedTickCount;
 		void serializeTick(const Tick &tick);
 
 		std::fstream *saveFile;
 		Stock *stock;
 
-		std::vector<Tick> & getTicks() { return ticks; }
+		TickRange getTicks() const
+		{
+			if (sharedTicks) return TickRange(sharedTicks->data(), sharedTicks->data() + sharedTickCount);
+			return TickRange(ticks.data(), ticks.data() + ticks.size());
+		}
+		// Copies the visible shared ticks before the first change.
+		std::vector<Tick> &getMutableTicks();
 
 		friend class TimePeriod;
 		friend class VirtualMarket;
+		friend class TickReplay;
+		friend class Benchmark;
+		friend class Indicators::TickCursor;
 		friend class io::DataConverter;
 		friend class io::DataReader;
 	};
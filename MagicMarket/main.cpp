@@ -28,6 +28,11 @@
 #include "EnvironmentVariables.h"
 #include "Market.h"
 #include "Statistics.h"
+#include "LatencyMonitor.h"
+#include "Benchmark.h"
+#include "ParameterSweep.h"
+#include "TradeEvaluation.h"
+#include "SimulationContext.h"
 #include "VirtualMarket.h"
 #include "Interfaces/MTInterface.h"
 #include "Trade.h"
@@ -36,17 +41,108 @@
 
 #include <SimpleIni.h>
 
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// Initializes all subsystems of the context from its configuration and runs the market until it is finished.
+	void runSimulation(MM::SimulationContext &context, bool withLatencyMonitor)
+	{
+		MM::SimulationContextBinding binding(context);
+
+		CSimpleIniA ini;
+		ini.LoadFile(context.getConfigurationFilename().c_str());
+		if (ini.IsEmpty())
+			std::cout << "ERROR: Could not load configuration '" << context.getConfigurationFilename() << "'!" << std::endl;
+
+		environmentVariables().init(&ini);
+		market().init(&ini);
+		statistics().init(&ini);
+		metatrader().init(&ini);
+		if (withLatencyMonitor)
+			latencyMonitor.init(&ini);
+		MM::VirtualMarket::checkInit();
+
+		market().run();
+	}
+};
+
 int main (int argc, char *argv [])
 {
 	CSimpleIniA ini;
 	ini.LoadFile("market.ini");
 
-	environmentVariables.init(&ini);
-	market.init(&ini);
-	statistics.init(&ini);
-	metatrader.init(&ini);
-	MM::VirtualMarket::checkInit();
+	// Times the core components on generated data, see Benchmark.
+	if (MM::Benchmark::isEnabled(&ini))
+	{
+		environmentVariables().init(&ini);
+		MM::Benchmark benchmark;
+		benchmark.init(&ini);
+		benchmark.run();
+		return 0;
+	}
+
+	// Only analyses existing trade logs, see TradeEvaluation.
+	if (MM::TradeEvaluation::isEnabled(&ini))
+	{
+		environmentVariables().init(&ini);
+		MM::TradeEvaluation evaluation;
+		evaluation.init(&ini);
+		evaluation.run();
+		return 0;
+	}
+
+	// A parameter sweep replays the data once for all variants, see ParameterSweep.
+	if (MM::ParameterSweep::isEnabled(&ini))
+	{
+		environmentVariables().init(&ini);
+		MM::ParameterSweep sweep;
+		sweep.init(&ini);
+		sweep.run();
+		return 0;
+	}
+
+	/*
+		Several virtual market runs can be executed in parallel, each one configured by its own ini file.
+		They must use different output files and trades folders.
+	*/
+	std::vector<std::string> configurations;
+	{ // scope
+		std::istringstream is(ini.GetValue("Parallel Simulations", "Configurations", ""));
+		std::string filename;
+		while (std::getline(is, filename, ','))
+		{
+			if (!filename.empty())
+				configurations.push_back(filename);
+		}
+	}
+
+	if (configurations.empty())
+	{
+		runSimulation(MM::SimulationContext::getDefault(), true);
+		return 0;
+	}
+
+	std::vector<std::thread> threads;
+	for (const std::string &filename : configurations)
+	{
+		threads.emplace_back([filename]()
+		{
+			std::unique_ptr<MM::SimulationContext> context = std::make_unique<MM::SimulationContext>();
+			context->setConfigurationFilename(filename);
+			runSimulation(*context, false);
+
+			// Experts and indicators might still access their market while being destroyed.
+			MM::SimulationContextBinding binding(*context);
+			context.reset();
+		});
+	}
 
-	market.run();
+	for (std::thread &thread : threads)
+		thread.join();
     return 0;
 }
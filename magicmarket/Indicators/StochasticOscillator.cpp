@@ -1,28 +1,98 @@
 #include "StochasticOscillator.h"
 #include "Market.h"
 #include "Stock.h"
-#include "TimePeriod.h"
+#include "IO/Snapshot.h"
 
 namespace MM
 {
 	namespace Indicators
 	{
+		StochasticOscillatorBatch::StochasticOscillatorBatch(int history, int seconds) :
+			history(history),
+			seconds(seconds)
+		{
+		}
+
+		StochasticOscillatorBatch::~StochasticOscillatorBatch()
+		{
+		}
+
+		void StochasticOscillatorBatch::resizeLanes(size_t count)
+		{
+			while (windows.size() > count) windows.pop_back();
+			while (windows.size() < count) windows.emplace_back(stocks[windows.size()], history * seconds);
+			for (std::vector<double> *values : { &high, &low, &close, &valid, &percentK, &percentD })
+				values->resize(count);
+		}
+
+		void StochasticOscillatorBatch::resetLane(size_t lane)
+		{
+			windows[lane] = TickWindow(stocks[lane], history * seconds);
+			valid[lane] = 0.0;
+			percentK[lane] = std::numeric_limits<double>::quiet_NaN();
+			percentD[lane] = std::numeric_limits<double>::quiet_NaN();
+		}
+
+		void StochasticOscillatorBatch::updateLanes(const std::time_t &secondsSinceStart, const std::time_t &time)
+		{
+			const size_t count = getLaneCount();
+			for (size_t i = 0; i < count; ++i)
+			{
+				TickWindow &window = windows[i];
+				const bool available = window.advanceTo(time) && !std::isnan(window.getHigh()) && !std::isnan(window.getLow());
+				valid[i] = available ? 1.0 : 0.0;
+				close[i] = available ? window.getClose() : 0.0;
+				high[i]  = available ? window.getHigh()  : 1.0;
+				low[i]   = available ? window.getLow()   : 0.0;
+			}
+
+			const double * const H = high.data();
+			const double * const L = low.data();
+			const double * const C = close.data();
+			const double * const V = valid.data();
+			double * const K = percentK.data();
+			double * const D = percentD.data();
+			for (size_t i = 0; i < count; ++i)
+			{
+				const double totalRange = H[i] - L[i];
+				// Same as !std::isnormal for a range that cannot be negative.
+				const bool flat = !(totalRange >= std::numeric_limits<double>::min());
+				const double k = flat ? 0.0 : 100.0 * ((C[i] - L[i]) / (flat ? 1.0 : totalRange));
+				// Math::MA(percentD, percentK, 3)
+				const double d = (D[i] != D[i]) ? k : (2.0 * D[i] + k) / 3.0;
+
+				const bool update = V[i] != 0.0;
+				K[i] = update ? k : K[i];
+				D[i] = update ? d : D[i];
+			}
+		}
+
+		void StochasticOscillatorBatch::deserialize(io::SnapshotReader &reader)
+		{
+			Batch::deserialize(reader);
+			// The windows are rebuilt from the tick data on the next update; the values belong to the oscillators' snapshots.
+			for (size_t lane = 0; lane < windows.size(); ++lane)
+				windows[lane].reset();
+		}
+
 		void StochasticOscillator::reset()
 		{
-			percentK = std::numeric_limits<double>::quiet_NaN();
-			percentD = std::numeric_limits<double>::quiet_NaN();
+			batch->resetLane(lane);
 		}
 
 		StochasticOscillator::StochasticOscillator(std::string currencyPair, int history, int seconds) :
 			currencyPair(currencyPair),
+			stock(market().getStock(currencyPair, true)),
 			history(history),
 			seconds(seconds)
 		{
-
+			batch = Indicators::get<StochasticOscillatorBatch>(history, seconds);
+			lane = batch->addLane(stock);
 		}
 
 		StochasticOscillator::~StochasticOscillator()
 		{
+			batch->releaseLane(lane);
 		}
 
 		void StochasticOscillator::declareExports() const
@@ -33,20 +103,21 @@ namespace MM
 
 		void StochasticOscillator::update(const std::time_t &secondsSinceStart, const std::time_t &time)
 		{
-			Stock *stock = market.getStock(currencyPair);
-			if (stock == nullptr) return;
-			MM::TimePeriod now = stock->getTimePeriod(time - history * seconds, time);
-			const PossibleDecimal close = now.getClose();
-			const PossibleDecimal high  = now.getHigh();
-			const PossibleDecimal low   = now.getLow();
-			if (!close.get() || !high.get() || !low.get()) return;
-
-			const QuantLib::Decimal	totalRange = (*high - *low);
-			if (!std::isnormal(totalRange))
-				percentK = 0.0;
-			else
-				percentK = 100.0 * ((*close - *low) / (*high - *low));
-			percentD = Math::MA(percentD, percentK, 3);
+			batch->advanceTo(secondsSinceStart, time);
+		}
+
+		void StochasticOscillator::serialize(io::SnapshotWriter &writer) const
+		{
+			Base::serialize(writer);
+			writer.write(batch->percentK[lane]);
+			writer.write(batch->percentD[lane]);
+		}
+
+		void StochasticOscillator::deserialize(io::SnapshotReader &reader)
+		{
+			Base::deserialize(reader);
+			reader.read(batch->percentK[lane]);
+			reader.read(batch->percentD[lane]);
 		}
 	};
-};
\ No newline at end of file
+};
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Base.h"
+#include "Batch.h"
+#include "TickWindow.h"
 #include <string>
 
 namespace MM
@@ -9,6 +11,39 @@ namespace MM
 
 	namespace Indicators
 	{
+		// The oscillators of all pairs with the same configuration.
+		class StochasticOscillatorBatch : public Batch
+		{
+		public:
+			StochasticOscillatorBatch(int history, int seconds);
+			virtual ~StochasticOscillatorBatch();
+
+			virtual bool operator== (const Base &otherBase) const
+			{
+				const StochasticOscillatorBatch* other = dynamic_cast<const StochasticOscillatorBatch*>(&otherBase);
+				if (other == nullptr) return false;
+				return (other->history == history) && (other->seconds == seconds);
+			}
+
+			virtual void deserialize(io::SnapshotReader &reader) override;
+
+		private:
+			int history;
+			int seconds;
+
+			// Covers history * seconds.
+			std::vector<TickWindow> windows;
+			// Structure of arrays, one entry per lane.
+			std::vector<double> high, low, close, valid;
+			std::vector<double> percentK, percentD;
+
+			virtual void resizeLanes(size_t count) override;
+			virtual void resetLane(size_t lane) override;
+			virtual void updateLanes(const std::time_t &secondsSinceStart, const std::time_t &time) override;
+
+			friend class StochasticOscillator;
+		};
+
 		// http://www.investopedia.com/terms/s/stochasticoscillator.asp
 		class StochasticOscillator : public Base
 		{
@@ -26,16 +61,20 @@ namespace MM
 				return (other->history == history) && (other->seconds == seconds) && (other->currencyPair == currencyPair);
 			}
 
-			double getPercentK() const { return percentK; }
-			double getPercentD() const { return percentD; }
+			double getPercentK() const { return batch->percentK[lane]; }
+			double getPercentD() const { return batch->percentD[lane]; }
+
+			virtual void serialize(io::SnapshotWriter &writer) const override;
+			virtual void deserialize(io::SnapshotReader &reader) override;
 
 		private:
 			std::string currencyPair;
+			Stock *stock;
 			int history;
 			int seconds;
-			double percentK;
-			double percentD;
+			StochasticOscillatorBatch *batch;
+			size_t lane;
 		};
 
 	};
-};
\ No newline at end of file
+};
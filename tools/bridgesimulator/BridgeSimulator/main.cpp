@@ -0,0 +1,592 @@
+/*
+	Stands in for MetaTrader and MetaTraderBridge.dll: replays .ticks files to the MetaTrader interface of the market
+	with the same packed UDP protocol (see MagicMarket/Interfaces/MTInterface.h) and executes the orders it receives.
+
+	Like the MQL4 expert, the leading pair publishes the account and the open orders after each of its ticks and new orders
+	are opened on the leading pair. Stop losses and take profits are hit on the ticks, as a broker would.
+	The round-trip time from the last tick that was sent to every command that comes back is measured.
+
+	Usage:
+		bridgesim --ticks saves/EURUSD/2016-1-4.ticks,saves/EURCHF/2016-1-4.ticks [--market 127.0.0.1:5005] [--speed 1] [--leading EURUSD]
+		          [--linger 2000] [--rttfile rtt.tsv]
+	The pair is taken from the directory of a .ticks file. A speed of 0 sends as fast as possible.
+
+	Builds on Linux with: g++ -std=c++14 -O2 main.cpp -o bridgesim
+*/
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <cstring>
+#include <cstdint>
+
+#ifdef _WIN32
+#include <WinSock2.h>
+#include <WS2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef int socklen_t;
+#else
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+typedef int SOCKET;
+#define INVALID_SOCKET (-1)
+#define closesocket close
+#endif
+
+typedef std::chrono::steady_clock Clock;
+
+// Same layout as in MTInterface.h.
+namespace Message
+{
+	enum Type
+	{
+		bridgeUp = 1,
+		bridgeDown = 2,
+		bridgeTick = 3,
+		bridgeAccountInfo = 4,
+		bridgeOrders = 5,
+		bridgeError = 6,
+		newOrder = 7,
+		closeOrder = 8,
+		updateOrder = 9
+	};
+#pragma pack(push, 1)
+	struct BridgeUp
+	{
+		char pair[7];
+		int32_t timestamp;
+	};
+
+	struct Tick
+	{
+		char pair[7];
+		double bid;
+		double ask;
+		int32_t timestamp;
+	};
+
+	struct AccountInfo
+	{
+		double leverage;
+		double balance;
+		double margin;
+		double freeMargin;
+	};
+
+	struct Order
+	{
+		char pair[7];
+		int32_t type;
+		int32_t tickedID;
+		double openPrice;
+		double takeProfit;
+		double stopLoss;
+		int32_t timestampOpen;
+		int32_t timestampExpire;
+		double lots;
+		double profit;
+	};
+
+	struct NewOrder
+	{
+		int32_t messageType;
+		int32_t type;
+		double orderPrice;
+		double takeProfitPrice;
+		double stopLossPrice;
+		double lotSize;
+	};
+
+	struct CloseOrder
+	{
+		int32_t messageType;
+		int32_t ticketID;
+	};
+
+	struct UpdateOrder
+	{
+		int32_t messageType;
+		int32_t ticketID;
+		double takeProfitPrice;
+		double stopLossPrice;
+	};
+#pragma pack(pop)
+};
+
+struct Tick
+{
+	int64_t time;
+	double bid, ask;
+	size_t pair;
+};
+
+struct Order
+{
+	Message::Order data;
+	bool isBuy() const { return data.type == 0; }
+};
+
+// Reads the binary tick format of TradingDay: uint8 version | int64 time | double bid | double ask.
+bool loadTicks(const std::string &filename, size_t pair, std::vector<Tick> &ticks)
+{
+	std::ifstream file(filename, std::ios_base::in | std::ios_base::binary);
+	if (!file.good()) return false;
+	while (true)
+	{
+		uint8_t version;
+		Tick tick;
+		if (!file.read(reinterpret_cast<char*>(&version), sizeof(version))) break;
+		if (version != 1) break;
+		if (!file.read(reinterpret_cast<char*>(&tick.time), sizeof(tick.time))) break;
+		if (!file.read(reinterpret_cast<char*>(&tick.bid), sizeof(tick.bid))) break;
+		if (!file.read(reinterpret_cast<char*>(&tick.ask), sizeof(tick.ask))) break;
+		tick.pair = pair;
+		ticks.push_back(tick);
+	}
+	return true;
+}
+
+std::string pairFromFilename(const std::string &filename)
+{
+	std::string directory = filename.substr(0, filename.find_last_of("/\\"));
+	if (directory == filename) return "";
+	return directory.substr(directory.find_last_of("/\\") + 1);
+}
+
+class BridgeSimulator
+{
+public:
+	struct _config
+	{
+		std::string marketHost = "127.0.0.1";
+		int marketPort = 5005;
+		double speed = 1.0;
+		int lingerMs = 2000;
+		std::string leading;
+		std::string rttFilename;
+	} config;
+
+	std::vector<std::string> pairs;
+	std::vector<Tick> ticks;
+
+	bool open()
+	{
+#ifdef _WIN32
+		WSADATA wsa;
+		if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) return false;
+#endif
+		sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+		if (sock == INVALID_SOCKET) return false;
+
+		std::memset(&market, 0, sizeof(market));
+		market.sin_family = AF_INET;
+		market.sin_port = htons(static_cast<uint16_t>(config.marketPort));
+		if (inet_pton(AF_INET, config.marketHost.c_str(), &market.sin_addr) != 1) return false;
+
+		// Bursts must not be dropped on this side.
+		int bufferSize = 4 * 1024 * 1024;
+		setsockopt(sock, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char*>(&bufferSize), sizeof(bufferSize));
+		setsockopt(sock, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&bufferSize), sizeof(bufferSize));
+		return true;
+	}
+
+	void run()
+	{
+		std::stable_sort(ticks.begin(), ticks.end(), [](const Tick &a, const Tick &b) { return a.time < b.time; });
+		leadingPair = std::find(pairs.begin(), pairs.end(), config.leading) - pairs.begin();
+		if (leadingPair >= pairs.size()) leadingPair = 0;
+		currentBid.assign(pairs.size(), 0.0);
+		currentAsk.assign(pairs.size(), 0.0);
+
+		for (size_t pair = 0; pair < pairs.size(); ++pair)
+			sendBridgeState(Message::bridgeUp, pair, ticks.empty() ? 0 : ticks.front().time);
+
+		const Clock::time_point start = Clock::now();
+		for (const Tick &tick : ticks)
+		{
+			if (config.speed > 0.0)
+			{
+				const Clock::time_point due = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>((tick.time - ticks.front().time) / config.speed));
+				waitForCommands(due);
+			}
+			else
+				waitForCommands(Clock::now());
+
+			onTick(tick);
+		}
+		const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+		// The market may still react to the last ticks.
+		waitForCommands(Clock::now() + std::chrono::milliseconds(config.lingerMs));
+		for (size_t pair = 0; pair < pairs.size(); ++pair)
+			sendBridgeState(Message::bridgeDown, pair, ticks.empty() ? 0 : ticks.back().time);
+
+		report(elapsed);
+	}
+
+private:
+	SOCKET sock = INVALID_SOCKET;
+	struct sockaddr_in market;
+
+	size_t leadingPair = 0;
+	int64_t now = 0;
+	std::vector<double> currentBid, currentAsk;
+	std::map<int32_t, Order> orders;
+	int32_t nextTicketID = 1;
+	double balance = 10000.0;
+	const double leverage = 100.0;
+
+	Clock::time_point lastTickSentAt;
+	bool anyTickSent = false;
+	size_t ticksSent = 0, sendErrors = 0, stopsHit = 0;
+	std::map<int32_t, size_t> commandCounts;
+	// Microseconds from the last sent tick to a command, per command type.
+	std::map<int32_t, std::vector<double>> roundTrips;
+
+	void send(const std::string &data)
+	{
+		if (sendto(sock, data.data(), static_cast<int>(data.size()), 0, reinterpret_cast<const struct sockaddr*>(&market), sizeof(market)) < 0)
+			++sendErrors;
+	}
+
+	template<typename T> static void append(std::string &data, const T &value)
+	{
+		data.append(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	void copyPair(char (&target)[7], size_t pair) const
+	{
+		std::memset(target, 0, sizeof(target));
+		std::memcpy(target, pairs[pair].data(), std::min(pairs[pair].size(), sizeof(target) - 1));
+	}
+
+	void sendBridgeState(Message::Type type, size_t pair, int64_t time)
+	{
+		Message::BridgeUp message;
+		copyPair(message.pair, pair);
+		message.timestamp = static_cast<int32_t>(time);
+		std::string data(1, static_cast<char>(type));
+		append(data, message);
+		send(data);
+	}
+
+	void onTick(const Tick &tick)
+	{
+		now = tick.time;
+		currentBid[tick.pair] = tick.bid;
+		currentAsk[tick.pair] = tick.ask;
+		checkLimits(tick.pair);
+
+		Message::Tick message;
+		copyPair(message.pair, tick.pair);
+		message.bid = tick.bid;
+		message.ask = tick.ask;
+		message.timestamp = static_cast<int32_t>(tick.time);
+		std::string data(1, static_cast<char>(Message::bridgeTick));
+		append(data, message);
+		send(data);
+		lastTickSentAt = Clock::now();
+		anyTickSent = true;
+		++ticksSent;
+
+		// The MQL4 expert of the leading pair publishes the general data on every tick.
+		if (tick.pair == leadingPair)
+			publishGeneralData();
+	}
+
+	double getProfit(const Order &order) const
+	{
+		const size_t pair = std::find_if(pairs.begin(), pairs.end(), [&order](const std::string &name) { return name == order.data.pair; }) - pairs.begin();
+		if (pair >= pairs.size()) return 0.0;
+		const double difference = order.isBuy() ? currentBid[pair] - order.data.openPrice : order.data.openPrice - currentAsk[pair];
+		// Roughly in account currency for standard lots.
+		return difference * order.data.lots * 100000.0;
+	}
+
+	void publishGeneralData()
+	{
+		double margin = 0.0, openProfit = 0.0;
+		for (const auto &order : orders)
+		{
+			margin += order.second.data.lots * 100000.0 / leverage;
+			openProfit += getProfit(order.second);
+		}
+
+		Message::AccountInfo account;
+		account.leverage = leverage;
+		account.balance = balance;
+		account.margin = margin;
+		account.freeMargin = balance + openProfit - margin;
+		std::string data(1, static_cast<char>(Message::bridgeAccountInfo));
+		append(data, account);
+		send(data);
+
+		// The expert transmits at most ten orders; the DLL sends one trailing byte.
+		std::string batch(1, static_cast<char>(Message::bridgeOrders));
+		size_t count = 0;
+		for (auto &order : orders)
+		{
+			if (count++ == 10) break;
+			order.second.data.profit = getProfit(order.second);
+			append(batch, order.second.data);
+		}
+		batch.push_back('\0');
+		send(batch);
+	}
+
+	void checkLimits(size_t pair)
+	{
+		for (auto iter = orders.begin(); iter != orders.end();)
+		{
+			const Order &order = iter->second;
+			if (pairs[pair] != order.data.pair)
+			{
+				++iter;
+				continue;
+			}
+			const double price = order.isBuy() ? currentBid[pair] : currentAsk[pair];
+			const bool stopLoss = order.data.stopLoss != 0.0 && (order.isBuy() ? price <= order.data.stopLoss : price >= order.data.stopLoss);
+			const bool takeProfit = order.data.takeProfit != 0.0 && (order.isBuy() ? price >= order.data.takeProfit : price <= order.data.takeProfit);
+			if (!stopLoss && !takeProfit)
+			{
+				++iter;
+				continue;
+			}
+			balance += getProfit(order);
+			++stopsHit;
+			iter = orders.erase(iter);
+		}
+	}
+
+	// Executes commands until the time is reached; returns immediately if it already passed.
+	void waitForCommands(Clock::time_point until)
+	{
+		char buffer[2048];
+		while (true)
+		{
+			const Clock::duration remaining = until - Clock::now();
+			const int64_t remainingUs = std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::microseconds>(remaining).count());
+
+			fd_set readable;
+			FD_ZERO(&readable);
+			FD_SET(sock, &readable);
+			struct timeval timeout;
+			timeout.tv_sec = static_cast<long>(remainingUs / 1000000);
+			timeout.tv_usec = static_cast<long>(remainingUs % 1000000);
+			const int ready = select(static_cast<int>(sock) + 1, &readable, nullptr, nullptr, &timeout);
+			if (ready <= 0)
+			{
+				if (remainingUs == 0) return;
+				continue;
+			}
+
+			struct sockaddr_in sender;
+			socklen_t senderLength = sizeof(sender);
+			const int length = static_cast<int>(recvfrom(sock, buffer, sizeof(buffer), 0, reinterpret_cast<struct sockaddr*>(&sender), &senderLength));
+			const Clock::time_point receivedAt = Clock::now();
+			if (length < static_cast<int>(sizeof(int32_t))) continue;
+			onCommand(buffer, length, receivedAt);
+		}
+	}
+
+	void onCommand(const char *data, int length, Clock::time_point receivedAt)
+	{
+		int32_t type;
+		std::memcpy(&type, data, sizeof(type));
+		commandCounts[type] += 1;
+		if (anyTickSent)
+			roundTrips[type].push_back(std::chrono::duration<double, std::micro>(receivedAt - lastTickSentAt).count());
+
+		switch (type)
+		{
+		case Message::newOrder:
+			{
+				if (length < static_cast<int>(sizeof(Message::NewOrder))) break;
+				Message::NewOrder message;
+				std::memcpy(&message, data, sizeof(message));
+
+				Order order;
+				std::memset(&order.data, 0, sizeof(order.data));
+				copyPair(order.data.pair, leadingPair);
+				order.data.type = message.type;
+				order.data.tickedID = nextTicketID++;
+				order.data.openPrice = (message.type == 0) ? currentAsk[leadingPair] : currentBid[leadingPair];
+				order.data.takeProfit = message.takeProfitPrice;
+				order.data.stopLoss = message.stopLossPrice;
+				order.data.timestampOpen = static_cast<int32_t>(now);
+				order.data.lots = message.lotSize;
+				orders[order.data.tickedID] = order;
+			}
+			break;
+		case Message::closeOrder:
+			{
+				if (length < static_cast<int>(sizeof(Message::CloseOrder))) break;
+				Message::CloseOrder message;
+				std::memcpy(&message, data, sizeof(message));
+				auto order = orders.find(message.ticketID);
+				if (order == orders.end()) break;
+				balance += getProfit(order->second);
+				orders.erase(order);
+			}
+			break;
+		case Message::updateOrder:
+			{
+				if (length < static_cast<int>(sizeof(Message::UpdateOrder))) break;
+				Message::UpdateOrder message;
+				std::memcpy(&message, data, sizeof(message));
+				auto order = orders.find(message.ticketID);
+				if (order == orders.end()) break;
+				order->second.data.takeProfit = message.takeProfitPrice;
+				order->second.data.stopLoss = message.stopLossPrice;
+			}
+			break;
+		default:
+			std::cerr << "WARNING: unknown command " << type << std::endl;
+			break;
+		}
+	}
+
+	static double percentile(std::vector<double> &values, double percent)
+	{
+		if (values.empty()) return 0.0;
+		const size_t index = std::min(values.size() - 1, static_cast<size_t>(percent / 100.0 * values.size()));
+		std::nth_element(values.begin(), values.begin() + index, values.end());
+		return values[index];
+	}
+
+	void report(double elapsed)
+	{
+		std::cout << "Sent " << ticksSent << " ticks in " << elapsed << "s (" << (elapsed > 0.0 ? ticksSent / elapsed : 0.0) << "/s), "
+			<< sendErrors << " send errors, " << stopsHit << " stops hit, " << orders.size() << " orders open, balance " << balance << std::endl;
+
+		const std::map<int32_t, std::string> names = { { Message::newOrder, "NewOrder" }, { Message::closeOrder, "CloseOrder" }, { Message::updateOrder, "UpdateOrder" } };
+		std::ofstream rttFile;
+		if (!config.rttFilename.empty())
+		{
+			rttFile.open(config.rttFilename, std::ios_base::out | std::ios_base::trunc);
+			rttFile << "Command\tRound Trip (us)" << std::endl;
+		}
+
+		for (auto &command : roundTrips)
+		{
+			std::vector<double> &values = command.second;
+			const auto name = names.find(command.first);
+			const std::string commandName = (name != names.end()) ? name->second : std::to_string(command.first);
+			if (rttFile.is_open())
+			{
+				for (const double value : values)
+					rttFile << commandName << "\t" << value << std::endl;
+			}
+			const double minimum = *std::min_element(values.begin(), values.end());
+			const double maximum = *std::max_element(values.begin(), values.end());
+			const double p50 = percentile(values, 50.0), p90 = percentile(values, 90.0), p99 = percentile(values, 99.0);
+			std::cout << "\t" << commandName << ": " << commandCounts[command.first] << " commands, round trip (us) min " << minimum
+				<< " p50 " << p50 << " p90 " << p90 << " p99 " << p99 << " max " << maximum << std::endl;
+		}
+	}
+};
+
+int main(int argc, char ** argv)
+{
+	std::vector<std::string> arguments(argv + 1, argv + argc);
+	BridgeSimulator simulator;
+	std::vector<std::string> tickFilenames;
+
+	// Parse command-line args.
+	std::map<std::string, std::function<void(std::string)>> argumentMapping =
+	{
+		{ "--ticks", [&](std::string s)
+					{
+						std::istringstream is(s);
+						std::string filename;
+						while (std::getline(is, filename, ','))
+						{
+							if (!filename.empty())
+								tickFilenames.push_back(filename);
+						}
+					}
+		},
+		{ "--market", [&](std::string s)
+					{
+						const size_t colon = s.find(':');
+						simulator.config.marketHost = s.substr(0, colon);
+						if (colon != std::string::npos)
+							simulator.config.marketPort = std::stoi(s.substr(colon + 1));
+					}
+		},
+		{ "--speed", [&](std::string s)
+					{
+						simulator.config.speed = std::stod(s);
+					}
+		},
+		{ "--leading", [&](std::string s)
+					{
+						simulator.config.leading = s;
+					}
+		},
+		{ "--linger", [&](std::string s)
+					{
+						simulator.config.lingerMs = std::stoi(s);
+					}
+		},
+		{ "--rttfile", [&](std::string s)
+					{
+						simulator.config.rttFilename = s;
+					}
+		},
+	};
+
+	for (auto & option : argumentMapping)
+	{
+		std::vector<std::string>::iterator iter = std::find(arguments.begin(), arguments.end(), option.first);
+		if (iter == arguments.end()) continue;
+		if (++iter == arguments.end() || iter->size() == 0 || (*iter)[0] == '-')
+		{
+			std::cerr << "ERROR: missing argument value for " << option.first << std::endl;
+			continue;
+		}
+		option.second(*iter);
+	}
+
+	if (tickFilenames.empty())
+	{
+		std::cerr << "ERROR: no tick files specified (--ticks)." << std::endl;
+		return 1;
+	}
+
+	for (const std::string &filename : tickFilenames)
+	{
+		const std::string pair = pairFromFilename(filename);
+		if (pair.empty() || pair.size() > 6)
+		{
+			std::cerr << "ERROR: could not determine the pair of '" << filename << "'." << std::endl;
+			return 1;
+		}
+		size_t index = std::find(simulator.pairs.begin(), simulator.pairs.end(), pair) - simulator.pairs.begin();
+		if (index == simulator.pairs.size())
+			simulator.pairs.push_back(pair);
+		if (!loadTicks(filename, index, simulator.ticks))
+		{
+			std::cerr << "ERROR: could not open '" << filename << "'." << std::endl;
+			return 1;
+		}
+	}
+	std::cerr << "INFO: " << simulator.ticks.size() << " ticks of " << simulator.pairs.size() << " pairs" << std::endl;
+
+	if (!simulator.open())
+	{
+		std::cerr << "ERROR: could not open the socket to " << simulator.config.marketHost << ":" << simulator.config.marketPort << std::endl;
+		return 1;
+	}
+	simulator.run();
+	return 0;
+}
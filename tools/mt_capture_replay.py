@@ -0,0 +1,81 @@
+# Sends a MetaTrader datagram capture (see [Metatrader Interface] CaptureFilename) back to the MetaTrader interface port.
+# Usage: python mt_capture_replay.py capture.mmcap [--speed 1.0] [--host 127.0.0.1] [--port 5005] [--repeat 1]
+# A speed of 1 keeps the recorded timing, 10 plays ten times as fast and 0 sends as fast as possible.
+import argparse
+import socket
+import struct
+import sys
+import time
+
+MAGIC = b"MMCAP001"
+HEADER = struct.Struct("<8sq")
+RECORD = struct.Struct("<qI")
+
+def read_capture(filename):
+	with open(filename, "rb") as file:
+		data = file.read()
+	if len(data) < HEADER.size:
+		raise ValueError("'{}' is too short to be a capture.".format(filename))
+	magic, start_wall_clock = HEADER.unpack_from(data, 0)
+	if magic != MAGIC:
+		raise ValueError("'{}' is not a capture.".format(filename))
+
+	records = []
+	position = HEADER.size
+	while position + RECORD.size <= len(data):
+		offset, length = RECORD.unpack_from(data, position)
+		position += RECORD.size
+		# The capture may have been cut off while the market was running.
+		if position + length > len(data):
+			break
+		records.append((offset, data[position:position + length]))
+		position += length
+	return start_wall_clock, records
+
+def replay(records, sock, address, speed):
+	if not records:
+		return 0.0, 0.0
+	first_offset = records[0][0]
+	start = time.perf_counter()
+	max_lag = 0.0
+	for offset, payload in records:
+		if speed > 0.0:
+			due = start + (offset - first_offset) / 1e9 / speed
+			now = time.perf_counter()
+			if due > now:
+				time.sleep(due - now)
+			else:
+				max_lag = max(max_lag, now - due)
+		sock.sendto(payload, address)
+	return time.perf_counter() - start, max_lag
+
+def main():
+	parser = argparse.ArgumentParser(description="Replays a MetaTrader datagram capture.")
+	parser.add_argument("capture")
+	parser.add_argument("--host", default="127.0.0.1")
+	parser.add_argument("--port", type=int, default=5005)
+	parser.add_argument("--speed", type=float, default=1.0, help="1 = recorded timing, N = N times faster, 0 = as fast as possible")
+	parser.add_argument("--repeat", type=int, default=1)
+	args = parser.parse_args()
+
+	start_wall_clock, records = read_capture(args.capture)
+	if not records:
+		print("Capture contains no datagrams.")
+		return 1
+	recorded = (records[-1][0] - records[0][0]) / 1e9
+	print("{} datagrams over {:.1f}s, recorded at {}".format(len(records), recorded, time.strftime("%Y-%m-%d %H:%M:%S", time.gmtime(start_wall_clock / 1e9))))
+
+	sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+	# Bursts must not be dropped on the sending side.
+	sock.setsockopt(socket.SOL_SOCKET, socket.SO_SNDBUF, 4 * 1024 * 1024)
+	address = (args.host, args.port)
+
+	for iteration in range(args.repeat):
+		elapsed, max_lag = replay(records, sock, address, args.speed)
+		rate = len(records) / elapsed if elapsed > 0.0 else float("inf")
+		# A growing lag means that this sender could not keep up with the requested speed.
+		print("Run {}: {} datagrams in {:.3f}s ({:.0f}/s), max lag behind schedule {:.1f}ms".format(iteration + 1, len(records), elapsed, rate, 1000.0 * max_lag))
+	return 0
+
+if __name__ == "__main__":
+	sys.exit(main())
@@ -0,0 +1,105 @@
+# Reader for the binary statistics output (Format=binary in the [Statistics] section of market.ini).
+#
+# Usage:
+#	from statistics_reader import StatisticsFile
+#	stats = StatisticsFile("../run/saves/vars/variables2016.bin")
+#	times, values = stats.read()                       # all rows, values has one column per variable
+#	times, values = stats.read(begin=t0, end=t1)       # only the chunks overlapping [t0, t1)
+#	price = stats.column("EURUSD")
+
+import struct
+import sys
+import numpy as np
+
+HEADER_MAGIC = b"MMSTAT01"
+CHUNK_TAG = b"CHNK"
+INDEX_TAG = b"INDX"
+TRAILER_MAGIC = b"MMSTIDX1"
+
+class StatisticsFile:
+	def __init__(self, filename):
+		self.filename = filename
+		with open(filename, "rb") as file:
+			if file.read(8) != HEADER_MAGIC:
+				raise ValueError("{} is not a binary statistics file".format(filename))
+			self.column_count, schema_length = struct.unpack("<II", file.read(8))
+			self.schema = file.read(schema_length).decode("utf-8")
+			self.data_offset = file.tell()
+			self.chunks = self._read_index(file)
+
+		lines = [line for line in self.schema.splitlines() if line]
+		# The first line is "name<delimiter>description<delimiter>id" which tells us the delimiter.
+		delimiter = lines[0][len("name"):lines[0].index("description")]
+		self.names, self.descriptions = [], []
+		for line in lines[1:]:
+			name, rest = line.split(delimiter, 1)
+			self.names.append(name)
+			self.descriptions.append(rest.rsplit(delimiter, 1)[0])
+		assert len(self.names) == self.column_count
+
+	def _read_index(self, file):
+		# Returns a list of (offset, first_time, last_time, row_count).
+		file.seek(0, 2)
+		file_size = file.tell()
+		if file_size >= self.data_offset + 16:
+			file.seek(file_size - 16)
+			index_offset, magic = struct.unpack("<Q8s", file.read(16))
+			if magic == TRAILER_MAGIC:
+				file.seek(index_offset)
+				if file.read(4) == INDEX_TAG:
+					chunk_count, = struct.unpack("<I", file.read(4))
+					entries = np.frombuffer(file.read(chunk_count * 32), dtype=[("offset", "<u8"), ("first", "<i8"), ("last", "<i8"), ("rows", "<u4"), ("reserved", "<u4")])
+					return [(int(e["offset"]), int(e["first"]), int(e["last"]), int(e["rows"])) for e in entries]
+
+		# No index (the writer did not shut down cleanly): walk the chunks.
+		chunks = []
+		offset = self.data_offset
+		while offset + 24 <= file_size:
+			file.seek(offset)
+			header = file.read(24)
+			if header[:4] != CHUNK_TAG:
+				break
+			rows, first, last = struct.unpack("<Iqq", header[4:])
+			size = 24 + rows * 8 * (1 + self.column_count)
+			if offset + size > file_size:
+				break
+			chunks.append((offset, first, last, rows))
+			offset += size
+		return chunks
+
+	def _read_chunk(self, file, offset, rows):
+		file.seek(offset + 24)
+		times = np.fromfile(file, dtype="<i8", count=rows)
+		values = np.fromfile(file, dtype="<f8", count=rows * self.column_count).reshape(self.column_count, rows)
+		return times, values
+
+	def read(self, begin=None, end=None, columns=None):
+		# Returns (times, values) with values being of shape (rows, columns).
+		selected = [c for c in self.chunks if (begin is None or c[2] >= begin) and (end is None or c[1] < end)]
+		column_indices = None if columns is None else [self.names.index(c) if isinstance(c, str) else c for c in columns]
+		all_times, all_values = [], []
+		with open(self.filename, "rb") as file:
+			for offset, first, last, rows in selected:
+				times, values = self._read_chunk(file, offset, rows)
+				if column_indices is not None:
+					values = values[column_indices, :]
+				mask = np.ones(rows, dtype=bool)
+				if begin is not None:
+					mask &= times >= begin
+				if end is not None:
+					mask &= times < end
+				all_times.append(times[mask])
+				all_values.append(values[:, mask].T)
+		column_count = self.column_count if column_indices is None else len(column_indices)
+		if not all_times:
+			return np.zeros(0, dtype=np.int64), np.zeros((0, column_count))
+		return np.concatenate(all_times), np.concatenate(all_values)
+
+	def column(self, name, begin=None, end=None):
+		return self.read(begin, end, columns=[name])[1][:, 0]
+
+if __name__ == "__main__":
+	stats = StatisticsFile(sys.argv[1])
+	print("{} variables, {} chunks".format(stats.column_count, len(stats.chunks)))
+	for offset, first, last, rows in stats.chunks:
+		print("\t{}\t{} - {}\t{} rows".format(offset, first, last, rows))